@@ -1,6 +1,10 @@
 #ifndef AFINA_STORAGE_H
 #define AFINA_STORAGE_H
 
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <stdexcept>
 #include <string>
 
 namespace Afina {
@@ -10,6 +14,41 @@ namespace Afina {
  */
 class Storage {
 public:
+    /**
+     * Callback receiving key/value pairs from ForEach along with their expiration time, see Put
+     */
+    typedef std::function<void(const std::string &key, const std::string &value, uint32_t expire)> Visitor;
+
+    /**
+     * Callback changing value in place for Update. Returns false to keep the value as it was, in
+     * that case it must leave the value untouched
+     */
+    typedef std::function<bool(std::string &value)> Updater;
+
+    /**
+     * Callback receiving values found by MultiGet: position of the key in the request, value and
+     * its version. Value points right into the storage, so it isn't copied, and is valid only until
+     * the callback returns
+     */
+    typedef std::function<void(size_t index, const char *value, size_t size, uint64_t version)> Receiver;
+
+    /**
+     * Metadata of the association, see Inspect
+     */
+    struct Info {
+        // See Get
+        uint64_t version;
+
+        // Unix time the association expires at, 0 if never
+        uint32_t expire;
+
+        // Size of the value in bytes
+        size_t size;
+
+        // Value was read since it was changed last time
+        bool fetched;
+    };
+
     Storage() {}
     virtual ~Storage() {}
 
@@ -27,8 +66,13 @@ public:
      *
      * @param key to be associated with value
      * @param value to be assigned for the key
+     * @param expire unix time when the association expires, 0 means never. Expired associations
+     * are treated by all methods as if they were removed
+     * @param version if given, set to the version of the stored value once method returns true,
+     * see Get
      */
-    virtual bool Put(const std::string &key, const std::string &value) = 0;
+    virtual bool Put(const std::string &key, const std::string &value, uint32_t expire = 0,
+                     uint64_t *version = nullptr) = 0;
 
     /**
      * Stores association between given key/value pair if key isn't present in
@@ -40,8 +84,11 @@ public:
      *
      * @param key to be associated with value
      * @param value to be assigned for the key
+     * @param expire see Put
+     * @param version see Put
      */
-    virtual bool PutIfAbsent(const std::string &key, const std::string &value) = 0;
+    virtual bool PutIfAbsent(const std::string &key, const std::string &value, uint32_t expire = 0,
+                             uint64_t *version = nullptr) = 0;
 
     /**
      * Updates existing association between given key/value pair
@@ -53,8 +100,111 @@ public:
      *
      * @param key to be associated with value
      * @param value to be assigned for the key
+     * @param expire see Put
+     * @param version see Put
+     */
+    virtual bool Set(const std::string &key, const std::string &value, uint32_t expire = 0,
+                     uint64_t *version = nullptr) = 0;
+
+    /**
+     * Updates existing association only if the key wasn't changed since its value was read with
+     * the given version, see Get.
+     *
+     * Method returns true if value is stored, version is set to the version of the new value then.
+     * Otherwise version is set to the current version of the key, or to 0 if requested key doesn't
+     * present in storage
+     *
+     * @param key to be associated with value
+     * @param value to be assigned for the key
+     * @param version the current value was read with
+     * @param expire see Put
+     */
+    virtual bool CompareAndSet(const std::string &key, const std::string &value, uint64_t &version,
+                               uint32_t expire = 0) = 0;
+
+    /**
+     * Atomically changes value of the existing key: updater gets current value and modifies it in
+     * place, no other change of the key could happen in between.
+     * If requested key doesn't present in storage then updater isn't called and method returns
+     * false.
+     *
+     * Method returns true if updater accepted the change and the new value is stored. If the new
+     * value doesn't fit into the storage anymore the key is removed and method returns false.
+     * Expiration time of the key stays the same, as for Append, Prepend, Increment and Decrement
+     *
+     * @param key to be updated
+     * @param updater to be called with the current value
+     * @param version see Put
+     */
+    virtual bool Update(const std::string &key, const Updater &updater, uint64_t *version = nullptr) = 0;
+
+    /**
+     * Adds data to the end of the existing value.
+     * If requested key doesn't present in storage method returns false and
+     * doesnt change anything.
+     *
+     * Backends keeping room for the value to grow do it in time proportional to the size of data
+     * rather than of the whole value, default implementation rewrites value through Update
+     *
+     * @param key to be updated
+     * @param data to be added
+     * @param version see Put
+     */
+    virtual bool Append(const std::string &key, const std::string &data, uint64_t *version = nullptr) {
+        return Update(
+            key,
+            [&data](std::string &value) {
+                value.append(data);
+                return true;
+            },
+            version);
+    }
+
+    /**
+     * Same as Append, but data is added in front of the existing value
+     */
+    virtual bool Prepend(const std::string &key, const std::string &data, uint64_t *version = nullptr) {
+        return Update(
+            key,
+            [&data](std::string &value) {
+                value.insert(0, data);
+                return true;
+            },
+            version);
+    }
+
+    /**
+     * Atomically adds delta to the counter: value that is decimal representation of 64-bit
+     * unsigned integer. Counter wraps around on overflow.
+     * If requested key doesn't present in storage method returns false and
+     * doesnt change anything. If value isn't a number method throws std::runtime_error
+     *
+     * Default implementation parses and formats value through Update, backends could keep counters
+     * in binary form instead
+     *
+     * @param key of the counter
+     * @param delta to be added
+     * @param value output parameter to copy new value of the counter to
+     */
+    virtual bool Increment(const std::string &key, uint64_t delta, uint64_t &value) {
+        return Update(key, [delta, &value](std::string &text) {
+            value = ParseCounter(text) + delta;
+            text = std::to_string(value);
+            return true;
+        });
+    }
+
+    /**
+     * Same as Increment, but delta is subtracted. Counter never goes below 0
      */
-    virtual bool Set(const std::string &key, const std::string &value) = 0;
+    virtual bool Decrement(const std::string &key, uint64_t delta, uint64_t &value) {
+        return Update(key, [delta, &value](std::string &text) {
+            uint64_t current = ParseCounter(text);
+            value = current > delta ? current - delta : 0;
+            text = std::to_string(value);
+            return true;
+        });
+    }
 
     /**
      * Removes association for the given key
@@ -72,6 +222,15 @@ public:
      */
     virtual bool Delete(const std::string &key) = 0;
 
+    /**
+     * Removes all associations present in the storage at the given time, ones stored after it
+     * stay. Backends do it in constant time: they remember the moment and treat all older
+     * associations as absent, memory is reclaimed once those are looked up or evicted
+     *
+     * @param at unix time of the flush, 0 or time in the past means right now
+     */
+    virtual void Flush(uint32_t at = 0) = 0;
+
     /**
      * Retrive key for the given value
      * If there is an association for the given key then method copies value
@@ -84,6 +243,108 @@ public:
      * @param value output parameter to copy value to
      */
     virtual bool Get(const std::string &key, std::string &value) const = 0;
+
+    /**
+     * Same as Get, but also retrives version of the value. Every change of the key gives it new
+     * version, bigger than versions the key had before, even if it was deleted in between. Version
+     * is never 0
+     *
+     * @param key to retrive value for
+     * @param value output parameter to copy value to
+     * @param version output parameter to copy version of the value to
+     */
+    virtual bool Get(const std::string &key, std::string &value, uint64_t &version) const = 0;
+
+    /**
+     * Retrives values of many keys at once, like Get with version does for each of them. Receiver is
+     * called for every found key in no particular order: backends group keys so that each lock is
+     * taken once per call rather than once per key. Storage is not allowed to be accessed from
+     * inside of the receiver
+     *
+     * @param keys to retrive values for
+     * @param count number of keys in the array
+     * @param receiver to be called for each found key
+     */
+    virtual void MultiGet(const std::string *keys, size_t count, const Receiver &receiver) const {
+        std::string value;
+        uint64_t version;
+        for (size_t i = 0; i < count; i++) {
+            if (Get(keys[i], value, version)) {
+                receiver(i, value.data(), value.size(), version);
+            }
+        }
+    }
+
+    /**
+     * Changes expiration time of the existing key without touching its value and version.
+     * If requested key doesn't present in storage method returns false and
+     * doesnt change anything.
+     *
+     * @param key to be updated
+     * @param expire new expiration time, see Put
+     */
+    virtual bool Touch(const std::string &key, uint32_t expire) = 0;
+
+    /**
+     * Same as Get with version, but also changes expiration time of the key like Touch does
+     */
+    virtual bool GetAndTouch(const std::string &key, uint32_t expire, std::string &value, uint64_t &version) = 0;
+
+    /**
+     * Retrives metadata of the key and, if asked, its value. Copying the value counts as its read,
+     * info.fetched tells if the value was read before this call
+     *
+     * @param key to retrive metadata for
+     * @param info output parameter to copy metadata to
+     * @param value output parameter to copy value to, value isn't copied if it is null
+     */
+    virtual bool Inspect(const std::string &key, Info &info, std::string *value = nullptr) const = 0;
+
+    /**
+     * Calls visitor for every key/value pair in the storage, from the least recently used to the
+     * most recently used one. Storage is not allowed to be changed from inside of the visitor
+     *
+     * @param visitor to be called for each association
+     */
+    virtual void ForEach(const Visitor &visitor) const = 0;
+
+    /**
+     * Starts to write point-in-time copy of the storage content to the snapshot file in background
+     *
+     * Method returns false if storage isn't configured to take snapshots or if previous one is still
+     * in progress
+     */
+    virtual bool Snapshot() { return false; }
+
+protected:
+    /**
+     * Current unix time expiration times are compared with
+     */
+    static uint32_t Now() { return uint32_t(std::time(nullptr)); }
+
+    /**
+     * Checks if association with the given expiration time is expired by now
+     */
+    static bool Expired(uint32_t expire) { return expire != 0 && expire <= Now(); }
+
+    /**
+     * Parses value of the counter, throws std::runtime_error if it isn't a decimal 64-bit unsigned
+     * integer
+     */
+    static uint64_t ParseCounter(const std::string &text) {
+        if (text.empty() || text.size() > 20) {
+            throw std::runtime_error("Value isn't a number");
+        }
+
+        uint64_t number = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9' || number > (UINT64_MAX - (c - '0')) / 10) {
+                throw std::runtime_error("Value isn't a number");
+            }
+            number = number * 10 + (c - '0');
+        }
+        return number;
+    }
 };
 
 } // namespace Afina
@@ -21,6 +21,7 @@ namespace Execute {
  */
 class Append : public InsertCommand {
 public:
+    Append() {}
     Append(const std::string &key, uint32_t flags, int32_t expire) : InsertCommand(key, flags, expire) {}
     ~Append() {}
 
@@ -0,0 +1,48 @@
+#ifndef AFINA_EXECUTE_CAS_H
+#define AFINA_EXECUTE_CAS_H
+
+#include <cstdint>
+#include <string>
+
+#include "InsertCommand.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Check and set
+ * Stores value for the key only if nobody else changed it since the client has read it with
+ * "gets", that returns version of each value
+ *
+ * Command must write result to the output, which could be:
+ * - "STORED", to indicate success.
+ * - "EXISTS" to indicate that the item has been modified since it was read.
+ * - "NOT_FOUND" to indicate that the item doesn't exist or has been deleted.
+ */
+class Cas : public InsertCommand {
+public:
+    Cas() : _version(0) {}
+    Cas(const std::string &key, uint32_t flags, int32_t expire, uint64_t version)
+        : InsertCommand(key, flags, expire), _version(version) {}
+    ~Cas() {}
+
+    inline uint64_t version() const { return _version; }
+
+    /**
+     * Reuses command for the next request
+     */
+    inline void Reset(const std::string &key, uint32_t flags, int32_t expire, uint64_t version) {
+        InsertCommand::Reset(key, flags, expire);
+        _version = version;
+    }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    uint64_t _version;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_CAS_H
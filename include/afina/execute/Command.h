@@ -1,6 +1,7 @@
 #ifndef AFINA_EXECUTE_COMMAND_H
 #define AFINA_EXECUTE_COMMAND_H
 
+#include <cstdint>
 #include <string>
 
 namespace Afina {
@@ -19,6 +20,14 @@ public:
     virtual ~Command() {}
 
     virtual void Execute(Storage &storage, const std::string &args, std::string &out) = 0;
+
+protected:
+    /**
+     * Converts expiration time as clients pass it to the unix time storage expects: 0 means never,
+     * up to 30 days it is number of seconds from now, otherwise it is already unix time. Negative
+     * time gives the item that is expired right away
+     */
+    static uint32_t Deadline(int32_t expire);
 };
 
 } // namespace Execute
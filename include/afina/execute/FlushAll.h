@@ -0,0 +1,42 @@
+#ifndef AFINA_EXECUTE_FLUSH_ALL_H
+#define AFINA_EXECUTE_FLUSH_ALL_H
+
+#include <cstdint>
+
+#include "Command.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Invalidate all items
+ * Drops all existing items right away or after the delay. Storage does it in constant time, memory
+ * of the dropped items is reclaimed once they are looked up or evicted
+ *
+ * Command always writes "OK" to the output
+ */
+class FlushAll : public Command {
+public:
+    FlushAll() : _delay(0) {}
+    FlushAll(int32_t delay) : _delay(delay) {}
+    ~FlushAll() {}
+
+    inline int32_t delay() const { return _delay; }
+
+    /**
+     * Reuses command for the next request
+     *
+     * @param delay in the same format as expiration time of items, 0 means right now
+     */
+    inline void Reset(int32_t delay) { _delay = delay; }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    int32_t _delay;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_FLUSH_ALL_H
@@ -1,6 +1,7 @@
 #ifndef AFINA_EXECUTE_GET_H
 #define AFINA_EXECUTE_GET_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -24,7 +25,18 @@ namespace Execute {
  * END
  *
  * Where <key> is the key for the value, <bytes> is the number of bytes in the
- * value and <data> is the value text
+ * value and <data> is the value text. Items are looked up with Storage::MultiGet,
+ * so they don't follow order of the keys in the request
+ *
+ * Being reset for "gets" command also writes version of each value, that
+ * could be passed to "cas" later:
+ * VALUE <key> <flags> <bytes> <cas unique>\r\n
+ *
+ * Being reset for "gat" and "gats" commands also changes expiration time of
+ * each found item, like "touch" does.
+ *
+ * Being reset for a single key, as binary protocol does, command writes nothing and keeps the
+ * item in found(), value() and version() instead.
  *
  * If some of the keys appearing in a retrieval request are not sent back
  * by the server in the item list this means that the server does not
@@ -34,15 +46,64 @@ namespace Execute {
  */
 class Get : public Command {
 public:
-    Get(const std::vector<std::string> &keys) : _keys(keys) {}
+    Get() : _count(0), _versions(false), _touch(false), _expire(0), _text(true), _found(false), _version(0) {}
+    Get(const std::vector<std::string> &keys, bool versions = false)
+        : _keys(keys), _count(keys.size()), _versions(versions), _touch(false), _expire(0), _text(true),
+          _found(false), _version(0) {}
     ~Get() {}
 
-    inline const std::vector<std::string> &keys() const { return _keys; }
+    inline std::vector<std::string> keys() const {
+        return std::vector<std::string>(_keys.begin(), _keys.begin() + _count);
+    }
+
+    inline bool versions() const { return _versions; }
+    inline bool touch() const { return _touch; }
+    inline int32_t expire() const { return _expire; }
+
+    /**
+     * Reuses command for the next request with the first count of the given keys. Key buffers are
+     * never released, so there are no allocations once they are big enough
+     *
+     * @param versions write version of each value
+     * @param touch set expiration time of found items to expire
+     */
+    void Reset(const std::vector<std::string> &keys, size_t count, bool versions = false, bool touch = false,
+               int32_t expire = 0);
+
+    /**
+     * Reuses command to look up the single key without the text reply
+     *
+     * @param touch set expiration time of the found item to expire
+     */
+    void Reset(const std::string &key, bool touch = false, int32_t expire = 0);
+
+    // Item found by the single key lookup
+    inline bool found() const { return _found; }
+    inline const std::string &value() const { return _value; }
+    inline uint64_t version() const { return _version; }
 
     void Execute(Storage &storage, const std::string &args, std::string &out) override;
 
 private:
+    // Writes found item to the output
+    void Append(std::string &out, const std::string &key, const char *value, size_t size, uint64_t version) const;
+
     std::vector<std::string> _keys;
+
+    // Number of keys in use, the rest of _keys are kept for reuse
+    size_t _count;
+
+    bool _versions;
+    bool _touch;
+    int32_t _expire;
+
+    // Write the text reply, otherwise the single key lookup result is kept below
+    bool _text;
+    bool _found;
+    uint64_t _version;
+
+    // Values of gat and the single key lookup are read into it, it keeps capacity of the biggest one
+    std::string _value;
 };
 
 } // namespace Execute
@@ -0,0 +1,86 @@
+#ifndef AFINA_EXECUTE_INCR_H
+#define AFINA_EXECUTE_INCR_H
+
+#include <cstdint>
+#include <string>
+
+#include "Command.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Increment or decrement counter
+ * Changes the value of the key, which must be decimal representation of 64-bit unsigned integer,
+ * by the given delta. Incremented counter wraps around, decremented one stops at 0. Optionally
+ * missing counter is created with the initial value, as binary protocol asks to
+ *
+ * Command must write result to the output, which could be:
+ * - new value of the counter, to indicate success.
+ * - "NOT_FOUND" to indicate the item with this value was not found.
+ * - "CLIENT_ERROR cannot increment or decrement non-numeric value" if value isn't a number.
+ */
+class Incr : public Command {
+public:
+    Incr(bool decrement = false)
+        : _delta(0), _decrement(decrement), _create(false), _initial(0), _expire(0), _found(false), _value(0) {}
+    Incr(const std::string &key, uint64_t delta, bool decrement = false)
+        : _key(key), _delta(delta), _decrement(decrement), _create(false), _initial(0), _expire(0), _found(false),
+          _value(0) {}
+    ~Incr() {}
+
+    inline const std::string &key() const { return _key; }
+    inline uint64_t delta() const { return _delta; }
+    inline bool decrement() const { return _decrement; }
+
+    // Result of the last Execute, value is the new counter if it has been found
+    inline bool found() const { return _found; }
+    inline uint64_t value() const { return _value; }
+
+    /**
+     * Reuses command for the next request
+     *
+     * @param create missing counter with the initial value instead of reporting NOT_FOUND
+     * @param expire expiration time of the created counter
+     */
+    inline void Reset(const std::string &key, uint64_t delta, bool create = false, uint64_t initial = 0,
+                      int32_t expire = 0) {
+        _key.assign(key);
+        _delta = delta;
+        _create = create;
+        _initial = initial;
+        _expire = expire;
+        _found = false;
+        _value = 0;
+    }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+    /**
+     * Applies delta to the counter, shared with the meta arithmetic command
+     *
+     * @param create missing counter with the initial value that expires at expire
+     * @param value new value of the counter
+     * @return false if there is no counter, throws std::runtime_error if the value isn't a number
+     */
+    static bool Change(Storage &storage, const std::string &key, uint64_t delta, bool decrement, bool create,
+                       uint64_t initial, int32_t expire, uint64_t &value);
+
+    static const char *const NonNumeric;
+
+private:
+    std::string _key;
+    uint64_t _delta;
+    bool _decrement;
+    bool _create;
+    uint64_t _initial;
+    int32_t _expire;
+
+    bool _found;
+    uint64_t _value;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_INCR_H
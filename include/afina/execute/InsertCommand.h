@@ -15,17 +15,53 @@ namespace Execute {
  */
 class InsertCommand : public Command {
 public:
-    InsertCommand(const std::string &key, uint32_t flags, int32_t expire) : _key(key), _flags(flags), _expire(expire) {}
+    /**
+     * Outcome of the last Execute, binary protocol maps it onto the response status
+     */
+    enum Result : uint8_t { rStored, rNotStored, rExists, rNotFound };
+
+    InsertCommand() : _flags(0), _expire(0), _stored(0), _result(rNotStored) {}
+    InsertCommand(const std::string &key, uint32_t flags, int32_t expire)
+        : _key(key), _flags(flags), _expire(expire), _stored(0), _result(rNotStored) {}
     ~InsertCommand() {}
 
     inline const std::string &key() const { return _key; }
     inline const uint32_t flags() const { return _flags; }
     inline const int32_t expire() const { return _expire; }
 
+    /**
+     * Version of the value stored by the last Execute, 0 if nothing has been stored or the command
+     * doesn't know it. Binary protocol sends it back as CAS of the response
+     */
+    inline uint64_t stored() const { return _stored; }
+
+    // Outcome of the last Execute
+    inline Result result() const { return _result; }
+
+    /**
+     * Reuses command for the next request, key buffer keeps its capacity
+     */
+    inline void Reset(const std::string &key, uint32_t flags, int32_t expire) {
+        _key.assign(key);
+        _flags = flags;
+        _expire = expire;
+        _stored = 0;
+        _result = rNotStored;
+    }
+
 protected:
-    const std::string _key;
-    const uint32_t _flags;
-    const int32_t _expire;
+    // Records outcome of the request and writes its text reply
+    inline void Reply(Result result, std::string &out) {
+        static const char *const text[] = {"STORED", "NOT_STORED", "EXISTS", "NOT_FOUND"};
+        _result = result;
+        out.assign(text[result]);
+    }
+
+    std::string _key;
+    uint32_t _flags;
+    int32_t _expire;
+    uint64_t _stored;
+    Result _result;
 };
 
 } // namespace Execute
@@ -0,0 +1,63 @@
+#ifndef AFINA_EXECUTE_META_ARITHMETIC_H
+#define AFINA_EXECUTE_META_ARITHMETIC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MetaCommand.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Meta arithmetic
+ * ma <key> <flags>*\r\n
+ *
+ * Changes the counter, like "incr" and "decr" do. Flags are:
+ * - M<mode>: I or + to increment, the default one, D or - to decrement
+ * - D<delta>: delta to apply, 1 by default
+ * - N<ttl>: create missing counter with the given expiration time
+ * - J<initial>: value of the created counter, 0 by default
+ * - T<ttl>: change expiration time of the counter once it is changed
+ * - v: write the new value back
+ *
+ * Command must write result to the output, which could be:
+ * - "VA <size> <return flags>*\r\n<number>" if the value was asked for
+ * - "HD <return flags>*" if it wasn't, suppressed by "q"
+ * - "NF" to indicate that the item with this key was not found, suppressed by "q"
+ * - "CLIENT_ERROR cannot increment or decrement non-numeric value" if value isn't a number.
+ */
+class MetaArithmetic : public MetaCommand {
+public:
+    MetaArithmetic() : _decrement(false), _delta(1), _create(false), _initial(0), _vivify(0), _expire(0) {}
+    ~MetaArithmetic() {}
+
+    inline bool decrement() const { return _decrement; }
+    inline uint64_t delta() const { return _delta; }
+
+    /**
+     * Reuses command for the next request, see MetaCommand
+     */
+    void Reset(const std::vector<std::string> &tokens, size_t count);
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+protected:
+    const char *Accepted() const override { return "MDNJTvqOktc"; }
+
+private:
+    bool _decrement;
+    uint64_t _delta;
+    bool _create;
+    uint64_t _initial;
+
+    // Expiration time of the created counter
+    int32_t _vivify;
+    int32_t _expire;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_META_ARITHMETIC_H
@@ -0,0 +1,82 @@
+#ifndef AFINA_EXECUTE_META_COMMAND_H
+#define AFINA_EXECUTE_META_COMMAND_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+
+#include "Command.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Basic class for all meta commands
+ * Meta commands take the key followed by flags: single letter, optionally followed by the token
+ * without space, e.g. "v", "T60" or "Oabc". Flags select what the command does and which fields
+ * are written back, so clients ask for exactly what they need.
+ *
+ * Return flags are written in the order they were requested:
+ * - O<opaque>: token of the request is sent back as is, so pipelined responses could be matched
+ * - k: key of the item
+ * - c: version of the value, the one "gets" returns
+ * - t: seconds left until the item expires, -1 if it never does
+ * - s: size of the value
+ * - h: 1 if the value was read since it was changed last time, 0 otherwise
+ * - f: client flags, always 0 as they aren't stored
+ *
+ * Flag "q" asks not to send the response code telling nothing new, which one is up to the command.
+ * Suppressed response is written as empty output
+ */
+class MetaCommand : public Command {
+public:
+    MetaCommand() : _count(0), _quiet(false) {}
+    ~MetaCommand() {}
+
+    inline const std::string &key() const { return _key; }
+    inline bool quiet() const { return _quiet; }
+
+    inline std::vector<std::string> flags() const {
+        return std::vector<std::string>(_flags.begin(), _flags.begin() + _count);
+    }
+
+    /**
+     * Reuses command for the next request: the first token is the key, flags start from the
+     * token first. Flag buffers are never released, see Get. Throws std::runtime_error if the
+     * command doesn't accept one of the flags
+     */
+    void Reset(const std::vector<std::string> &tokens, size_t count, size_t first = 1);
+
+protected:
+    // Flag letters the command accepts
+    virtual const char *Accepted() const = 0;
+
+    // Returns the first token of the flag, or nullptr if there is no such flag
+    const std::string *Find(char flag) const;
+
+    inline bool Has(char flag) const { return Find(flag) != nullptr; }
+
+    // Parses numeric token of the flag, throws std::runtime_error if it isn't a number
+    uint64_t Number(char flag, uint64_t fallback) const;
+
+    // Same as Number, but the token is expiration time, possibly negative
+    int32_t Expire(char flag, int32_t fallback) const;
+
+    // Appends return flags to the output, fields of the item are written only if info is given
+    void AppendFlags(std::string &out, const Storage::Info *info) const;
+
+    std::string _key;
+    std::vector<std::string> _flags;
+
+    // Number of flags in use, the rest of _flags are kept for reuse
+    size_t _count;
+
+    bool _quiet;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_META_COMMAND_H
@@ -0,0 +1,41 @@
+#ifndef AFINA_EXECUTE_META_DELETE_H
+#define AFINA_EXECUTE_META_DELETE_H
+
+#include <string>
+#include <vector>
+
+#include "MetaCommand.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Meta delete
+ * md <key> <flags>*\r\n
+ *
+ * Removes the key, like "delete" does
+ *
+ * Command must write result to the output, which could be:
+ * - "HD <return flags>*" to indicate success, suppressed by "q"
+ * - "NF" to indicate that the item with this key was not found, suppressed by "q"
+ */
+class MetaDelete : public MetaCommand {
+public:
+    MetaDelete() {}
+    ~MetaDelete() {}
+
+    /**
+     * Reuses command for the next request, see MetaCommand
+     */
+    inline void Reset(const std::vector<std::string> &tokens, size_t count) { MetaCommand::Reset(tokens, count); }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+protected:
+    const char *Accepted() const override { return "kOq"; }
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_META_DELETE_H
@@ -0,0 +1,53 @@
+#ifndef AFINA_EXECUTE_META_GET_H
+#define AFINA_EXECUTE_META_GET_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MetaCommand.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Meta get
+ * mg <key> <flags>*\r\n
+ *
+ * Retrives the value and metadata of the key, both are optional: without "v" flag only return
+ * flags are sent, so clients could read metadata without the value. Flag T<ttl> changes
+ * expiration time of the item before it is read, like "touch" does
+ *
+ * Command must write result to the output, which could be:
+ * - "VA <size> <return flags>*\r\n<data>" if the value was asked for
+ * - "HD <return flags>*" if it wasn't
+ * - "EN" to indicate that the item was not found, suppressed by "q"
+ */
+class MetaGet : public MetaCommand {
+public:
+    MetaGet() : _expire(0) {}
+    ~MetaGet() {}
+
+    inline int32_t expire() const { return _expire; }
+
+    /**
+     * Reuses command for the next request, see MetaCommand
+     */
+    void Reset(const std::vector<std::string> &tokens, size_t count);
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+protected:
+    const char *Accepted() const override { return "vcstkhfOqT"; }
+
+private:
+    int32_t _expire;
+
+    // Value is read into it, it keeps capacity of the biggest one
+    std::string _value;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_META_GET_H
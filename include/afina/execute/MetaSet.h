@@ -0,0 +1,66 @@
+#ifndef AFINA_EXECUTE_META_SET_H
+#define AFINA_EXECUTE_META_SET_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MetaCommand.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Meta set
+ * ms <key> <datalen> <flags>*\r\n
+ * <data block>\r\n
+ *
+ * Stores the value in the mode given by M<mode> flag: S set, the default one, E add, R replace,
+ * A append or P prepend. Flag T<ttl> sets expiration time, C<cas> stores the value only if its
+ * version is the given one, like "cas" does, that works in set and replace modes only. Client
+ * flags F<flags> are accepted, but aren't stored
+ *
+ * Command must write result to the output, which could be:
+ * - "HD <return flags>*" to indicate success, suppressed by "q"
+ * - "NS" to indicate the data was not stored, because of the mode
+ * - "EX" to indicate that the item has been modified since it was read
+ * - "NF" to indicate that the item compared with C<cas> doesn't exist
+ */
+class MetaSet : public MetaCommand {
+public:
+    MetaSet() : _bytes(0), _mode('S'), _expire(0), _version(0) {}
+    ~MetaSet() {}
+
+    inline uint32_t bytes() const { return _bytes; }
+    inline char mode() const { return _mode; }
+    inline int32_t expire() const { return _expire; }
+    inline uint64_t version() const { return _version; }
+
+    /**
+     * Reuses command for the next request: key is followed by the data length, then flags, see
+     * MetaCommand
+     */
+    void Reset(const std::vector<std::string> &tokens, size_t count);
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+protected:
+    const char *Accepted() const override { return "ckOqTCFM"; }
+
+private:
+    // Stores the value in the requested mode, returns response code. Version is the one to compare
+    // with, it is set to the version of the stored value on success
+    const char *Store(Storage &storage, const std::string &value, uint64_t &version) const;
+
+    uint32_t _bytes;
+    char _mode;
+    int32_t _expire;
+
+    // Version to compare with, 0 if none
+    uint64_t _version;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_META_SET_H
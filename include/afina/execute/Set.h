@@ -21,6 +21,7 @@ namespace Execute {
  */
 class Set : public InsertCommand {
 public:
+    Set() {}
     Set(const std::string &key, uint32_t flags, int32_t expire) : InsertCommand(key, flags, expire) {}
     ~Set() {}
 
@@ -0,0 +1,29 @@
+#ifndef AFINA_EXECUTE_SNAPSHOT_H
+#define AFINA_EXECUTE_SNAPSHOT_H
+
+#include <string>
+
+#include "Command.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Dump storage to disk
+ * Starts writing snapshot of the storage in background, command doesn't wait for it to complete
+ *
+ * Command must write result to the output, which could be:
+ * - "OK" to indicate that snapshot has been started
+ * - "SERVER_ERROR <reason>" if snapshots aren't configured or previous one is still in progress
+ */
+class Snapshot : public Command {
+public:
+    Snapshot() {}
+    ~Snapshot() {}
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_SNAPSHOT_H
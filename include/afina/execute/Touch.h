@@ -0,0 +1,47 @@
+#ifndef AFINA_EXECUTE_TOUCH_H
+#define AFINA_EXECUTE_TOUCH_H
+
+#include <cstdint>
+#include <string>
+
+#include "Command.h"
+
+namespace Afina {
+namespace Execute {
+
+/**
+ * # Change expiration time of the key
+ * Updates expiration time of the existing item without sending its value back and forth
+ *
+ * Command must write result to the output, which could be:
+ * - "TOUCHED" to indicate success
+ * - "NOT_FOUND" to indicate that the item with this key was not found
+ */
+class Touch : public Command {
+public:
+    Touch() : _expire(0) {}
+    Touch(const std::string &key, int32_t expire) : _key(key), _expire(expire) {}
+    ~Touch() {}
+
+    inline const std::string &key() const { return _key; }
+    inline int32_t expire() const { return _expire; }
+
+    /**
+     * Reuses command for the next request
+     */
+    inline void Reset(const std::string &key, int32_t expire) {
+        _key.assign(key);
+        _expire = expire;
+    }
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override;
+
+private:
+    std::string _key;
+    int32_t _expire;
+};
+
+} // namespace Execute
+} // namespace Afina
+
+#endif // AFINA_EXECUTE_TOUCH_H
@@ -0,0 +1,138 @@
+#ifndef AFINA_LOGGING_LOGGER_H
+#define AFINA_LOGGING_LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records below this level are compiled out, see AFINA_LOG_LEVEL option of the build
+#ifndef AFINA_LOG_LEVEL
+#define AFINA_LOG_LEVEL 0
+#endif
+
+namespace Afina {
+namespace Logging {
+
+enum Level : int { Debug = 0, Info = 1, Warning = 2, Error = 3 };
+
+/**
+ * # Asynchronous logger
+ * Every thread formats records into its own buffer and copies them into its own ring, so writing
+ * a record takes neither lock nor system call. Background thread drains rings into the output
+ * descriptor every few milliseconds. If the ring is full record is dropped, so that slow output
+ * never blocks requests processing; number of dropped records is reported by the background
+ * thread.
+ *
+ * Records of different threads could be reordered within one flush interval. Until Start is
+ * called, and in the processes forked from the server, records are written synchronously.
+ *
+ * Use LOG_* macros rather than methods of the class: they check level before message is formatted
+ */
+class Logger {
+public:
+    /**
+     * Logger is never destroyed, so that threads could log until the very exit
+     */
+    static Logger &Instance();
+
+    inline bool Enabled(Level level) const { return level >= this->level.load(std::memory_order_relaxed); }
+
+    inline void SetLevel(Level level) { this->level.store(level, std::memory_order_relaxed); }
+
+    /**
+     * Starts background thread writing records to the descriptor
+     *
+     * @param fd where to write records to
+     * @param interval how often rings are drained, ms
+     */
+    void Start(int fd = 1, uint32_t interval = 10);
+
+    /**
+     * Writes out all records and stops background thread
+     */
+    void Stop();
+
+    /**
+     * Passes complete record, including trailing newline, from the calling thread to the output
+     */
+    void Write(Level level, const char *data, size_t size);
+
+    /**
+     * Parses level name: debug, info, warning or error
+     */
+    static bool ParseLevel(const std::string &name, Level &level);
+
+    // Size of the ring of each thread
+    static const size_t RingSize = 64 * 1024;
+
+private:
+    struct Ring;
+
+    Logger();
+
+    // Background thread function
+    void OnRun();
+
+    // Moves content of all rings into the output, returns false if there was nothing to write
+    bool Drain(std::string &out);
+
+    // Called in the child process after fork, there is no background thread anymore
+    static void AfterForkChild();
+
+    std::atomic<int> level;
+
+    // Background thread is running and drains rings
+    std::atomic<bool> started;
+    bool stopping;
+    int fd;
+    uint32_t interval;
+
+    // Rings of all threads ever logged something, ring of exited thread is released once empty
+    std::mutex rings_lock;
+    std::vector<std::shared_ptr<Ring>> rings;
+
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::thread flusher;
+};
+
+/**
+ * Formats one record in the thread local buffer and passes it to the logger once destroyed
+ */
+class Record {
+public:
+    Record(Level level);
+    ~Record();
+
+    Record(const Record &) = delete;
+    Record &operator=(const Record &) = delete;
+
+    std::ostream &Stream();
+
+private:
+    Level level;
+};
+
+} // namespace Logging
+} // namespace Afina
+
+#define AFINA_LOG(level, message)                                                                                      \
+    do {                                                                                                               \
+        if ((level) >= AFINA_LOG_LEVEL && Afina::Logging::Logger::Instance().Enabled(level)) {                         \
+            Afina::Logging::Record(level).Stream() << message;                                                         \
+        }                                                                                                              \
+    } while (0)
+
+#define LOG_DEBUG(message) AFINA_LOG(Afina::Logging::Debug, message)
+#define LOG_INFO(message) AFINA_LOG(Afina::Logging::Info, message)
+#define LOG_WARNING(message) AFINA_LOG(Afina::Logging::Warning, message)
+#define LOG_ERROR(message) AFINA_LOG(Afina::Logging::Error, message)
+
+#endif // AFINA_LOGGING_LOGGER_H
@@ -1,7 +1,9 @@
 #ifndef AFINA_NETWORK_SERVER_H
 #define AFINA_NETWORK_SERVER_H
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace Afina {
@@ -14,7 +16,10 @@ namespace Network {
  */
 class Server {
 public:
-    Server(std::shared_ptr<Afina::Storage> ps) : pStorage(ps) {}
+    Server(std::shared_ptr<Afina::Storage> ps)
+        : pStorage(ps), connection_output_limit(DefaultConnectionOutputLimit),
+          worker_output_limit(DefaultWorkerOutputLimit), idle_timeout(0), read_timeout(0),
+          drain_timeout(DefaultDrainTimeout) {}
     virtual ~Server() {}
 
     /**
@@ -42,12 +47,69 @@ public:
 
     virtual void addFIFO(const std::string rfifo) {};
 
+    /**
+     * Limits how many bytes of responses could wait to be sent out: to a single connection and in
+     * total by a single worker. Once limit is exceeded server stops reading from the connection
+     * until its output drains, so clients that don't read responses can't blow memory up. Zero
+     * means no limit. Must be called before Start
+     */
+    void SetOutputLimits(size_t connection, size_t worker) {
+        connection_output_limit = connection;
+        worker_output_limit = worker;
+    }
+
+    /**
+     * Close connections that are silent for too long: idle one has no command in progress, while
+     * read timeout applies to connection that has sent part of a command and got stuck. Both are
+     * in milliseconds, zero disables timeout. Must be called before Start
+     */
+    void SetTimeouts(uint32_t idle, uint32_t read) {
+        idle_timeout = idle;
+        read_timeout = read;
+    }
+
+    /**
+     * How long Stop waits for connections to get answers on commands received before it, in
+     * milliseconds. Once timeout expires remaining connections are dropped. Must be called before Start
+     */
+    void SetDrainTimeout(uint32_t timeout) { drain_timeout = timeout; }
+
+    /**
+     * Listening sockets used by the running server, so that they could be passed to the process
+     * taking over. Sockets stay owned by the server
+     */
+    virtual std::vector<int> ListeningSockets() const { return std::vector<int>(); }
+
+    /**
+     * Use already bound listening sockets, i.e received from the previous process, instead of
+     * creating new ones. Server takes ownership. Must be called before Start
+     */
+    void AdoptListeningSockets(const std::vector<int> &sockets) { adopted_sockets = sockets; }
+
+    static const size_t DefaultConnectionOutputLimit = 4 * 1024 * 1024;
+    static const size_t DefaultWorkerOutputLimit = 64 * 1024 * 1024;
+    static const uint32_t DefaultDrainTimeout = 5000;
+
 protected:
     /**
      * Instance of backing storeage on which current server should execute
      * each command
      */
     std::shared_ptr<Afina::Storage> pStorage;
+
+    // See SetOutputLimits
+    size_t connection_output_limit;
+    size_t worker_output_limit;
+
+    // See SetTimeouts
+    uint32_t idle_timeout;
+    uint32_t read_timeout;
+
+    // See SetDrainTimeout
+    uint32_t drain_timeout;
+
+    // See AdoptListeningSockets
+    std::vector<int> adopted_sockets;
 };
 
 } // namespace Network
@@ -1,7 +1,6 @@
 #include <afina/Storage.h>
 #include <afina/execute/Add.h>
-
-#include <iostream>
+#include <afina/logging/Logger.h>
 
 namespace Afina {
 namespace Execute {
@@ -9,8 +8,9 @@ namespace Execute {
 // memcached protocol:  "add" means "store this data, but only if the server *doesn't* already
 // hold data for this key".
 void Add::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::cout << "Add(" << _key << ")" << args << std::endl;
-    out = storage.PutIfAbsent(_key, args) ? "STORED" : "NOT_STORED";
+    LOG_DEBUG("Add(" << _key << ")" << args);
+    _stored = 0;
+    Reply(storage.PutIfAbsent(_key, args, Deadline(_expire), &_stored) ? rStored : rNotStored, out);
 }
 
 } // namespace Execute
@@ -1,21 +1,15 @@
 #include <afina/Storage.h>
 #include <afina/execute/Append.h>
-
-#include <iostream>
+#include <afina/logging/Logger.h>
 
 namespace Afina {
 namespace Execute {
 
 // memcached protocol: "append" means "add this data to an existing key after existing data".
 void Append::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::cout << "Append(" << _key << ")" << args << std::endl;
-    std::string value;
-    if (!storage.Get(_key, value)) {
-        out.assign("NOT_STORED");
-        return;
-    }
-    storage.Put(_key, value + args);
-    out.assign("STORED");
+    LOG_DEBUG("Append(" << _key << ")" << args);
+    _stored = 0;
+    Reply(storage.Append(_key, args, &_stored) ? rStored : rNotStored, out);
 }
 
 } // namespace Execute
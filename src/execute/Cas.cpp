@@ -0,0 +1,23 @@
+#include <afina/Storage.h>
+#include <afina/execute/Cas.h>
+#include <afina/logging/Logger.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "cas" is a check and set operation which means "store this data but only
+// if no one else has updated since I last fetched it."
+void Cas::Execute(Storage &storage, const std::string &args, std::string &out) {
+    LOG_DEBUG("Cas(" << _key << ", " << _version << "): " << args);
+    uint64_t version = _version;
+    _stored = 0;
+    if (storage.CompareAndSet(_key, args, version, Deadline(_expire))) {
+        _stored = version;
+        Reply(rStored, out);
+    } else {
+        Reply((version == 0) ? rNotFound : rExists, out);
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -1 +1,28 @@
 #include <afina/execute/Command.h>
+
+#include <ctime>
+
+namespace Afina {
+namespace Execute {
+
+namespace {
+
+// Bigger expiration times are unix time rather than relative one
+const int32_t MaxRelativeExpire = 60 * 60 * 24 * 30;
+
+} // namespace
+
+// See Command.h
+uint32_t Command::Deadline(int32_t expire) {
+    if (expire == 0) {
+        return 0;
+    } else if (expire < 0) {
+        return 1;
+    } else if (expire > MaxRelativeExpire) {
+        return expire;
+    }
+    return uint32_t(std::time(nullptr)) + expire;
+}
+
+} // namespace Execute
+} // namespace Afina
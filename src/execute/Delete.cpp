@@ -0,0 +1,15 @@
+#include <afina/Storage.h>
+#include <afina/execute/Delete.h>
+#include <afina/logging/Logger.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "delete" allows for explicit deletion of items.
+void Delete::Execute(Storage &storage, const std::string &args, std::string &out) {
+    LOG_DEBUG("Delete(" << _key << ")");
+    out = storage.Delete(_key) ? "DELETED" : "NOT_FOUND";
+}
+
+} // namespace Execute
+} // namespace Afina
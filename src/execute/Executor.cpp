@@ -1,13 +1,14 @@
 #include "../../include/afina/Executor.h"
-#include <iostream>
 #include <functional>
 
+#include <afina/logging/Logger.h>
+
 namespace Afina {
 
 Executor::Executor(std::string name, size_t _low_watermark, size_t _high_watermark, size_t _max_queue_size, std::chrono::milliseconds _idle_time)
 :low_watermark(_low_watermark),  high_watermark(_high_watermark), max_queue_size(_max_queue_size), idle_time(_idle_time), state(State::kRun)
 {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     std::lock_guard<std::mutex> lock(mutex);
     for (int i = 0; i < low_watermark; i++)
     {
@@ -16,7 +17,7 @@ Executor::Executor(std::string name, size_t _low_watermark, size_t _high_waterma
 }
 
 void Executor::Stop(bool await) {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     {
         std::lock_guard<std::mutex> lock(mutex);
         if (state == State::kRun)
@@ -38,12 +39,12 @@ void Executor::Stop(bool await) {
 }
 
 Executor::~Executor() {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     Stop(true);
 }
 
 void perform(Executor *executor) {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     std::function<void()> task;
 
     while (true)
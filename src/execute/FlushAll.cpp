@@ -0,0 +1,17 @@
+#include <afina/Storage.h>
+#include <afina/execute/FlushAll.h>
+#include <afina/logging/Logger.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "flush_all" invalidates all existing items immediately (by default) or
+// after the expiration specified.
+void FlushAll::Execute(Storage &storage, const std::string &args, std::string &out) {
+    LOG_DEBUG("FlushAll(" << _delay << ")");
+    storage.Flush(Deadline(_delay));
+    out = "OK";
+}
+
+} // namespace Execute
+} // namespace Afina
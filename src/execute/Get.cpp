@@ -1,13 +1,24 @@
 #include <afina/Storage.h>
 #include <afina/execute/Get.h>
+#include <afina/logging/Logger.h>
 
-#include <iostream>
 #include <iterator>
 #include <sstream>
 
 namespace Afina {
 namespace Execute {
 
+namespace {
+
+// Keys separated by spaces, for debug output
+std::string Join(const std::vector<std::string> &keys, size_t count) {
+    std::stringstream keyStream;
+    copy(keys.begin(), keys.begin() + count, std::ostream_iterator<std::string>(keyStream, " "));
+    return keyStream.str();
+}
+
+} // namespace
+
 /* memcached protocol:
 
 Each item sent by the server looks like this:
@@ -21,23 +32,69 @@ to indicate the end of response.
 
 */
 
+// See Get.h
+void Get::Reset(const std::vector<std::string> &keys, size_t count, bool versions, bool touch, int32_t expire) {
+    if (_keys.size() < count) {
+        _keys.resize(count);
+    }
+    for (size_t i = 0; i < count; i++) {
+        _keys[i].assign(keys[i]);
+    }
+    _count = count;
+    _versions = versions;
+    _touch = touch;
+    _expire = expire;
+    _text = true;
+}
+
+// See Get.h
+void Get::Reset(const std::string &key, bool touch, int32_t expire) {
+    if (_keys.empty()) {
+        _keys.resize(1);
+    }
+    _keys[0].assign(key);
+    _count = 1;
+    _versions = true;
+    _touch = touch;
+    _expire = expire;
+    _text = false;
+}
+
 void Get::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::stringstream keyStream;
-    copy(_keys.begin(), _keys.end(), std::ostream_iterator<std::string>(keyStream, " "));
-    std::cout << "Get(" << keyStream.str() << ")" << std::endl;
+    LOG_DEBUG("Get(" << Join(_keys, _count) << ")");
 
-    std::stringstream outStream;
+    out.clear();
+    if (!_text) {
+        _found = _touch ? storage.GetAndTouch(_keys[0], Deadline(_expire), _value, _version)
+                        : storage.Get(_keys[0], _value, _version);
+        return;
+    }
 
-    std::string value;
-    for (auto &key : _keys) {
-        if (!storage.Get(key, value))
-            continue;
-        outStream << "VALUE " << key << " 0 " << value.size() << "\r\n";
-        outStream << value << "\r\n";
+    if (_touch) {
+        uint64_t version = 0;
+        uint32_t deadline = Deadline(_expire);
+        for (size_t i = 0; i < _count; i++) {
+            if (storage.GetAndTouch(_keys[i], deadline, _value, version)) {
+                Append(out, _keys[i], _value.data(), _value.size(), version);
+            }
+        }
+    } else {
+        // Values are written right from the storage, each lock is taken once for all keys
+        storage.MultiGet(_keys.data(), _count,
+                         [this, &out](size_t index, const char *value, size_t size, uint64_t version) {
+                             Append(out, _keys[index], value, size, version);
+                         });
     }
-    outStream << "END"; // networking layer should add the last \r\n
+    out.append("END"); // networking layer should add the last \r\n
+}
 
-    out = outStream.str();
+// See Get.h
+void Get::Append(std::string &out, const std::string &key, const char *value, size_t size, uint64_t version) const {
+    out.append("VALUE ").append(key).append(" 0 ").append(std::to_string(size));
+    if (_versions) {
+        out.append(" ").append(std::to_string(version));
+    }
+    out.append("\r\n").append(value, size).append("\r\n");
 }
 
 } // namespace Execute
@@ -0,0 +1,49 @@
+#include <afina/Storage.h>
+#include <afina/execute/Incr.h>
+#include <afina/logging/Logger.h>
+
+#include <stdexcept>
+
+namespace Afina {
+namespace Execute {
+
+const char *const Incr::NonNumeric = "CLIENT_ERROR cannot increment or decrement non-numeric value";
+
+// memcached protocol: "incr" and "decr" are used to change data for some item in-place,
+// incrementing or decrementing it. The data for the item is treated as decimal representation
+// of a 64-bit unsigned integer.
+void Incr::Execute(Storage &storage, const std::string &args, std::string &out) {
+    LOG_DEBUG((_decrement ? "Decr(" : "Incr(") << _key << ", " << _delta << ")");
+    _found = false;
+    try {
+        _found = Change(storage, _key, _delta, _decrement, _create, _initial, _expire, _value);
+        if (!_found) {
+            out = "NOT_FOUND";
+            return;
+        }
+    } catch (std::runtime_error &) {
+        out = NonNumeric;
+        return;
+    }
+    out = std::to_string(_value);
+}
+
+// See Incr.h
+bool Incr::Change(Storage &storage, const std::string &key, uint64_t delta, bool decrement, bool create,
+                  uint64_t initial, int32_t expire, uint64_t &value) {
+    bool found = decrement ? storage.Decrement(key, delta, value) : storage.Increment(key, delta, value);
+    if (found || !create) {
+        return found;
+    }
+
+    if (storage.PutIfAbsent(key, std::to_string(initial), Deadline(expire))) {
+        value = initial;
+        return true;
+    }
+
+    // Somebody else has created the counter in between
+    return decrement ? storage.Decrement(key, delta, value) : storage.Increment(key, delta, value);
+}
+
+} // namespace Execute
+} // namespace Afina
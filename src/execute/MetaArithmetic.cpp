@@ -0,0 +1,74 @@
+#include <afina/Storage.h>
+#include <afina/execute/Incr.h>
+#include <afina/execute/MetaArithmetic.h>
+#include <afina/logging/Logger.h>
+
+#include <stdexcept>
+
+namespace Afina {
+namespace Execute {
+
+// See MetaArithmetic.h
+void MetaArithmetic::Reset(const std::vector<std::string> &tokens, size_t count) {
+    MetaCommand::Reset(tokens, count);
+
+    const std::string *mode = Find('M');
+    if (mode == nullptr) {
+        _decrement = false;
+    } else if (*mode == "MI" || *mode == "Mi" || *mode == "M+") {
+        _decrement = false;
+    } else if (*mode == "MD" || *mode == "Md" || *mode == "M-") {
+        _decrement = true;
+    } else {
+        throw std::runtime_error("Invalid meta arithmetic mode " + *mode);
+    }
+
+    _delta = Number('D', 1);
+    _create = Has('N');
+    _initial = Number('J', 0);
+    _vivify = Expire('N', 0);
+    _expire = Expire('T', 0);
+}
+
+// memcached protocol: "ma" is the meta arithmetic, it changes the counter like "incr" and "decr"
+// do.
+void MetaArithmetic::Execute(Storage &storage, const std::string &args, std::string &out) {
+    LOG_DEBUG("MetaArithmetic(" << _key << ", " << (_decrement ? "-" : "+") << _delta << ")");
+    uint64_t value;
+    try {
+        if (!Incr::Change(storage, _key, _delta, _decrement, _create, _initial, _vivify, value)) {
+            if (_quiet) {
+                out.clear();
+            } else {
+                out.assign("NF");
+                AppendFlags(out, nullptr);
+            }
+            return;
+        }
+    } catch (std::runtime_error &) {
+        out = Incr::NonNumeric;
+        return;
+    }
+
+    if (Has('T')) {
+        storage.Touch(_key, Deadline(_expire));
+    }
+
+    // Metadata is read after the change, so it could be the one of the change made in between
+    Storage::Info info{};
+    bool known = (!Has('c') && !Has('t')) || storage.Inspect(_key, info);
+    if (Has('v')) {
+        std::string number = std::to_string(value);
+        out.assign("VA ").append(std::to_string(number.size()));
+        AppendFlags(out, known ? &info : nullptr);
+        out.append("\r\n").append(number);
+    } else if (_quiet) {
+        out.clear();
+    } else {
+        out.assign("HD");
+        AppendFlags(out, known ? &info : nullptr);
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
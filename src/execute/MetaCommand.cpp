@@ -0,0 +1,142 @@
+#include <afina/execute/MetaCommand.h>
+
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+namespace Afina {
+namespace Execute {
+
+// See MetaCommand.h
+void MetaCommand::Reset(const std::vector<std::string> &tokens, size_t count, size_t first) {
+    if (count == 0 || tokens[0].empty()) {
+        throw std::runtime_error("Meta command requires a key");
+    }
+    _key.assign(tokens[0]);
+
+    _count = 0;
+    _quiet = false;
+    const char *accepted = Accepted();
+    for (size_t i = first; i < count; i++) {
+        const std::string &token = tokens[i];
+        if (token.empty()) {
+            // Spaces in a row
+            continue;
+        } else if (std::strchr(accepted, token[0]) == nullptr) {
+            throw std::runtime_error("Invalid meta flag " + token);
+        }
+
+        if (_flags.size() == _count) {
+            _flags.emplace_back();
+        }
+        _flags[_count++].assign(token);
+        _quiet = _quiet || token[0] == 'q';
+    }
+}
+
+// See MetaCommand.h
+const std::string *MetaCommand::Find(char flag) const {
+    for (size_t i = 0; i < _count; i++) {
+        if (_flags[i][0] == flag) {
+            return &_flags[i];
+        }
+    }
+    return nullptr;
+}
+
+// See MetaCommand.h
+uint64_t MetaCommand::Number(char flag, uint64_t fallback) const {
+    const std::string *token = Find(flag);
+    if (token == nullptr) {
+        return fallback;
+    } else if (token->size() < 2 || token->size() > 21) {
+        throw std::runtime_error("Invalid numeric meta flag " + *token);
+    }
+
+    uint64_t number = 0;
+    for (size_t i = 1; i < token->size(); i++) {
+        char c = (*token)[i];
+        if (c < '0' || c > '9' || number > (UINT64_MAX - (c - '0')) / 10) {
+            throw std::runtime_error("Invalid numeric meta flag " + *token);
+        }
+        number = number * 10 + (c - '0');
+    }
+    return number;
+}
+
+// See MetaCommand.h
+int32_t MetaCommand::Expire(char flag, int32_t fallback) const {
+    const std::string *token = Find(flag);
+    if (token == nullptr) {
+        return fallback;
+    }
+
+    bool negative = token->size() > 1 && (*token)[1] == '-';
+    size_t start = negative ? 2 : 1;
+    if (token->size() <= start || token->size() > start + 10) {
+        throw std::runtime_error("Invalid expiration time meta flag " + *token);
+    }
+
+    int64_t number = 0;
+    for (size_t i = start; i < token->size(); i++) {
+        char c = (*token)[i];
+        if (c < '0' || c > '9') {
+            throw std::runtime_error("Invalid expiration time meta flag " + *token);
+        }
+        number = number * 10 + (c - '0');
+    }
+    number = negative ? -number : number;
+    if (number > INT32_MAX || number < INT32_MIN) {
+        throw std::runtime_error("Invalid expiration time meta flag " + *token);
+    }
+    return int32_t(number);
+}
+
+// See MetaCommand.h
+void MetaCommand::AppendFlags(std::string &out, const Storage::Info *info) const {
+    for (size_t i = 0; i < _count; i++) {
+        const std::string &token = _flags[i];
+        switch (token[0]) {
+        case 'O':
+            out.append(" ").append(token);
+            break;
+        case 'k':
+            out.append(" k").append(_key);
+            break;
+        default:
+            break;
+        }
+        if (info == nullptr) {
+            continue;
+        }
+
+        switch (token[0]) {
+        case 'c':
+            out.append(" c").append(std::to_string(info->version));
+            break;
+        case 't': {
+            int64_t left = -1;
+            if (info->expire != 0) {
+                int64_t now = std::time(nullptr);
+                left = info->expire > now ? info->expire - now : 0;
+            }
+            out.append(" t").append(std::to_string(left));
+            break;
+        }
+        case 's':
+            out.append(" s").append(std::to_string(info->size));
+            break;
+        case 'h':
+            out.append(info->fetched ? " h1" : " h0");
+            break;
+        case 'f':
+            out.append(" f0");
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,24 @@
+#include <afina/Storage.h>
+#include <afina/execute/MetaDelete.h>
+#include <afina/logging/Logger.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "md" is the meta delete.
+void MetaDelete::Execute(Storage &storage, const std::string &args, std::string &out) {
+    LOG_DEBUG("MetaDelete(" << _key << ")");
+    if (_quiet) {
+        storage.Delete(_key);
+        out.clear();
+    } else if (storage.Delete(_key)) {
+        out.assign("HD");
+        AppendFlags(out, nullptr);
+    } else {
+        out.assign("NF");
+        AppendFlags(out, nullptr);
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
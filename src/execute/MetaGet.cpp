@@ -0,0 +1,42 @@
+#include <afina/Storage.h>
+#include <afina/execute/MetaGet.h>
+#include <afina/logging/Logger.h>
+
+namespace Afina {
+namespace Execute {
+
+// See MetaGet.h
+void MetaGet::Reset(const std::vector<std::string> &tokens, size_t count) {
+    MetaCommand::Reset(tokens, count);
+    _expire = Expire('T', 0);
+}
+
+// memcached protocol: "mg" is the meta get, flags select which fields of the item are returned.
+void MetaGet::Execute(Storage &storage, const std::string &args, std::string &out) {
+    LOG_DEBUG("MetaGet(" << _key << ")");
+
+    bool value = Has('v');
+    bool found = !Has('T') || storage.Touch(_key, Deadline(_expire));
+    Storage::Info info;
+    if (!found || !storage.Inspect(_key, info, value ? &_value : nullptr)) {
+        if (_quiet) {
+            out.clear();
+        } else {
+            out.assign("EN");
+            AppendFlags(out, nullptr);
+        }
+        return;
+    }
+
+    if (value) {
+        out.assign("VA ").append(std::to_string(info.size));
+        AppendFlags(out, &info);
+        out.append("\r\n").append(_value); // networking layer should add the last \r\n
+    } else {
+        out.assign("HD");
+        AppendFlags(out, &info);
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
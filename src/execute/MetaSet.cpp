@@ -0,0 +1,89 @@
+#include <afina/Storage.h>
+#include <afina/execute/MetaSet.h>
+#include <afina/logging/Logger.h>
+
+#include <cctype>
+#include <stdexcept>
+
+namespace Afina {
+namespace Execute {
+
+// See MetaSet.h
+void MetaSet::Reset(const std::vector<std::string> &tokens, size_t count) {
+    MetaCommand::Reset(tokens, count, 2);
+    if (count < 2 || tokens[1].empty() || tokens[1].size() > 10 ||
+        tokens[1].find_first_not_of("0123456789") != std::string::npos || std::stoull(tokens[1]) > UINT32_MAX) {
+        throw std::runtime_error("Meta set requires data length");
+    }
+    _bytes = uint32_t(std::stoul(tokens[1]));
+
+    const std::string *mode = Find('M');
+    _mode = (mode == nullptr) ? 'S' : (mode->size() == 2 ? std::toupper((*mode)[1]) : '?');
+    if (_mode != 'S' && _mode != 'E' && _mode != 'R' && _mode != 'A' && _mode != 'P') {
+        throw std::runtime_error("Invalid meta set mode " + *mode);
+    }
+
+    _expire = Expire('T', 0);
+    _version = Number('C', 0);
+    if (Has('C') && _mode != 'S' && _mode != 'R') {
+        throw std::runtime_error("Meta set compares version in set and replace modes only");
+    }
+
+    // Client flags aren't stored, but must be valid
+    Number('F', 0);
+}
+
+// memcached protocol: "ms" is the meta set, flags select how the data is stored.
+void MetaSet::Execute(Storage &storage, const std::string &args, std::string &out) {
+    LOG_DEBUG("MetaSet(" << _key << ", " << _mode << "): " << args);
+
+    Storage::Info info{};
+    info.version = _version;
+    const char *code = Store(storage, args, info.version);
+    if (code[0] != 'H') {
+        out.assign(code);
+        AppendFlags(out, nullptr);
+        return;
+    } else if (_quiet) {
+        out.clear();
+        return;
+    }
+
+    // Storage reports the version of the stored value, so it is never the one of a later change
+    out.assign(code);
+    AppendFlags(out, &info);
+}
+
+// See MetaSet.h
+const char *MetaSet::Store(Storage &storage, const std::string &value, uint64_t &version) const {
+    uint32_t deadline = Deadline(_expire);
+    if (Has('C')) {
+        if (storage.CompareAndSet(_key, value, version, deadline)) {
+            return "HD";
+        }
+        return (version == 0) ? "NF" : "EX";
+    }
+
+    bool stored;
+    switch (_mode) {
+    case 'E':
+        stored = storage.PutIfAbsent(_key, value, deadline, &version);
+        break;
+    case 'R':
+        stored = storage.Set(_key, value, deadline, &version);
+        break;
+    case 'A':
+        stored = storage.Append(_key, value, &version);
+        break;
+    case 'P':
+        stored = storage.Prepend(_key, value, &version);
+        break;
+    default:
+        stored = storage.Put(_key, value, deadline, &version);
+        break;
+    }
+    return stored ? "HD" : "NS";
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,16 @@
+#include <afina/Storage.h>
+#include <afina/execute/Prepend.h>
+#include <afina/logging/Logger.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "prepend" means "add this data to an existing key before existing data".
+void Prepend::Execute(Storage &storage, const std::string &args, std::string &out) {
+    LOG_DEBUG("Prepend(" << _key << ")" << args);
+    _stored = 0;
+    Reply(storage.Prepend(_key, args, &_stored) ? rStored : rNotStored, out);
+}
+
+} // namespace Execute
+} // namespace Afina
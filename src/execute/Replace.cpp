@@ -1,7 +1,6 @@
 #include <afina/Storage.h>
 #include <afina/execute/Replace.h>
-
-#include <iostream>
+#include <afina/logging/Logger.h>
 
 namespace Afina {
 namespace Execute {
@@ -10,14 +9,9 @@ namespace Execute {
 // already hold data for this key".
 
 void Replace::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::cout << "Replace(" << _key << "): " << args << std::endl;
-    std::string value;
-    if (storage.Get(_key, value)) {
-        storage.Set(_key, args);
-        out = "STORED";
-    } else {
-        out = "NOT_STORED";
-    }
+    LOG_DEBUG("Replace(" << _key << "): " << args);
+    _stored = 0;
+    Reply(storage.Set(_key, args, Deadline(_expire), &_stored) ? rStored : rNotStored, out);
 }
 
 } // namespace Execute
@@ -1,16 +1,16 @@
 #include <afina/Storage.h>
 #include <afina/execute/Set.h>
-
-#include <iostream>
+#include <afina/logging/Logger.h>
 
 namespace Afina {
 namespace Execute {
 
 // memcached protocol: "set" means "store this data".
 void Set::Execute(Storage &storage, const std::string &args, std::string &out) {
-    std::cout << "Set(" << _key << "): " << args << std::endl;
-    storage.Put(_key, args);
-    out = "STORED";
+    LOG_DEBUG("Set(" << _key << "): " << args);
+    _stored = 0;
+    storage.Put(_key, args, Deadline(_expire), &_stored);
+    Reply(rStored, out);
 }
 
 } // namespace Execute
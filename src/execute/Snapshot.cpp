@@ -0,0 +1,17 @@
+#include <afina/Storage.h>
+#include <afina/execute/Snapshot.h>
+
+namespace Afina {
+namespace Execute {
+
+// See Snapshot.h
+void Snapshot::Execute(Storage &storage, const std::string &args, std::string &out) {
+    if (storage.Snapshot()) {
+        out.assign("OK");
+    } else {
+        out.assign("SERVER_ERROR snapshot is disabled or in progress");
+    }
+}
+
+} // namespace Execute
+} // namespace Afina
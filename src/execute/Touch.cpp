@@ -0,0 +1,16 @@
+#include <afina/Storage.h>
+#include <afina/execute/Touch.h>
+#include <afina/logging/Logger.h>
+
+namespace Afina {
+namespace Execute {
+
+// memcached protocol: "touch" is used to update the expiration time of an existing item
+// without fetching it.
+void Touch::Execute(Storage &storage, const std::string &args, std::string &out) {
+    LOG_DEBUG("Touch(" << _key << ", " << _expire << ")");
+    out = storage.Touch(_key, Deadline(_expire)) ? "TOUCHED" : "NOT_FOUND";
+}
+
+} // namespace Execute
+} // namespace Afina
@@ -0,0 +1,234 @@
+#include <afina/logging/Logger.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <streambuf>
+
+#include <pthread.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Logging {
+
+namespace {
+
+// Record is formatted right into the string, it keeps its capacity between records
+class LineBuffer : public std::streambuf {
+public:
+    std::string line;
+
+protected:
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) {
+            line.push_back(char(c));
+        }
+        return c;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        line.append(s, n);
+        return n;
+    }
+};
+
+struct LocalRecord {
+    LocalRecord() : stream(&buffer) {}
+
+    LineBuffer buffer;
+    std::ostream stream;
+};
+
+LocalRecord &Local() {
+    thread_local LocalRecord record;
+    return record;
+}
+
+const char *const Prefixes[] = {"[D] ", "[I] ", "[W] ", "[E] "};
+
+void WriteAll(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            return;
+        }
+        data += n;
+        size -= n;
+    }
+}
+
+} // namespace
+
+// Single producer, single consumer ring of records, positions grow infinitely
+struct Logger::Ring {
+    Ring() : data(new char[RingSize]), head(0), tail(0), dropped(0) {}
+
+    std::unique_ptr<char[]> data;
+
+    // Written by the thread owning the ring
+    std::atomic<size_t> head;
+
+    // Written by the background thread
+    std::atomic<size_t> tail;
+
+    std::atomic<size_t> dropped;
+};
+
+const size_t Logger::RingSize;
+
+// See Logger.h
+Logger &Logger::Instance() {
+    static Logger *instance = new Logger();
+    return *instance;
+}
+
+// See Logger.h
+Logger::Logger() : level(Info), started(false), stopping(false), fd(1), interval(10) {
+    pthread_atfork(nullptr, nullptr, AfterForkChild);
+}
+
+// See Logger.h
+void Logger::Start(int fd, uint32_t interval) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (started.load()) {
+        return;
+    }
+
+    this->fd = fd;
+    this->interval = interval;
+    stopping = false;
+    flusher = std::thread(&Logger::OnRun, this);
+    started.store(true, std::memory_order_release);
+}
+
+// See Logger.h
+void Logger::Stop() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!started.load()) {
+            return;
+        }
+        stopping = true;
+    }
+    wakeup.notify_one();
+    flusher.join();
+
+    // Threads logging from now on write synchronously, pick up what they left in rings
+    started.store(false, std::memory_order_release);
+    std::string out;
+    if (Drain(out)) {
+        WriteAll(fd, out.data(), out.size());
+    }
+}
+
+// See Logger.h
+void Logger::Write(Level level, const char *data, size_t size) {
+    if (!started.load(std::memory_order_acquire)) {
+        WriteAll(fd, data, size);
+        return;
+    }
+
+    thread_local std::shared_ptr<Ring> ring;
+    if (!ring) {
+        ring = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> guard(rings_lock);
+        rings.push_back(ring);
+    }
+
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    size_t tail = ring->tail.load(std::memory_order_acquire);
+    if (size > RingSize - (head - tail)) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    size_t offset = head % RingSize;
+    size_t first = std::min(size, RingSize - offset);
+    std::memcpy(ring->data.get() + offset, data, first);
+    std::memcpy(ring->data.get(), data + first, size - first);
+    ring->head.store(head + size, std::memory_order_release);
+
+    if (level >= Error) {
+        wakeup.notify_one();
+    }
+}
+
+// See Logger.h
+bool Logger::ParseLevel(const std::string &name, Level &level) {
+    const char *names[] = {"debug", "info", "warning", "error"};
+    for (int i = Debug; i <= Error; i++) {
+        if (name == names[i]) {
+            level = Level(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// See Logger.h
+void Logger::OnRun() {
+    std::string out;
+    std::unique_lock<std::mutex> guard(lock);
+    while (!stopping) {
+        wakeup.wait_for(guard, std::chrono::milliseconds(interval));
+        guard.unlock();
+
+        out.clear();
+        if (Drain(out)) {
+            WriteAll(fd, out.data(), out.size());
+        }
+        guard.lock();
+    }
+}
+
+// See Logger.h
+bool Logger::Drain(std::string &out) {
+    size_t dropped = 0;
+    std::lock_guard<std::mutex> guard(rings_lock);
+    for (auto it = rings.begin(); it != rings.end();) {
+        Ring &ring = **it;
+        size_t tail = ring.tail.load(std::memory_order_relaxed);
+        size_t head = ring.head.load(std::memory_order_acquire);
+
+        size_t offset = tail % RingSize;
+        size_t first = std::min(head - tail, RingSize - offset);
+        out.append(ring.data.get() + offset, first);
+        out.append(ring.data.get(), head - tail - first);
+        ring.tail.store(head, std::memory_order_release);
+        dropped += ring.dropped.exchange(0, std::memory_order_relaxed);
+
+        // Nobody else holds the ring, so its thread has exited and there is nothing more to come
+        if (it->use_count() == 1) {
+            it = rings.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    if (dropped > 0) {
+        out.append(Prefixes[Warning]).append(std::to_string(dropped)).append(" log records dropped\n");
+    }
+    return !out.empty();
+}
+
+// See Logger.h
+void Logger::AfterForkChild() { Instance().started.store(false, std::memory_order_release); }
+
+// See Logger.h
+Record::Record(Level level) : level(level) { Local().buffer.line.assign(Prefixes[level]); }
+
+// See Logger.h
+Record::~Record() {
+    std::string &line = Local().buffer.line;
+    line.push_back('\n');
+    Logger::Instance().Write(level, line.data(), line.size());
+}
+
+// See Logger.h
+std::ostream &Record::Stream() { return Local().stream; }
+
+} // namespace Logging
+} // namespace Afina
@@ -1,18 +1,29 @@
 #include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <thread>
+#include <unistd.h>
 #include <uv.h>
 
 #include <cxxopts.hpp>
 
 #include <afina/Storage.h>
 #include <afina/Version.h>
+#include <afina/logging/Logger.h>
 #include <afina/network/Server.h>
 
+#include "network/Handoff.h"
 #include "network/blocking/ServerImpl.h"
 #include "network/nonblocking/ServerImpl.h"
 #include "network/uv/ServerImpl.h"
+#ifdef HAVE_IO_URING
+#include "network/uring/ServerImpl.h"
+#endif
 #include "storage/MapBasedGlobalLockImpl.h"
+#include "storage/MapBasedStripedLockImpl.h"
+#include "storage/SharedMemoryImpl.h"
+#include "storage/SnapshotStorage.h"
 
 typedef struct {
     std::shared_ptr<Afina::Storage> storage;
@@ -23,14 +34,47 @@ typedef struct {
 void signal_handler(uv_signal_t *handle, int signum) {
     Application *pApp = static_cast<Application *>(handle->data);
 
-    std::cout << "Receive stop signal" << std::endl;
+    LOG_INFO("Receive stop signal");
     uv_stop(handle->loop);
 }
 
+// Called when it is time to take periodic snapshot
+void snapshot_handler(uv_timer_t *handle) {
+    Application *pApp = static_cast<Application *>(handle->data);
+    if (!pApp->storage->Snapshot()) {
+        LOG_WARNING("Skip periodic snapshot, previous one is still in progress");
+    }
+}
+
+// Called when process replacing this one asks for listening sockets
+void handoff_handler(uv_stream_t *handle, int status) {
+    Application *pApp = static_cast<Application *>(handle->data);
+    if (status != 0) {
+        LOG_ERROR("Failed to accept handoff request: " << uv_strerror(status));
+        return;
+    }
+
+    uv_pipe_t *client = new uv_pipe_t;
+    uv_pipe_init(handle->loop, client, 0);
+    if (uv_accept(handle, (uv_stream_t *)client) == 0) {
+        uv_os_fd_t fd;
+        uv_fileno((uv_handle_t *)client, &fd);
+        try {
+            Afina::Network::SendSockets(fd, pApp->server->ListeningSockets());
+            LOG_INFO("Listening sockets handed off, stopping");
+            uv_close((uv_handle_t *)handle, nullptr);
+            uv_stop(handle->loop);
+        } catch (std::runtime_error &ex) {
+            LOG_ERROR("Failed to hand off sockets: " << ex.what());
+        }
+    }
+    uv_close((uv_handle_t *)client, [](uv_handle_t *h) { delete (uv_pipe_t *)h; });
+}
+
 // Called when it is time to collect passive metrics from services
 void timer_handler(uv_timer_t *handle) {
     Application *pApp = static_cast<Application *>(handle->data);
-    std::cout << "Start passive metrics collection" << std::endl;
+    LOG_DEBUG("Start passive metrics collection");
 }
 
 int main(int argc, char **argv) {
@@ -53,9 +97,49 @@ int main(int argc, char **argv) {
         // TODO: use custom cxxopts::value to print options possible values in help message
         // and simplify validation below
         options.add_options()("s,storage", "Type of storage service to use", cxxopts::value<std::string>());
+        options.add_options()("shm-path", "File backing shm storage, default /dev/shm/afina",
+                              cxxopts::value<std::string>());
+        options.add_options()("shm-size", "Size of shm storage in megabytes, used only when it is created, default 64",
+                              cxxopts::value<size_t>());
+        options.add_options()("snapshot", "File to write storage snapshots to, enables snapshot command",
+                              cxxopts::value<std::string>());
+        options.add_options()("snapshot-interval", "Take snapshot every that many seconds", cxxopts::value<uint32_t>());
+        options.add_options()("snapshot-load", "Load snapshot file into the storage on start");
+        options.add_options()("aof", "Journal changes to the file, requires --snapshot. Journal is replayed on start",
+                              cxxopts::value<std::string>());
+        options.add_options()("aof-prefix", "Journal only changes of keys starting with the prefix",
+                              cxxopts::value<std::string>());
+        options.add_options()("aof-sync-interval", "Sync journal at least every that many milliseconds, default 100",
+                              cxxopts::value<uint32_t>());
+        options.add_options()("aof-sync-ops", "Sync journal once that many changes are queued, default 1000",
+                              cxxopts::value<size_t>());
         options.add_options()("n,network", "Type of network service to use", cxxopts::value<std::string>());
         options.add_options()("r,readfifo", "Readfifo mode", cxxopts::value<std::string>());
         //options.add_options()("w,writefifo", "Writefifo mode", cxxopts::value<std::string>());
+        options.add_options()("incoming-cpu", "Pin nonblocking workers to cpus and steer connections to them");
+        options.add_options()("max-connection-output", "Stop reading from connection once that many bytes of its "
+                                                        "responses are unsent, 0 for no limit",
+                              cxxopts::value<size_t>());
+        options.add_options()("max-worker-output", "Stop reading from connections of a worker once that many bytes of "
+                                                    "its responses are unsent, 0 for no limit",
+                              cxxopts::value<size_t>());
+        options.add_options()("idle-timeout", "Close connection without commands in progress after that many "
+                                               "seconds of silence, 0 to keep forever",
+                              cxxopts::value<uint32_t>());
+        options.add_options()("read-timeout", "Close connection that has sent part of a command and then stayed "
+                                               "silent for that many seconds, 0 to wait forever",
+                              cxxopts::value<uint32_t>());
+        options.add_options()("drain-timeout", "On shutdown wait that many seconds for responses to commands "
+                                                "already received, default 5",
+                              cxxopts::value<uint32_t>());
+        options.add_options()("handoff", "Listen on the unix socket at the given path and pass listening sockets "
+                                          "to the process connected to it, then stop",
+                              cxxopts::value<std::string>());
+        options.add_options()("takeover", "Take listening sockets from the running process started with --handoff "
+                                           "at the given path instead of binding new ones",
+                              cxxopts::value<std::string>());
+        options.add_options()("log-level", "Minimal level of log records: debug, info, warning or error, default info",
+                              cxxopts::value<std::string>());
         options.add_options()("h,help", "Print usage info");
         options.parse(argc, argv);
 
@@ -68,9 +152,20 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    // Records are written synchronously until services are started
+    Afina::Logging::Logger &logger = Afina::Logging::Logger::Instance();
+    if (options.count("log-level") > 0) {
+        Afina::Logging::Level level;
+        if (!Afina::Logging::Logger::ParseLevel(options["log-level"].as<std::string>(), level)) {
+            std::cerr << "Error: unknown log level " << options["log-level"].as<std::string>() << std::endl;
+            return 1;
+        }
+        logger.SetLevel(level);
+    }
+
     // Start boot sequence
     Application app;
-    std::cout << "Starting " << app_string.str() << std::endl;
+    LOG_INFO("Starting " << app_string.str());
 
     // Build new storage instance
     std::string storage_type = "map_global";
@@ -80,10 +175,50 @@ int main(int argc, char **argv) {
 
     if (storage_type == "map_global") {
         app.storage = std::make_shared<Afina::Backend::MapBasedGlobalLockImpl>();
+    } else if (storage_type == "map_sharded") {
+        app.storage = std::make_shared<Afina::Backend::MapBasedStripedLockImpl>();
+    } else if (storage_type == "shm") {
+        std::string path = "/dev/shm/afina";
+        size_t size = Afina::Backend::SharedMemoryImpl::DefaultSize;
+        if (options.count("shm-path") > 0) {
+            path = options["shm-path"].as<std::string>();
+        }
+        if (options.count("shm-size") > 0) {
+            size = options["shm-size"].as<size_t>() * 1024 * 1024;
+        }
+        app.storage = std::make_shared<Afina::Backend::SharedMemoryImpl>(path, size);
     } else {
         throw std::runtime_error("Unknown storage type");
     }
 
+    std::shared_ptr<Afina::Backend::SnapshotStorage> snapshots;
+    if (options.count("snapshot") > 0) {
+        std::string path = options["snapshot"].as<std::string>();
+        snapshots = std::make_shared<Afina::Backend::SnapshotStorage>(app.storage, path);
+        app.storage = snapshots;
+    }
+
+    if (options.count("aof") > 0) {
+        if (!snapshots) {
+            std::cerr << "Error: --aof requires --snapshot" << std::endl;
+            return 1;
+        }
+
+        std::string prefix;
+        uint32_t sync_interval = 100;
+        size_t sync_ops = 1000;
+        if (options.count("aof-prefix") > 0) {
+            prefix = options["aof-prefix"].as<std::string>();
+        }
+        if (options.count("aof-sync-interval") > 0) {
+            sync_interval = options["aof-sync-interval"].as<uint32_t>();
+        }
+        if (options.count("aof-sync-ops") > 0) {
+            sync_ops = options["aof-sync-ops"].as<size_t>();
+        }
+        snapshots->EnableJournal(options["aof"].as<std::string>(), sync_interval, sync_ops, prefix);
+    }
+
     // Build  & start network layer
     std::string network_type = "uv";
     if (options.count("network") > 0) {
@@ -93,7 +228,7 @@ int main(int argc, char **argv) {
     if (options.count("readfifo") > 0) {
         rfifo_mode = true;
         rfifo = options["readfifo"].as<std::string>();
-        std::cout << "rfifo: " << rfifo << std::endl;
+        LOG_INFO("rfifo: " << rfifo);
     }
 
     //if (options.count("writefifo") > 0) {
@@ -107,15 +242,68 @@ int main(int argc, char **argv) {
     } else if (network_type == "blocking") {
         app.server = std::make_shared<Afina::Network::Blocking::ServerImpl>(app.storage);
     } else if (network_type == "nonblocking") {
-        app.server = std::make_shared<Afina::Network::NonBlocking::ServerImpl>(app.storage);
+        auto server = std::make_shared<Afina::Network::NonBlocking::ServerImpl>(app.storage);
         if (rfifo_mode)
         {
-            app.server->addFIFO(rfifo);
+            server->addFIFO(rfifo);
+        }
+        server->SetCPUSteering(options.count("incoming-cpu") > 0);
+        app.server = server;
+    } else if (network_type == "uring") {
+#ifdef HAVE_IO_URING
+        if (Afina::Network::Uring::ServerImpl::Supported()) {
+            app.server = std::make_shared<Afina::Network::Uring::ServerImpl>(app.storage);
+        } else
+#endif
+        {
+            LOG_WARNING("io_uring is not supported, fall back to nonblocking network");
+            app.server = std::make_shared<Afina::Network::NonBlocking::ServerImpl>(app.storage);
         }
     } else {
         throw std::runtime_error("Unknown network type");
     }
 
+    size_t connection_output_limit = Afina::Network::Server::DefaultConnectionOutputLimit;
+    size_t worker_output_limit = Afina::Network::Server::DefaultWorkerOutputLimit;
+    if (options.count("max-connection-output") > 0) {
+        connection_output_limit = options["max-connection-output"].as<size_t>();
+    }
+    if (options.count("max-worker-output") > 0) {
+        worker_output_limit = options["max-worker-output"].as<size_t>();
+    }
+    app.server->SetOutputLimits(connection_output_limit, worker_output_limit);
+
+    // Servers keep timeouts in milliseconds as uint32_t, and nonblocking one sleeps for them in a single
+    // epoll_wait taking int, so anything longer than about 24 days can't be represented
+    for (const char *name : {"idle-timeout", "read-timeout", "drain-timeout"}) {
+        if (options.count(name) > 0 && options[name].as<uint32_t>() > INT32_MAX / 1000) {
+            std::cerr << "Error: --" << name << " must not exceed " << INT32_MAX / 1000 << " seconds" << std::endl;
+            return 1;
+        }
+    }
+
+    uint32_t idle_timeout = 0, read_timeout = 0;
+    if (options.count("idle-timeout") > 0) {
+        idle_timeout = options["idle-timeout"].as<uint32_t>() * 1000;
+    }
+    if (options.count("read-timeout") > 0) {
+        read_timeout = options["read-timeout"].as<uint32_t>() * 1000;
+    }
+    app.server->SetTimeouts(idle_timeout, read_timeout);
+
+    if (options.count("drain-timeout") > 0) {
+        app.server->SetDrainTimeout(options["drain-timeout"].as<uint32_t>() * 1000);
+    }
+
+    if (options.count("takeover") > 0) {
+        try {
+            app.server->AdoptListeningSockets(Afina::Network::ReceiveSockets(options["takeover"].as<std::string>()));
+        } catch (std::runtime_error &ex) {
+            LOG_ERROR("Failed to take over listening sockets: " << ex.what());
+            return 1;
+        }
+    }
+
     // Init local loop. It will react to signals and performs some metrics collections. Each
     // subsystem is able to push metrics actively, but some metrics could be collected only
     // by polling, so loop here will does that work
@@ -141,13 +329,49 @@ int main(int argc, char **argv) {
     timer.data = &app;
     uv_timer_start(&timer, timer_handler, 0, 5000);
 
+    uv_timer_t snapshot_timer;
+    uv_timer_init(&loop, &snapshot_timer);
+    snapshot_timer.data = &app;
+    if (snapshots && options.count("snapshot-interval") > 0) {
+        uint64_t interval = options["snapshot-interval"].as<uint32_t>() * 1000ULL;
+        uv_timer_start(&snapshot_timer, snapshot_handler, interval, interval);
+    }
+
+    uv_pipe_t handoff;
+    std::string handoff_path;
+    if (options.count("handoff") > 0) {
+        handoff_path = options["handoff"].as<std::string>();
+    }
+
     // Start services
     try {
+        logger.Start();
         app.storage->Start();
+        if (snapshots && (options.count("snapshot-load") > 0 || options.count("aof") > 0)) {
+            auto start = std::chrono::steady_clock::now();
+            size_t loaded = snapshots->Load(std::max(1u, std::thread::hardware_concurrency()));
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+            LOG_INFO("Loaded " << loaded << " items from snapshot in " << ms << "ms");
+        }
         app.server->Start(8080, 10);
 
+        if (!handoff_path.empty()) {
+            // Stale socket is left by the process that handed off to us or has crashed
+            unlink(handoff_path.c_str());
+            uv_pipe_init(&loop, &handoff, 0);
+            handoff.data = &app;
+            int rc = uv_pipe_bind(&handoff, handoff_path.c_str());
+            if (rc == 0) {
+                rc = uv_listen((uv_stream_t *)&handoff, 1, handoff_handler);
+            }
+            if (rc != 0) {
+                throw std::runtime_error(std::string("Failed to listen for handoff: ") + uv_strerror(rc));
+            }
+        }
+
         // Freeze current thread and process events
-        std::cout << "Application started" << std::endl;
+        LOG_INFO("Application started");
         uv_run(&loop, UV_RUN_DEFAULT);
 
         // Stop services
@@ -155,10 +379,11 @@ int main(int argc, char **argv) {
         app.server->Join();
         app.storage->Stop();
 
-        std::cout << "Application stopped" << std::endl;
+        LOG_INFO("Application stopped");
     } catch (std::exception &e) {
-        std::cerr << "Fatal error" << e.what() << std::endl;
+        LOG_ERROR("Fatal error" << e.what());
     }
+    logger.Stop();
 
     return 0;
 }
@@ -0,0 +1,118 @@
+#include "Handoff.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Network {
+
+namespace {
+
+// Kernel refuses to pass more descriptors in a single message
+const size_t MaxSockets = 253;
+
+} // namespace
+
+// See Handoff.h
+void SendSockets(int unix_socket, const std::vector<int> &sockets) {
+    if (sockets.size() > MaxSockets) {
+        throw std::runtime_error("Too many sockets to hand off");
+    }
+
+    // Number of sockets goes as a payload as well, so that receiver could tell an empty list from
+    // a truncated message
+    uint32_t count = sockets.size();
+    struct iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len = sizeof(count);
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * MaxSockets));
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (count > 0) {
+        msg.msg_control = control.data();
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+        std::memcpy(CMSG_DATA(cmsg), sockets.data(), sizeof(int) * count);
+    }
+
+    ssize_t rc;
+    do {
+        rc = sendmsg(unix_socket, &msg, MSG_NOSIGNAL);
+    } while (rc < 0 && errno == EINTR);
+    if (rc != sizeof(count)) {
+        throw std::runtime_error(std::string("Failed to send sockets: ") + std::strerror(errno));
+    }
+}
+
+// See Handoff.h
+std::vector<int> ReceiveSockets(const std::string &path) {
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Handoff socket path is too long");
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open handoff socket");
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        throw std::runtime_error(std::string("Failed to connect to ") + path + ": " + std::strerror(errno));
+    }
+
+    uint32_t count = 0;
+    struct iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len = sizeof(count);
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * MaxSockets));
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    ssize_t rc;
+    do {
+        rc = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    } while (rc < 0 && errno == EINTR);
+    close(fd);
+
+    std::vector<int> sockets;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            size_t offset = sockets.size();
+            sockets.resize(offset + n);
+            std::memcpy(&sockets[offset], CMSG_DATA(cmsg), sizeof(int) * n);
+        }
+    }
+
+    if (rc != sizeof(count) || (msg.msg_flags & MSG_CTRUNC) || sockets.size() != count) {
+        for (int s : sockets) {
+            close(s);
+        }
+        throw std::runtime_error("Failed to receive sockets from the running process");
+    }
+    return sockets;
+}
+
+} // namespace Network
+} // namespace Afina
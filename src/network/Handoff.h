@@ -0,0 +1,30 @@
+#ifndef AFINA_NETWORK_HANDOFF_H
+#define AFINA_NETWORK_HANDOFF_H
+
+#include <string>
+#include <vector>
+
+namespace Afina {
+namespace Network {
+
+/**
+ * # Listening sockets handoff
+ * Running process passes its listening sockets to the one replacing it over a unix socket using
+ * SCM_RIGHTS, so the port is never closed during restart: new process starts accepting on the very
+ * same sockets while the old one drains its connections
+ */
+
+/**
+ * Sends sockets over the connected unix socket, descriptors stay open in the calling process
+ */
+void SendSockets(int unix_socket, const std::vector<int> &sockets);
+
+/**
+ * Connects to the unix socket at the given path and receives sockets sent by SendSockets
+ */
+std::vector<int> ReceiveSockets(const std::string &path);
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_HANDOFF_H
@@ -0,0 +1,119 @@
+#include "TimerWheel.h"
+
+#include <stdexcept>
+
+namespace Afina {
+namespace Network {
+
+// See TimerWheel.h
+TimerWheel::TimerWheel(uint64_t _tick, size_t n_slots)
+    : slots(n_slots), mask(n_slots - 1), tick(_tick), current(0), size(0) {
+    if (n_slots == 0 || (n_slots & (n_slots - 1)) != 0) {
+        throw std::runtime_error("Number of timer wheel slots must be a power of two");
+    }
+    if (tick == 0) {
+        throw std::runtime_error("Timer wheel tick must be positive");
+    }
+    for (auto &head : slots) {
+        head.prev = head.next = &head;
+    }
+}
+
+// See TimerWheel.h
+TimerWheel::~TimerWheel() {
+    // Owners could outlive wheel, leave their timers in a consistent state
+    for (auto &head : slots) {
+        while (head.next != &head) {
+            Cancel(head.next);
+        }
+    }
+}
+
+// See TimerWheel.h
+void TimerWheel::Reset(uint64_t now) { current = now / tick; }
+
+// See TimerWheel.h
+void TimerWheel::Schedule(Timer *timer, uint64_t deadline) {
+    Cancel(timer);
+    timer->deadline = deadline;
+    Link(timer);
+    size++;
+}
+
+// See TimerWheel.h
+void TimerWheel::Cancel(Timer *timer) {
+    if (!timer->Scheduled()) {
+        return;
+    }
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->prev = timer->next = nullptr;
+    size--;
+}
+
+// See TimerWheel.h
+void TimerWheel::Advance(uint64_t now, std::vector<Timer *> &expired) {
+    uint64_t target = now / tick;
+    if (target <= current) {
+        return;
+    }
+
+    // No need to walk the same slot twice, one turn of the wheel visits everything
+    uint64_t from = current + 1;
+    if (target - current > slots.size()) {
+        from = target - slots.size() + 1;
+    }
+    current = target;
+
+    for (uint64_t t = from; t <= target && size > 0; t++) {
+        Timer *head = &slots[t & mask];
+        if (head->next == head) {
+            continue;
+        }
+
+        // Detach the whole slot first, timers that are not due yet get linked again and could
+        // land in the very same slot
+        Timer *timer = head->next;
+        head->prev->next = nullptr;
+        head->prev = head->next = head;
+
+        while (timer != nullptr) {
+            Timer *next = timer->next;
+            if (timer->deadline <= now) {
+                timer->prev = timer->next = nullptr;
+                size--;
+                expired.push_back(timer);
+            } else {
+                Link(timer);
+            }
+            timer = next;
+        }
+    }
+}
+
+// See TimerWheel.h
+int TimerWheel::NextTimeout(uint64_t now) const {
+    if (size == 0) {
+        return -1;
+    }
+    uint64_t next = (current + 1) * tick;
+    return next > now ? int(next - now) : 0;
+}
+
+// See TimerWheel.h
+void TimerWheel::Link(Timer *timer) {
+    // Timer due in the past or in the current tick is handled on the next one
+    uint64_t t = timer->deadline / tick;
+    if (t <= current) {
+        t = current + 1;
+    }
+
+    Timer *head = &slots[t & mask];
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,95 @@
+#ifndef AFINA_NETWORK_TIMER_WHEEL_H
+#define AFINA_NETWORK_TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Afina {
+namespace Network {
+
+/**
+ * # Hashed timer wheel
+ * Keeps deadlines of many timers (i.e connection timeouts) at O(1) cost for every operation. Timers are
+ * intrusive: owner embeds Timer and the wheel only links it into the slot of its deadline tick. Deadline
+ * could be moved forward just by updating Timer::deadline field, timer gets relinked lazily once its
+ * old slot comes, so refreshing timeout on every request costs nothing.
+ *
+ * Time is measured in milliseconds of any monotonic clock chosen by the owner. Not threadsafe
+ */
+class TimerWheel {
+public:
+    struct Timer {
+        Timer() : prev(nullptr), next(nullptr), deadline(0), data(nullptr) {}
+
+        // Links in the slot list, both are nullptr if timer isn't scheduled
+        Timer *prev;
+        Timer *next;
+
+        // Moment timer fires at, could be increased at any time without rescheduling
+        uint64_t deadline;
+
+        // Owner of the timer
+        void *data;
+
+        inline bool Scheduled() const { return prev != nullptr; }
+    };
+
+    /**
+     * @param tick wheel resolution in milliseconds
+     * @param slots number of slots, must be a power of two. Deadlines further than tick * slots
+     * are fine, such timers just get relinked on each turn of the wheel
+     */
+    TimerWheel(uint64_t tick = 100, size_t slots = 1024);
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    /**
+     * Sets current time, must be called before any timer is scheduled
+     */
+    void Reset(uint64_t now);
+
+    /**
+     * Schedule timer to fire at the given deadline, timer that is already scheduled gets moved
+     */
+    void Schedule(Timer *timer, uint64_t deadline);
+
+    /**
+     * Remove timer from the wheel, does nothing if timer isn't scheduled
+     */
+    void Cancel(Timer *timer);
+
+    /**
+     * Moves wheel up to the given time and puts all timers that have expired into the list,
+     * they are removed from the wheel
+     */
+    void Advance(uint64_t now, std::vector<Timer *> &expired);
+
+    /**
+     * Returns number of milliseconds until wheel needs to be advanced, or -1 if there are no timers
+     */
+    int NextTimeout(uint64_t now) const;
+
+    inline size_t Size() const { return size; }
+
+private:
+    void Link(Timer *timer);
+
+    // Slots are circular lists with sentinel heads
+    std::vector<Timer> slots;
+    size_t mask;
+    uint64_t tick;
+
+    // Tick that has been processed last
+    uint64_t current;
+
+    // Number of scheduled timers
+    size_t size;
+};
+
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_TIMER_WHEEL_H
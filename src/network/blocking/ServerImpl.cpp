@@ -4,7 +4,6 @@
 
 #include <cassert>
 #include <cstring>
-#include <iostream>
 #include <memory>
 #include <stdexcept>
 #include <sstream>
@@ -23,6 +22,7 @@
 
 #include <afina/Storage.h>
 #include <afina/execute/Command.h>
+#include <afina/logging/Logger.h>
 
 namespace Afina {
 namespace Network {
@@ -33,7 +33,7 @@ void *ServerImpl::RunAcceptorProxy(void *p) {
     try {
         srv->RunAcceptor();
     } catch (std::runtime_error &ex) {
-        std::cerr << "Server fails: " << ex.what() << std::endl;
+        LOG_ERROR("Server fails: " << ex.what());
     }
     return 0;
 }
@@ -47,7 +47,7 @@ void *ServerImpl::RunConnectionProxy(void *p) {
     try {
         srv->RunConnection(client_socket);
     } catch (std::runtime_error &ex) {
-        std::cerr << "Server fails: " << ex.what() << std::endl;
+        LOG_ERROR("Server fails: " << ex.what());
     }
 
     {
@@ -68,7 +68,7 @@ ServerImpl::~ServerImpl() {}
 
 // See Server.h
 void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
 
     // If a client closes a connection, this will generally produce a SIGPIPE
     // signal that will kill the process. We want to ignore this signal, so send()
@@ -116,14 +116,14 @@ void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
 
 // See Server.h
 void ServerImpl::Stop() {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     running.store(false);
     shutdown(server_socket, SHUT_RDWR);
 }
 
 // See Server.h
 void ServerImpl::Join() {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     pthread_join(accept_thread, NULL);
 
     std::unique_lock<std::mutex> lock(connections_mutex);
@@ -134,7 +134,7 @@ void ServerImpl::Join() {
 
 // See Server.h
 void ServerImpl::RunAcceptor() {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
 
     // For IPv4 we use struct sockaddr_in:
     // struct sockaddr_in {
@@ -195,7 +195,7 @@ void ServerImpl::RunAcceptor() {
     struct sockaddr_in client_addr;
     socklen_t sinSize = sizeof(struct sockaddr_in);
     while (running.load()) {
-        std::cout << "network debug: waiting for connection..." << std::endl;
+        LOG_DEBUG("waiting for connection...");
 
         // When an incoming connection arrives, accept it. The call to accept() blocks until
         // the incoming connection arrives
@@ -234,12 +234,12 @@ bool ServerImpl::Parse(std::string str_buf, int client_socket)
 
         try {
             command->Execute(*pStorage, str_command, out);
-            out += "\r\n";
         } catch (std::runtime_error &ex) {
-            out = std::string("SERVER_ERROR ") + ex.what() + "\r\n";
+            out = std::string("SERVER_ERROR ") + ex.what();
         }
 
-        if (send(client_socket, out.c_str(), out.size(), 0) <= 0) {
+        out = parser.Frame(std::move(out));
+        if (!out.empty() && send(client_socket, out.c_str(), out.size(), 0) <= 0) {
             throw std::runtime_error("Socket send() failed");
         }
         parser.Reset();
@@ -250,7 +250,7 @@ bool ServerImpl::Parse(std::string str_buf, int client_socket)
 
 // See Server.h
 void ServerImpl::RunConnection(int client_socket) {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
 
     pthread_t self_id = pthread_self();
     {
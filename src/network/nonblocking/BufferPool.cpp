@@ -0,0 +1,40 @@
+#include "BufferPool.h"
+
+namespace Afina {
+namespace Network {
+namespace NonBlocking {
+
+const size_t BufferPool::ChunkSize;
+
+// See BufferPool.h
+BufferPool::BufferPool(size_t _max_free) : max_free(_max_free) { free_chunks.reserve(max_free); }
+
+// See BufferPool.h
+BufferPool::~BufferPool() {
+    for (char *chunk : free_chunks) {
+        delete[] chunk;
+    }
+}
+
+// See BufferPool.h
+char *BufferPool::Get() {
+    if (free_chunks.empty()) {
+        return new char[ChunkSize];
+    }
+    char *chunk = free_chunks.back();
+    free_chunks.pop_back();
+    return chunk;
+}
+
+// See BufferPool.h
+void BufferPool::Put(char *chunk) {
+    if (free_chunks.size() < max_free) {
+        free_chunks.push_back(chunk);
+    } else {
+        delete[] chunk;
+    }
+}
+
+} // namespace NonBlocking
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,49 @@
+#ifndef AFINA_NETWORK_NONBLOCKING_BUFFER_POOL_H
+#define AFINA_NETWORK_NONBLOCKING_BUFFER_POOL_H
+
+#include <cstddef>
+#include <vector>
+
+namespace Afina {
+namespace Network {
+namespace NonBlocking {
+
+/**
+ * # Pool of fixed size input chunks
+ * Connections read straight into chunks taken from the pool and give them back as soon as the parser
+ * has consumed them, so an idle connection holds no input memory at all. Pool belongs to a single
+ * worker and isn't threadsafe
+ */
+class BufferPool {
+public:
+    static const size_t ChunkSize = 16 * 1024;
+
+    /**
+     * @param max_free number of released chunks kept for reuse, the rest goes back to the system
+     */
+    explicit BufferPool(size_t max_free = 64);
+    ~BufferPool();
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    /**
+     * Returns chunk of ChunkSize bytes
+     */
+    char *Get();
+
+    /**
+     * Gives chunk obtained by Get back to the pool
+     */
+    void Put(char *chunk);
+
+private:
+    std::vector<char *> free_chunks;
+    size_t max_free;
+};
+
+} // namespace NonBlocking
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_NONBLOCKING_BUFFER_POOL_H
@@ -0,0 +1,109 @@
+#ifndef AFINA_NETWORK_NONBLOCKING_HANDOFF_QUEUE_H
+#define AFINA_NETWORK_NONBLOCKING_HANDOFF_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace Afina {
+namespace Network {
+namespace NonBlocking {
+
+/**
+ * # Bounded lock-free queue
+ * Multi producer, multi consumer array based queue (D. Vyukov's algorithm). Workers use it to pass
+ * connections to each other without taking any locks. Each cell carries sequence number telling
+ * whether it is ready to be written or read on the current lap around the array
+ */
+template <typename T> class HandoffQueue {
+public:
+    /**
+     * @param capacity maximum number of elements in the queue, must be a power of two
+     */
+    explicit HandoffQueue(size_t capacity) : buffer(new Cell[capacity]), mask(capacity - 1) {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+            throw std::runtime_error("Queue capacity must be a power of two");
+        }
+        for (size_t i = 0; i < capacity; i++) {
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos.store(0, std::memory_order_relaxed);
+        dequeue_pos.store(0, std::memory_order_relaxed);
+    }
+
+    HandoffQueue(const HandoffQueue &) = delete;
+    HandoffQueue &operator=(const HandoffQueue &) = delete;
+
+    /**
+     * Puts value in the queue, returns false if queue is full
+     */
+    bool Push(const T &value) {
+        Cell *cell;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &buffer[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Takes value from the queue, returns false if queue is empty
+     */
+    bool Pop(T &value) {
+        Cell *cell;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &buffer[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = cell->value;
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> buffer;
+    const size_t mask;
+
+    // Producers and consumers positions are kept on separate cache lines
+    alignas(64) std::atomic<size_t> enqueue_pos;
+    alignas(64) std::atomic<size_t> dequeue_pos;
+};
+
+} // namespace NonBlocking
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_NONBLOCKING_HANDOFF_QUEUE_H
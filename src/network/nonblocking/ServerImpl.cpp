@@ -3,7 +3,6 @@
 #include <atomic>
 #include <cassert>
 #include <cstring>
-#include <iostream>
 #include <memory>
 #include <stdexcept>
 
@@ -16,6 +15,7 @@
 #include <unistd.h>
 
 #include <afina/Storage.h>
+#include <afina/logging/Logger.h>
 
 #include "Utils.h"
 #include "Worker.h"
@@ -25,14 +25,14 @@ namespace Network {
 namespace NonBlocking {
 
 // See Server.h
-ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps) : Server(ps) {}
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps) : Server(ps), cpu_steering(false) {}
 
 // See Server.h
 ServerImpl::~ServerImpl() {}
 
 // See Server.h
 void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
 
     // If a client closes a connection, this will generally produce a SIGPIPE
     // signal that will kill the process. We want to ignore this signal, so send()
@@ -44,7 +44,65 @@ void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
         throw std::runtime_error("Unable to mask SIGPIPE");
     }
 
-    // Create server socket
+    // Each worker gets its own listening socket in the same SO_REUSEPORT group, so kernel spreads
+    // incoming connections evenly between workers instead of waking whichever wins the race
+    long n_cpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_cpu < 1) {
+        n_cpu = 1;
+    }
+
+    // Closing a socket received from the previous process would reset connections queued on it, so
+    // there is a worker for each of them even if fewer were asked for
+    if (adopted_sockets.size() > n_workers) {
+        LOG_WARNING("Run " << adopted_sockets.size() << " workers to serve all listening sockets taken over");
+        n_workers = uint16_t(adopted_sockets.size());
+    }
+
+    // Workers keep pointers to each other to hand connections off, so all of them must be in place
+    // before the first one starts
+    workers.reserve(n_workers);
+    std::vector<Worker *> peers;
+    for (uint16_t i = 0; i < n_workers; i++) {
+        workers.emplace_back(pStorage);
+        peers.push_back(&workers.back());
+    }
+    if (!workers.empty()) {
+        workers.front().enableFIFO(rfifo);
+    }
+
+    for (uint16_t i = 0; i < n_workers; i++) {
+        int cpu = cpu_steering ? int(i % n_cpu) : -1;
+        int server_socket;
+        if (i < adopted_sockets.size()) {
+            // Socket received from the previous process is already bound and listening
+            server_socket = adopted_sockets[i];
+            make_socket_non_blocking(server_socket);
+            if (cpu >= 0) {
+                setsockopt(server_socket, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu));
+            }
+        } else {
+            server_socket = CreateServerSocket(port, cpu);
+        }
+        listeners.push_back(server_socket);
+
+        workers[i].SetPeers(peers);
+        workers[i].SetOutputLimits(connection_output_limit, worker_output_limit);
+        workers[i].SetTimeouts(idle_timeout, read_timeout);
+        workers[i].SetDrainTimeout(drain_timeout);
+        workers[i].Start(server_socket, cpu);
+    }
+
+    adopted_sockets.clear();
+}
+
+// See ServerImpl.h
+void ServerImpl::SetCPUSteering(bool enable) { cpu_steering = enable; }
+
+// See Server.h
+std::vector<int> ServerImpl::ListeningSockets() const { return listeners; }
+
+// See ServerImpl.h
+int ServerImpl::CreateServerSocket(uint32_t port, int cpu) {
     struct sockaddr_in server_addr;
     std::memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;         // IPv4
@@ -57,36 +115,35 @@ void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
     }
 
     int opts = 1;
-    if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opts, sizeof(opts)) == -1) {
+    if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opts, sizeof(opts)) == -1 ||
+        setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &opts, sizeof(opts)) == -1) {
         close(server_socket);
         throw std::runtime_error("Socket setsockopt() failed");
     }
 
+    // Among listeners of the same reuseport group kernel prefers one that has incoming cpu equal to
+    // the cpu processing packet, so connection ends up in the worker pinned to that cpu
+    if (cpu >= 0 && setsockopt(server_socket, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == -1) {
+        close(server_socket);
+        throw std::runtime_error("Socket setsockopt(SO_INCOMING_CPU) failed");
+    }
+
     if (bind(server_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1) {
         close(server_socket);
         throw std::runtime_error("Socket bind() failed");
     }
 
     make_socket_non_blocking(server_socket);
-    if (listen(server_socket, 5) == -1) {
+    if (listen(server_socket, 511) == -1) {
         close(server_socket);
         throw std::runtime_error("Socket listen() failed");
     }
-    workers.reserve(n_workers);
-
-    workers.emplace_back(pStorage);
-    workers.front().enableFIFO(rfifo);
-    workers.front().Start(server_socket);
-
-    for (int i = 1; i < n_workers; i++) {
-        workers.emplace_back(pStorage);
-        workers.back().Start(server_socket);
-    }
+    return server_socket;
 }
 
 // See Server.h
 void ServerImpl::Stop() {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     for (auto &worker : workers) {
         worker.Stop();
     }
@@ -94,14 +151,14 @@ void ServerImpl::Stop() {
 
 // See Server.h
 void ServerImpl::Join() {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     for (auto &worker : workers) {
         worker.Join();
     }
 }
 
 void ServerImpl::addFIFO(const std::string _rfifo = "") {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     rfifo = _rfifo;
 }
 
@@ -32,7 +32,22 @@ public:
 
     void addFIFO(const std::string _rfifo) override;
 
+    /**
+     * Pin each worker thread to its own cpu and mark worker listening socket with SO_INCOMING_CPU,
+     * so connection is served on the same core that receives its packets. Must be called before Start
+     */
+    void SetCPUSteering(bool enable);
+
+    // See Server.h
+    std::vector<int> ListeningSockets() const override;
+
 private:
+    /**
+     * Creates non-blocking listening socket that shares port with other workers. If cpu isn't
+     * negative socket prefers connections arriving on that cpu
+     */
+    int CreateServerSocket(uint32_t port, int cpu);
+
     // Port to listen for new connections, permits access only from
     // inside of accept_thread
     // Read-only
@@ -42,6 +57,12 @@ private:
     std::vector<Worker> workers;
 
     std::string rfifo;
+
+    // Pin workers to cpus and steer connections to them
+    bool cpu_steering;
+
+    // Listening socket of each worker
+    std::vector<int> listeners;
 };
 
 } // namespace NonBlocking
@@ -1,29 +1,52 @@
 #include "Worker.h"
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <stdexcept>
 
-#include <iostream>
 #include <signal.h>
 #include <sys/stat.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/signalfd.h>
+#include <sys/eventfd.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
 
 #include <afina/execute/Command.h>
+#include <afina/logging/Logger.h>
 #include "Utils.h"
 
 namespace Afina {
 namespace Network {
 namespace NonBlocking {
 
+namespace {
+
+// Milliseconds of monotonic clock
+uint64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+const size_t Worker::HandoffQueueSize;
+const int Worker::RebalanceInterval;
+const uint64_t Worker::RebalanceThreshold;
+const size_t Worker::IOV_MAX_BATCH;
+const size_t Worker::DrainDiscardLimit;
+
 // See Worker.h
-Worker::Worker(std::shared_ptr<Afina::Storage> ps): pStorage(ps) {}
+Worker::Worker(std::shared_ptr<Afina::Storage> ps)
+    : pStorage(ps), cpu(-1), rfifo_fd(-1), wakeup_fd(-1), handoff(HandoffQueueSize), load(0),
+      connection_output_limit(0), worker_output_limit(0), idle_timeout(0), read_timeout(0),
+      drain_timeout(0), draining(false) {}
 
 // See Worker.h
 Worker::~Worker() {
@@ -31,192 +54,346 @@ Worker::~Worker() {
         close(rfifo_fd);
         unlink(rfifo_name.c_str());
     }
+    if (wakeup_fd >= 0) {
+        // Sockets handed off but never picked up
+        int client_socket;
+        while (handoff.Pop(client_socket)) {
+            close(client_socket);
+        }
+        close(wakeup_fd);
+    }
 }
 
 void* Worker::OnRunProxy(void* _args) {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     auto args = reinterpret_cast<std::pair<Worker*, int>*>(_args);
     Worker* worker = args->first;
     int server_socket = args->second;
+    delete args;
     worker->OnRun(server_socket);
     return 0;
 }
 
 // See Worker.h
-void Worker::Start(int _server_socket) {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+void Worker::Start(int _server_socket, int _cpu) {
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     server_socket = _server_socket;
+    cpu = _cpu;
+    if ((wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        throw std::runtime_error("Worker failed to create eventfd");
+    }
     running.store(true);
     auto args = new OnRunProxyArgs(this, server_socket);
-    pthread_t buffer;
-    if (pthread_create(&buffer, NULL, Afina::Network::NonBlocking::Worker::OnRunProxy, args) < 0) {
+    if (pthread_create(&thread, NULL, Afina::Network::NonBlocking::Worker::OnRunProxy, args) != 0) {
+        delete args;
         throw std::runtime_error("Could not create worker thread");
     }
 }
 
 // See Worker.h
 void Worker::Stop() {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     running.store(false); //memory barier
-    shutdown(server_socket, SHUT_RDWR);
+
+    // Event loop notices it has been stopped and starts to drain
+    uint64_t one = 1;
+    if (write(wakeup_fd, &one, sizeof(one)) < 0) {
+        LOG_ERROR("Failed to wake up worker");
+    }
 }
 
 // See Worker.h
 void Worker::Join() {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     pthread_join(thread, NULL);
 }
 
 bool Worker::Read(Connection* conn, bool fifo)
 {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
-    char buf[BUF_SIZE];
-    bool err = false;
-    int write_socket, read_socket;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
+    if (draining || conn->state == State::kClosing || OutputFull(conn)) {
+        // Don't take any more input until output drains
+        return true;
+    }
+
+    // Fill the rest of the last chunk and spill over into a fresh one, so a single readv takes
+    // everything up to a chunk size no matter where the previous read has stopped
+    struct iovec iov[2];
+    int iovcnt = 0;
+    if (!conn->input.empty() && conn->input_tail < BufferPool::ChunkSize) {
+        iov[iovcnt].iov_base = conn->input.back() + conn->input_tail;
+        iov[iovcnt].iov_len = BufferPool::ChunkSize - conn->input_tail;
+        iovcnt++;
+    }
+    char* fresh = pool.Get();
+    iov[iovcnt].iov_base = fresh;
+    iov[iovcnt].iov_len = BufferPool::ChunkSize;
+    iovcnt++;
 
-    if (!fifo) {
-        read_socket = write_socket = conn->fd;
+    ssize_t readed = readv(fifo ? rfifo_fd : conn->fd, iov, iovcnt);
+    if (readed <= 0) {
+        pool.Put(fresh);
+        if (readed == 0) {
+            // Peer closed connection, writer of the fifo could come back later
+            return fifo;
+        }
+        return (errno == EWOULDBLOCK || errno == EAGAIN);
+    }
+
+    size_t in_tail = (iovcnt == 2) ? iov[0].iov_len : 0;
+    if (size_t(readed) <= in_tail) {
+        conn->input_tail += readed;
+        pool.Put(fresh);
     } else {
-        read_socket = rfifo_fd;
+        conn->input.push_back(fresh);
+        conn->input_tail = readed - in_tail;
     }
 
-    bool fl = true;
-    while (fl)
-    {
-        fl = false;
-        if (conn->state == State::kReading)
-        {
-            int buf_readed = read(read_socket, buf, BUF_SIZE);
-            if (buf_readed == 0)
-            {
-                if (conn->offset >= conn->read_str.size())
-                {
-                    return true;
-                }
-            }
-            if (buf_readed > 0)
-            {
-                conn->read_str.append(buf, buf_readed);
-            } else if (buf_readed < 0) {
-                if ((errno != EWOULDBLOCK && errno != EAGAIN) && running.load()) {
-                    return false;
-                } else {
-                    return true;
+    Process(conn);
+    if (fifo) {
+        // Nobody to answer to
+        conn->write.clear();
+        output_size -= conn->output_size;
+        conn->output_size = 0;
+        return true;
+    }
+    return Write(conn) && !(conn->state == State::kClosing && conn->write.empty());
+}
+
+// See Worker.h
+void Worker::Process(Connection* conn)
+{
+    try {
+        while (!conn->input.empty() && conn->state != State::kClosing && !OutputFull(conn)) {
+            char* chunk = conn->input.front();
+            size_t end = (conn->input.size() == 1) ? conn->input_tail : BufferPool::ChunkSize;
+            if (conn->input_head == end) {
+                // Chunk is consumed, parser keeps its own state so commands could span chunks
+                conn->input.pop_front();
+                pool.Put(chunk);
+                conn->input_head = 0;
+                if (conn->input.empty()) {
+                    conn->input_tail = 0;
                 }
+                continue;
             }
 
-            try
-            {
+            const char* data = chunk + conn->input_head;
+            size_t avail = end - conn->input_head;
+            bool execute = false;
+            if (conn->state == State::kReading) {
                 size_t parsed = 0;
-                if (conn->parser.Parse(&conn->read_str[conn->offset], parsed))
-                {
-                    conn->state = State::kBuilding;
+                bool complete = conn->parser.Parse(data, avail, parsed);
+                conn->input_head += parsed;
+                if (!complete) {
+                    continue;
+                }
+
+                conn->cmd = conn->parser.Build(conn->body_size);
+                if (conn->body_size > 0) {
+                    conn->body.clear();
+                    conn->state = State::kBody;
                 } else {
-                    std::cout << "parsed: " << parsed << '\n';
+                    execute = true;
                 }
-                conn->offset += parsed;
-            } catch (std::runtime_error &ex) {
-                conn->write.push_back(std::string("WORKER_CONNECTION_ERROR ") + ex.what() + "\r\n");
-                conn->read_str.clear();
-                conn->offset = 0;
-                conn->state = State::kWriting;
-                err = true;
+            } else if (conn->state == State::kBody) {
+                size_t for_copy = std::min(avail, size_t(conn->body_size));
+                conn->body.append(data, for_copy);
+                conn->body_size -= for_copy;
+                conn->input_head += for_copy;
+                if (conn->body_size == 0 && conn->parser.Binary()) {
+                    execute = true;
+                } else if (conn->body_size == 0) {
+                    conn->state = State::kTrailerCR;
+                }
+            } else if (conn->state == State::kTrailerCR) {
+                if (*data != '\r') {
+                    throw std::runtime_error("Invalid chat, \\r expected");
+                }
+                conn->input_head++;
+                conn->state = State::kTrailerLF;
+            } else if (conn->state == State::kTrailerLF) {
+                if (*data != '\n') {
+                    throw std::runtime_error("Invalid chat, \\n expected");
+                }
+                conn->input_head++;
+                execute = true;
             }
-        }
 
-        if (conn->state == State::kBuilding)
-        {
-            uint32_t body_size = 0;
-            auto command = conn->parser.Build(body_size);
-            if (conn->read_str.size() >= body_size)
-            {
-                std::string str_command(&conn->read_str[conn->offset], body_size);
-                conn->offset += body_size;
-                if (conn->read_str[conn->offset] == '\r')
-                {
-                    conn->offset += 2;
-                }
+            if (execute) {
+                std::string res;
                 try {
-                    std::string res;
-                    command->Execute(*pStorage, str_command, res);
-                    conn->write.push_back(res + "\r\n");
+                    conn->cmd->Execute(*pStorage, conn->body, res);
                 } catch (std::runtime_error &ex) {
-                    conn->write.push_back(std::string("WORKER_CONNECTION_ERROR ") + ex.what() + "\r\n");
-                    conn->read_str.clear();
-                    conn->offset = 0;
-                    err = true;
+                    res = std::string("SERVER_ERROR ") + ex.what();
                 }
+                std::string response = conn->parser.Frame(std::move(res));
+                if (!response.empty()) {
+                    Respond(conn, std::move(response));
+                }
+                conn->requests++;
+                requests++;
+
+                conn->cmd = nullptr;
+                conn->body.clear();
                 conn->parser.Reset();
-                conn->state = State::kWriting;
-            } else {
                 conn->state = State::kReading;
             }
         }
+    } catch (std::runtime_error &ex) {
+        // Input is malformed, there is no way to find out where the next command starts
+        Respond(conn, conn->parser.Frame(std::string("CLIENT_ERROR ") + ex.what()));
+        conn->state = State::kClosing;
+        conn->ReleaseInput();
+    }
+}
 
-        if (conn->state == State::kWriting)
-        {
-            int writed = 1;
-            while (conn->write.size() > 0)
-            {
-                if (!fifo) {
-                    std::string tmp = conn->write.front();
-                    writed = write(write_socket, tmp.c_str() + conn->head_writed, tmp.size() - conn->head_writed);
-                } else {
-                    writed = 0;
-                    conn->write.clear();
-                }
-                if (writed > 0) {
-                    if (conn->write.front().size() < writed) {
-                        conn->head_writed += writed;
-                    } else {
-                        conn->write.pop_front();
-                        conn->head_writed = 0;
-                    }
-                } else {
-                    break;
-                }
-            }
+// See Worker.h
+bool Worker::Write(Connection* conn)
+{
+    while (!conn->write.empty()) {
+        struct iovec iov[IOV_MAX_BATCH];
+        size_t iovcnt = 0;
+        for (auto it = conn->write.begin(); it != conn->write.end() && iovcnt < IOV_MAX_BATCH; it++, iovcnt++) {
+            size_t skip = (iovcnt == 0) ? conn->head_writed : 0;
+            iov[iovcnt].iov_base = const_cast<char*>(it->data()) + skip;
+            iov[iovcnt].iov_len = it->size() - skip;
+        }
 
-            if (writed < 0)
-            {
-                if (!((errno == EWOULDBLOCK || errno == EAGAIN) && running.load())) {
-                    return true;
-                }
+        ssize_t writed = writev(conn->fd, iov, iovcnt);
+        if (writed < 0) {
+            if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                // Socket is full, wait until it drains
+                break;
             }
+            return false;
+        }
 
-            if (conn->write.size() == 0)
-            {
-                conn->state = State::kReading;
-                if (!(running.load()) || (conn->offset >= conn->read_str.size()))
-                {
-                    conn->read_str.clear();
-                    conn->offset = 0;
-                    return false;
-                } else {
-                    fl = true;
-                }
+        conn->output_size -= writed;
+        output_size -= writed;
+        size_t left = writed;
+        while (left > 0) {
+            size_t head_left = conn->write.front().size() - conn->head_writed;
+            if (left < head_left) {
+                conn->head_writed += left;
+                break;
             }
+            left -= head_left;
+            conn->write.pop_front();
+            conn->head_writed = 0;
+        }
+
+        // Space is freed, so input held back by the limit could be processed now
+        if (!conn->input.empty()) {
+            Process(conn);
         }
     }
+
+    if (output_overflow && (worker_output_limit == 0 || output_size < worker_output_limit)) {
+        ResumePaused();
+    }
+    UpdateInterest(conn);
+    Touch(conn);
     return true;
 }
 
-void Worker::EraseConnection(int client_socket)
+// See Worker.h
+void Worker::Respond(Connection* conn, std::string&& response)
 {
-    for (auto it = connections.begin(); it != connections.end(); it++)
-    {
-        if ((*it)->fd == client_socket)
-        {
-            connections.erase(it);
-            break;
+    conn->output_size += response.size();
+    output_size += response.size();
+    if (worker_output_limit != 0 && output_size >= worker_output_limit) {
+        output_overflow = true;
+    }
+    conn->write.push_back(std::move(response));
+}
+
+// See Worker.h
+bool Worker::OutputFull(const Connection* conn) const
+{
+    return (connection_output_limit != 0 && conn->output_size >= connection_output_limit) ||
+           (worker_output_limit != 0 && output_size >= worker_output_limit);
+}
+
+// See Worker.h
+void Worker::ResumePaused()
+{
+    output_overflow = false;
+    for (auto& conn : connections) {
+        if (conn->fd == rfifo_fd || conn->state == State::kClosing || (conn->interest & EPOLLIN) ||
+            OutputFull(conn.get())) {
+            continue;
+        }
+        // Connection is in the middle of the batch, it would be handled by the loop itself
+        if (!conn->write.empty()) {
+            UpdateInterest(conn.get());
+            continue;
         }
+        if (!conn->input.empty()) {
+            Process(conn.get());
+        }
+        UpdateInterest(conn.get());
+    }
+}
+
+void Worker::EraseConnection(Connection* conn)
+{
+    timers.Cancel(&conn->timer);
+    output_size -= conn->output_size;
+
+    // Order doesn't matter, so fill the hole with the last connection
+    size_t index = conn->index;
+    if (index + 1 != connections.size()) {
+        connections[index] = std::move(connections.back());
+        connections[index]->index = index;
+    }
+    connections.pop_back();
+
+    if (output_overflow && output_size < worker_output_limit) {
+        ResumePaused();
+    }
+}
+
+void Worker::AddConnection(Connection* conn)
+{
+    conn->index = connections.size();
+    connections.emplace_back(conn);
+}
+
+void Worker::Touch(Connection* conn)
+{
+    // Connection that has started to send command is expected to finish it soon
+    bool in_command = conn->state != State::kReading || !conn->input.empty() || !conn->parser.Idle();
+    uint32_t timeout = in_command ? read_timeout : idle_timeout;
+    if (timeout == 0) {
+        timers.Cancel(&conn->timer);
+        return;
+    }
+
+    uint64_t deadline = now + timeout;
+    if (conn->timer.Scheduled() && deadline >= conn->timer.deadline) {
+        // Wheel picks new deadline up lazily
+        conn->timer.deadline = deadline;
+    } else {
+        timers.Schedule(&conn->timer, deadline);
+    }
+}
+
+void Worker::ExpireTimers()
+{
+    expired.clear();
+    timers.Advance(now, expired);
+    for (TimerWheel::Timer* timer : expired) {
+        Connection* conn = reinterpret_cast<Connection*>(timer->data);
+        epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+        EraseConnection(conn);
     }
 }
 
 // See Worker.h
 void Worker::OnRun(int _server_socket)
 {
-    std::cout << "network debug: " << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
 
     // TODO: implementation here
     // 1. Create epoll_context here
@@ -226,11 +403,20 @@ void Worker::OnRun(int _server_socket)
     // 4. Add connections to the local context
     // 5. Process connection events
     //
-    // Do not forget to use EPOLLEXCLUSIVE flag when register socket
-    // for events to avoid thundering herd type behavior.
+    // Server socket belongs to this worker only (see SO_REUSEPORT in ServerImpl), so there is
+    // no thundering herd and EPOLLEXCLUSIVE isn't needed
 
     server_socket = _server_socket;
 
+    if (cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0) {
+            LOG_ERROR("Failed to pin worker to cpu " << cpu);
+        }
+    }
+
     if ((epfd = epoll_create(EPOLL_MAX_EVENTS)) < 0)
     {
         throw std::runtime_error("Worker failed to create epoll file descriptor");
@@ -239,7 +425,7 @@ void Worker::OnRun(int _server_socket)
     epoll_event event, events_buffer[EPOLL_MAX_EVENTS];
 
     Connection* server_con = new Connection(server_socket);
-    event.events = EPOLLEXCLUSIVE | EPOLLIN | EPOLLHUP | EPOLLERR;
+    event.events = EPOLLIN | EPOLLHUP | EPOLLERR;
     event.data.ptr = server_con;
 
     if (epoll_ctl(epfd, EPOLL_CTL_ADD, server_socket, &event) == -1)
@@ -250,29 +436,69 @@ void Worker::OnRun(int _server_socket)
     if (rfifo_name.size() != 0)
     {
         if (mkfifo(rfifo_name.c_str(), 0765) == -1) {
-            std::cout << rfifo_name << '\n';
-            throw std::runtime_error("mkfifo wfifo");
+            throw std::runtime_error("mkfifo " + rfifo_name);
         }
         rfifo_fd = open(rfifo_name.c_str(), O_RDONLY | O_NONBLOCK);
         if (rfifo_fd == -1) {
             throw std::runtime_error("open wfifo");
         }
         event.events = /*EPOLLEXCLUSIVE | */EPOLLHUP | EPOLLIN | EPOLLERR;// | EPOLLET;
-        Connection* connection = new Connection(rfifo_fd);
-        connections.emplace_back(std::move(connection));
-        event.data.ptr = connections.back().get();
+        Connection* connection = new Connection(rfifo_fd, &pool);
+        AddConnection(connection);
+        event.data.ptr = connection;
         if (epoll_ctl(epfd, EPOLL_CTL_ADD, rfifo_fd, &event) == -1) {
             throw std::runtime_error("Worker failed to assign fifo_read to epoll");
         }
     }
 
-    while (running.load())
+    // Peers wake worker up through eventfd once they hand connection off
+    Connection* wakeup_con = new Connection(wakeup_fd);
+    event.events = EPOLLIN;
+    event.data.ptr = wakeup_con;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, wakeup_fd, &event) == -1) {
+        throw std::runtime_error("Worker failed to assign eventfd to epoll");
+    }
+
+    requests = 0;
+    output_size = 0;
+    output_overflow = false;
+    now = NowMs();
+    timers.Reset(now);
+
+    // Without peers there is nobody to balance load with
+    uint64_t next_rebalance = now + RebalanceInterval;
+    draining = false;
+
+    while (true)
     {
-        int n = epoll_wait(epfd, events_buffer, EPOLL_MAX_EVENTS, -1);
+        if (!running.load() && !draining) {
+            BeginDrain();
+        }
+        if (draining && (connections.empty() || now >= drain_deadline)) {
+            break;
+        }
+
+        // Sleep until something happens, or until it is time to rebalance, expire timers or give
+        // up on draining
+        int timeout = timers.NextTimeout(now);
+        if (!peers.empty() && !draining) {
+            int rebalance = next_rebalance > now ? int(next_rebalance - now) : 0;
+            timeout = (timeout < 0) ? rebalance : std::min(timeout, rebalance);
+        }
+        if (draining) {
+            int left = int(drain_deadline - now);
+            timeout = (timeout < 0) ? left : std::min(timeout, left);
+        }
+
+        int n = epoll_wait(epfd, events_buffer, EPOLL_MAX_EVENTS, timeout);
         if (n == -1)
         {
+            if (errno == EINTR) {
+                continue;
+            }
             throw std::runtime_error("Worker epoll_wait() failed");
         }
+        now = NowMs();
 
         for (int i = 0; i < n; ++i)
         {
@@ -291,47 +517,64 @@ void Worker::OnRun(int _server_socket)
                         }
                     }
                 } else if (running.load()) {
-                    make_socket_non_blocking(client_socket);
-                    event.events = EPOLLIN | EPOLLOUT | EPOLLHUP | EPOLLERR;
-                    auto connection = new Connection(client_socket);
-                    connections.emplace_back(std::move(connection));
-                    event.data.ptr = connections.back().get();
-                    if (epoll_ctl(epfd, EPOLL_CTL_ADD, client_socket, &event) == -1) {
-                        throw std::runtime_error("Worker failed to assign client socket to epoll");
-                    }
+                    Register(client_socket);
                 } else {
+                    close(client_socket);
                     break;
                 }
+            } else if (connection == wakeup_con) {
+                OnHandoff();
             } else if (connection->fd == rfifo_fd) {
                 if (!Read(connection, true))
                 {
-                    epoll_ctl(epfd, EPOLL_CTL_DEL, client_socket, NULL);
-                    EraseConnection(client_socket);
+                    epoll_ctl(epfd, EPOLL_CTL_DEL, connection->fd, NULL);
+                    EraseConnection(connection);
                 }
             } else {
                 client_socket = connection->fd;
                 if (events_buffer[i].events & (EPOLLERR | EPOLLHUP))
                 {
                     epoll_ctl(epfd, EPOLL_CTL_DEL, client_socket, NULL);
-                    EraseConnection(client_socket);
+                    EraseConnection(connection);
                 } else if (events_buffer[i].events & (EPOLLIN | EPOLLOUT)) {
-                    if (!Read(connection, false))
+                    bool alive = true;
+                    if (events_buffer[i].events & EPOLLIN) {
+                        alive = Read(connection, false);
+                    }
+                    if (alive && (events_buffer[i].events & EPOLLOUT)) {
+                        alive = Write(connection) &&
+                                !(connection->state == State::kClosing && connection->write.empty());
+                    }
+                    if (alive && draining && connection->write.empty()) {
+                        // Everything received before stop has been answered
+                        CloseDrained(connection);
+                    } else if (!alive)
                     {
                         epoll_ctl(epfd, EPOLL_CTL_DEL, client_socket, NULL);
-                        EraseConnection(client_socket);
+                        EraseConnection(connection);
                     }
                 } else {
-                    EraseConnection(client_socket);
+                    EraseConnection(connection);
                     throw std::runtime_error("Epoll event incorrect");
                 }
             }
         }
+
+        ExpireTimers();
+        if (!peers.empty() && !draining && now >= next_rebalance) {
+            Rebalance();
+            next_rebalance = now + RebalanceInterval;
+        }
     }
+    // Whatever hasn't drained in time is dropped
     for (auto it = connections.begin(); it != connections.end(); it++)
     {
         epoll_ctl(epfd, EPOLL_CTL_DEL, (*it)->fd, NULL);
     }
     connections.clear();
+    epoll_ctl(epfd, EPOLL_CTL_DEL, wakeup_fd, NULL);
+    wakeup_con->fd = -1;
+    delete wakeup_con;
     close(epfd);
 }
 
@@ -339,6 +582,216 @@ void Worker::enableFIFO(const std::string& rfifo) {
     rfifo_name = rfifo;
 }
 
+// See Worker.h
+void Worker::SetOutputLimits(size_t connection, size_t worker) {
+    connection_output_limit = connection;
+    worker_output_limit = worker;
+}
+
+// See Worker.h
+void Worker::SetTimeouts(uint32_t idle, uint32_t read) {
+    idle_timeout = idle;
+    read_timeout = read;
+}
+
+// See Worker.h
+void Worker::SetDrainTimeout(uint32_t timeout) { drain_timeout = timeout; }
+
+// See Worker.h
+void Worker::SetPeers(const std::vector<Worker*>& _peers) {
+    peers.clear();
+    for (Worker* peer : _peers) {
+        if (peer != this) {
+            peers.push_back(peer);
+        }
+    }
+}
+
+void Worker::Register(int client_socket)
+{
+    make_socket_non_blocking(client_socket);
+    epoll_event event;
+    event.events = EPOLLIN | EPOLLHUP | EPOLLERR;
+    auto connection = new Connection(client_socket, &pool);
+    connection->interest = event.events;
+    AddConnection(connection);
+    event.data.ptr = connection;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, client_socket, &event) == -1) {
+        throw std::runtime_error("Worker failed to assign client socket to epoll");
+    }
+    Touch(connection);
+}
+
+void Worker::UpdateInterest(Connection* conn)
+{
+    if (conn->fd == rfifo_fd) {
+        return;
+    }
+
+    uint32_t interest = EPOLLHUP | EPOLLERR;
+    if (!draining && conn->state != State::kClosing && !OutputFull(conn)) {
+        interest |= EPOLLIN;
+    }
+    if (!conn->write.empty()) {
+        interest |= EPOLLOUT;
+    }
+    if (interest == conn->interest) {
+        return;
+    }
+
+    epoll_event event;
+    event.events = interest;
+    event.data.ptr = conn;
+    if (epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &event) == 0) {
+        conn->interest = interest;
+    }
+}
+
+void Worker::BeginDrain()
+{
+    draining = true;
+    drain_deadline = now + drain_timeout;
+
+    // Stop accepting, connections still waiting in the backlog are reset by the kernel
+    epoll_ctl(epfd, EPOLL_CTL_DEL, server_socket, NULL);
+    close(server_socket);
+
+    // Nobody is waiting for the answers from fifo, so there is nothing to drain
+    for (auto& conn : connections) {
+        if (conn->fd == rfifo_fd) {
+            epoll_ctl(epfd, EPOLL_CTL_DEL, rfifo_fd, NULL);
+            EraseConnection(conn.get());
+            rfifo_fd = -1;
+            break;
+        }
+    }
+
+    // Execute commands already received, connections that have nothing to send are closed
+    // right away, the rest are waiting for EPOLLOUT
+    std::vector<Connection*> drain;
+    for (auto& conn : connections) {
+        drain.push_back(conn.get());
+    }
+    for (Connection* conn : drain) {
+        if (conn->state != State::kClosing) {
+            Process(conn);
+        }
+        if (!Write(conn)) {
+            epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+            EraseConnection(conn);
+        } else if (conn->write.empty()) {
+            CloseDrained(conn);
+        }
+    }
+}
+
+void Worker::CloseDrained(Connection* conn)
+{
+    // Closing socket that still has unread input makes kernel send RST, and client may lose
+    // responses that are still in flight. Whatever client managed to send is dropped anyway
+    char buf[4096];
+    for (size_t total = 0; total < DrainDiscardLimit;) {
+        ssize_t n = read(conn->fd, buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        total += n;
+    }
+    shutdown(conn->fd, SHUT_WR);
+
+    epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    EraseConnection(conn);
+}
+
+void Worker::OnHandoff()
+{
+    uint64_t value;
+    while (read(wakeup_fd, &value, sizeof(value)) > 0) {
+    }
+
+    int client_socket;
+    while (handoff.Pop(client_socket)) {
+        if (running.load()) {
+            Register(client_socket);
+        } else {
+            close(client_socket);
+        }
+    }
+}
+
+void Worker::Rebalance()
+{
+    uint64_t current = requests;
+    requests = 0;
+    load.store(current, std::memory_order_relaxed);
+
+    // Find the least loaded peer which is already running
+    Worker* target = nullptr;
+    uint64_t target_load = current;
+    for (Worker* peer : peers) {
+        if (!peer->running.load()) {
+            continue;
+        }
+        uint64_t peer_load = peer->load.load(std::memory_order_relaxed);
+        if (peer_load < target_load) {
+            target = peer;
+            target_load = peer_load;
+        }
+    }
+
+    // Connection carrying r commands per interval moved to the target turns loads into
+    // (current - r, target_load + r), so it evens things out only if r < gap. The best candidate
+    // is the one closest to gap / 2
+    Connection* best = nullptr;
+    uint64_t best_score = 0;
+    uint64_t gap = current - target_load;
+    if (target != nullptr && gap > RebalanceThreshold) {
+        for (auto& conn : connections) {
+            if (conn->fd == rfifo_fd || !conn->Movable() || conn->requests == 0 || conn->requests >= gap) {
+                continue;
+            }
+            uint64_t score = std::min(conn->requests, gap - conn->requests);
+            if (score > best_score) {
+                best = conn.get();
+                best_score = score;
+            }
+        }
+    }
+
+    if (best != nullptr && Migrate(best, target)) {
+        // Keep peers from piling onto the same target until it publishes its own numbers
+        target->load.fetch_add(best_score, std::memory_order_relaxed);
+        load.store(current - best_score, std::memory_order_relaxed);
+    }
+
+    for (auto& conn : connections) {
+        conn->requests = 0;
+    }
+}
+
+bool Worker::Migrate(Connection* conn, Worker* target)
+{
+    int client_socket = conn->fd;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, client_socket, NULL);
+    if (!target->handoff.Push(client_socket)) {
+        epoll_event event;
+        event.events = conn->interest;
+        event.data.ptr = conn;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, client_socket, &event);
+        return false;
+    }
+
+    uint64_t one = 1;
+    if (write(target->wakeup_fd, &one, sizeof(one)) < 0) {
+        LOG_ERROR("Failed to wake up worker");
+    }
+
+    // Socket belongs to the target now, release connection without closing it
+    conn->fd = -1;
+    EraseConnection(conn);
+    return true;
+}
+
 } // namespace NonBlocking
 } // namespace Network
 } // namespace Afina
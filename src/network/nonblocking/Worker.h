@@ -8,7 +8,11 @@
 #include <string>
 #include <unistd.h>
 #include <deque>
+#include <afina/execute/Command.h>
 #include "../../protocol/Parser.h"
+#include "../TimerWheel.h"
+#include "BufferPool.h"
+#include "HandoffQueue.h"
 
 namespace Afina {
 
@@ -18,27 +22,77 @@ class Storage;
 namespace Network {
 namespace NonBlocking {
 
+// Determinates how connection reacts on input, same as in UV server
 enum class State {
     kReading,
-    kBuilding,
-    kWriting
+    kBody,
+    kTrailerCR,
+    kTrailerLF,
+    kClosing
 };
 
 struct Connection {
-    Connection(int _fd) : fd(_fd), state(State::kReading), head_writed(0), offset(0) {
-        read_str.clear();
-        write.clear();
-        parser.Reset();
+    Connection(int _fd, BufferPool* _pool = nullptr)
+        : fd(_fd), pool(_pool), input_head(0), input_tail(0), cmd(nullptr), body_size(0), head_writed(0),
+          output_size(0), state(State::kReading), requests(0), interest(0), index(0) {
+        timer.data = this;
     }
     ~Connection(void) {
-        close(fd);
+        ReleaseInput();
+        // Descriptor is detached once connection is handed off to another worker
+        if (fd >= 0) {
+            close(fd);
+        }
     }
+
+    // Connection has no command in flight and nothing buffered either way, so its socket could be
+    // handed off to another worker which starts with the fresh connection and parser
+    bool Movable() const { return state == State::kReading && input.empty() && write.empty() && parser.Idle(); }
+
+    // Gives all input chunks back to the pool
+    void ReleaseInput() {
+        for (char* chunk : input) {
+            pool->Put(chunk);
+        }
+        input.clear();
+        input_head = input_tail = 0;
+    }
+
     int fd;
-    std::string read_str;
+
+    // Received bytes not consumed yet: chain of chunks from the worker pool. Data starts at
+    // input_head in the first chunk and ends at input_tail in the last one
+    BufferPool* pool;
+    std::deque<char*> input;
+    size_t input_head, input_tail;
+
+    // Command parsed out from the input, owned by the parser, and its argument. Body keeps its
+    // capacity between requests
+    Execute::Command* cmd;
+    uint32_t body_size;
+    std::string body;
+
+    // Responses to be sent, head_writed bytes of the first one are already sent
     std::deque<std::string> write;
-    size_t head_writed, offset;
+    size_t head_writed;
+
+    // Number of bytes in write not sent yet
+    size_t output_size;
+
     State state;
     Protocol::Parser parser;
+
+    // Number of commands executed since last rebalance
+    uint64_t requests;
+
+    // Events connection is currently registered for in epoll
+    uint32_t interest;
+
+    // Position in the worker connections list
+    size_t index;
+
+    // Idle/read timeout
+    TimerWheel::Timer timer;
 };
 
 /**
@@ -50,20 +104,25 @@ class Worker {
 public:
     Worker(std::shared_ptr<Afina::Storage> ps);
     ~Worker();
-    Worker(const Worker& w) : pStorage(w.pStorage) {};
+    Worker(const Worker& w) : pStorage(w.pStorage), cpu(-1), rfifo_fd(-1), wakeup_fd(-1), handoff(HandoffQueueSize), load(0),
+          connection_output_limit(w.connection_output_limit), worker_output_limit(w.worker_output_limit),
+          idle_timeout(w.idle_timeout), read_timeout(w.read_timeout), drain_timeout(w.drain_timeout),
+          draining(false) {};
 
     /**
      * Spaws new background thread that is doing epoll on the given server
      * socket. Once connection accepted it must be registered and being processed
-     * on this thread
+     * on this thread. Server socket is owned by the worker exclusively.
+     *
+     * If cpu isn't negative then thread gets pinned to that cpu
      */
-    void Start(int server_socket);
+    void Start(int server_socket, int cpu = -1);
 
     /**
      * Signal background thread to stop. After that signal thread must stop to
      * accept new connections and must stop read new commands from existing. Once
      * all readed commands are executed and results are send back to client, thread
-     * must stop
+     * must stop. Connections that haven't drained within drain timeout are dropped
      */
     void Stop();
 
@@ -75,6 +134,27 @@ public:
 
     void enableFIFO(const std::string& rfifo);
 
+    /**
+     * Workers that could take connections over from this one once it gets overloaded. Must be
+     * called before Start, peers must outlive the worker
+     */
+    void SetPeers(const std::vector<Worker*>& peers);
+
+    /**
+     * See Server::SetOutputLimits, must be called before Start
+     */
+    void SetOutputLimits(size_t connection, size_t worker);
+
+    /**
+     * See Server::SetTimeouts, must be called before Start
+     */
+    void SetTimeouts(uint32_t idle, uint32_t read);
+
+    /**
+     * See Server::SetDrainTimeout, must be called before Start
+     */
+    void SetDrainTimeout(uint32_t timeout);
+
     pthread_t thread;
 
 protected:
@@ -87,9 +167,68 @@ private:
     using OnRunProxyArgs = std::pair<Worker*, int>;
     using Connection = struct Connection;
 
+    /**
+     * Reads available input straight into pooled chunks and processes it. Returns false if the
+     * connection must be closed
+     */
     bool Read(Connection* conn, bool fifo);
+
+    // Feeds connection input into state machine, executes parsed commands and queues responses
+    void Process(Connection* conn);
+
+    // Sends queued responses out, returns false on error
+    bool Write(Connection* conn);
     static void* OnRunProxy(void* args);
-    void EraseConnection(int client_socket);
+    void EraseConnection(Connection* conn);
+
+    // Adds connection to the list of connections owned by worker
+    void AddConnection(Connection* conn);
+
+    // Connection has shown some activity, so its timeout starts over
+    void Touch(Connection* conn);
+
+    // Closes connections whose timeouts have expired
+    void ExpireTimers();
+
+    // Stops accepting and reading, executes commands received so far and closes connections that
+    // have nothing more to send
+    void BeginDrain();
+
+    // Closes connection that has sent all responses while draining
+    void CloseDrained(Connection* conn);
+
+    // Starts processing of the connected socket in this worker
+    void Register(int client_socket);
+
+    /**
+     * Brings epoll registration in line with connection state: input is read only while output
+     * isn't over the limits, EPOLLOUT is requested only while there is something to send
+     */
+    void UpdateInterest(Connection* conn);
+
+    // Queues response to be sent to the connection
+    void Respond(Connection* conn, std::string&& response);
+
+    // Output of the connection or of the whole worker is over the limit
+    bool OutputFull(const Connection* conn) const;
+
+    // Continues processing of connections paused by the worker output limit
+    void ResumePaused();
+
+    // Takes over connections handed off by peers
+    void OnHandoff();
+
+    /**
+     * Publishes load of the last interval and moves the busiest movable connection to the
+     * lightest peer if that makes distribution more even
+     */
+    void Rebalance();
+
+    // Passes connection to the given worker, returns false if it has no room for it
+    bool Migrate(Connection* conn, Worker* target);
+
+    // Must outlive connections, they give chunks back on destruction
+    BufferPool pool;
 
     std::vector<std::unique_ptr<Connection>> connections;
     std::shared_ptr<Afina::Storage> pStorage;
@@ -97,11 +236,67 @@ private:
     std::atomic<bool> running;
     int server_socket;
 
+    // Cpu thread is pinned to, negative if any
+    int cpu;
+
     std::string rfifo_name;
     int rfifo_fd;
 
-    const size_t BUF_SIZE = 1024;
+    // Peers are waking this worker up through eventfd once they put sockets into handoff queue
+    int wakeup_fd;
+    HandoffQueue<int> handoff;
+    std::vector<Worker*> peers;
+
+    // Commands executed in the last rebalance interval, read by peers
+    std::atomic<uint64_t> load;
+
+    // Commands executed since the current interval started
+    uint64_t requests;
+
+    // Limits of unsent output, zero means unlimited
+    size_t connection_output_limit;
+    size_t worker_output_limit;
+
+    // Unsent output of all connections
+    size_t output_size;
+
+    // Worker output went over the limit, so connections could be paused because of it
+    bool output_overflow;
+
+    // Connection timeouts in milliseconds, zero means no timeout
+    uint32_t idle_timeout;
+    uint32_t read_timeout;
+
+    // Deadlines of connection timeouts
+    TimerWheel timers;
+    std::vector<TimerWheel::Timer*> expired;
+
+    // Time of the current loop iteration, ms of steady clock
+    uint64_t now;
+
+    // How long to wait for connections to drain once stopped, ms
+    uint32_t drain_timeout;
+
+    // Worker has been stopped and waits for connections to drain until deadline
+    bool draining;
+    uint64_t drain_deadline;
+
+    static const size_t HandoffQueueSize = 256;
+
+    // How often worker compares its load with peers, ms
+    static const int RebalanceInterval = 100;
+
+    // Ignore imbalance smaller than that many commands per interval, moving connections back and
+    // forth costs more than it gains
+    static const uint64_t RebalanceThreshold = 64;
+
+    // Maximum amount of unread input thrown away before closing drained connection
+    static const size_t DrainDiscardLimit = 1024 * 1024;
+
     const size_t EPOLL_MAX_EVENTS = 10;
+
+    // Maximum number of responses passed to a single writev
+    static const size_t IOV_MAX_BATCH = 64;
 };
 
 } // namespace NonBlocking
@@ -0,0 +1,270 @@
+#include "Ring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Network {
+namespace Uring {
+
+namespace {
+
+int io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+void throw_errno(const char *what) {
+    std::stringstream ss;
+    ss << what << ": " << std::strerror(errno);
+    throw std::runtime_error(ss.str());
+}
+
+} // namespace
+
+// See Ring.h
+Ring::Ring()
+    : ring_fd(-1), sq_ptr(MAP_FAILED), sq_size(0), sqe_tail(0), sqes(nullptr), sqes_size(0), cq_ptr(MAP_FAILED),
+      cq_size(0), buf_ring(nullptr), buf_ring_size(0), buf_mask(0), buf_tail(0), buf_group(0), buffers(nullptr),
+      buffers_size(0), buffer_size(0) {}
+
+// See Ring.h
+Ring::~Ring() { Destroy(); }
+
+// See Ring.h
+void Ring::Init(unsigned entries) {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = entries * 4;
+
+    ring_fd = io_uring_setup(entries, &params);
+    if (ring_fd < 0 && errno == EINVAL) {
+        // Older kernels don't know about task run tweaks, they are optional
+        std::memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;
+        ring_fd = io_uring_setup(entries, &params);
+    }
+    if (ring_fd < 0) {
+        throw_errno("Failed to call io_uring_setup");
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_size = cq_size = std::max(sq_size, cq_size);
+    }
+
+    sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) {
+        Destroy();
+        throw_errno("Failed to mmap submission queue");
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ptr = sq_ptr;
+    } else {
+        cq_ptr = mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            Destroy();
+            throw_errno("Failed to mmap completion queue");
+        }
+    }
+
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *p = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (p == MAP_FAILED) {
+        Destroy();
+        throw_errno("Failed to mmap submission entries");
+    }
+    sqes = static_cast<struct io_uring_sqe *>(p);
+
+    char *sq = static_cast<char *>(sq_ptr);
+    sq_khead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sq_ktail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_entries = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_entries);
+    sqe_tail = *sq_ktail;
+
+    char *cq = static_cast<char *>(cq_ptr);
+    cq_khead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_ktail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+}
+
+// See Ring.h
+struct io_uring_sqe *Ring::GetSqe() {
+    unsigned head = __atomic_load_n(sq_khead, __ATOMIC_ACQUIRE);
+    if (sqe_tail - head >= sq_entries) {
+        return nullptr;
+    }
+
+    unsigned idx = sqe_tail & sq_mask;
+    struct io_uring_sqe *sqe = &sqes[idx];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array[idx] = idx;
+    sqe_tail++;
+    return sqe;
+}
+
+// See Ring.h
+unsigned Ring::SpaceLeft() const { return sq_entries - (sqe_tail - __atomic_load_n(sq_khead, __ATOMIC_ACQUIRE)); }
+
+// See Ring.h
+int Ring::Submit(unsigned wait_nr) {
+    __atomic_store_n(sq_ktail, sqe_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = sqe_tail - __atomic_load_n(sq_khead, __ATOMIC_ACQUIRE);
+
+    int rc;
+    do {
+        rc = io_uring_enter(ring_fd, to_submit, wait_nr, wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0);
+    } while (rc < 0 && errno == EINTR);
+
+    if (rc < 0 && errno != EAGAIN && errno != EBUSY) {
+        throw_errno("Failed to call io_uring_enter");
+    }
+    return rc;
+}
+
+// See Ring.h
+struct io_uring_cqe *Ring::PeekCqe() {
+    unsigned head = *cq_khead;
+    if (head == __atomic_load_n(cq_ktail, __ATOMIC_ACQUIRE)) {
+        return nullptr;
+    }
+    return &cqes[head & cq_mask];
+}
+
+// See Ring.h
+void Ring::SeenCqe() { __atomic_store_n(cq_khead, *cq_khead + 1, __ATOMIC_RELEASE); }
+
+// See Ring.h
+void Ring::SetupBuffers(uint16_t group, uint16_t count, uint32_t size) {
+    if (count == 0 || (count & (count - 1)) != 0) {
+        throw std::runtime_error("Number of provided buffers must be a power of 2");
+    }
+
+    buf_ring_size = count * sizeof(struct io_uring_buf);
+    void *p = mmap(nullptr, buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        throw_errno("Failed to allocate buffer ring");
+    }
+    buf_ring = static_cast<struct io_uring_buf_ring *>(p);
+
+    buffers_size = size_t(count) * size;
+    p = mmap(nullptr, buffers_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        throw_errno("Failed to allocate provided buffers");
+    }
+    buffers = static_cast<char *>(p);
+    buffer_size = size;
+
+    struct io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring);
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (io_uring_register(ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        throw_errno("Failed to register buffer ring");
+    }
+
+    buf_group = group;
+    buf_mask = count - 1;
+    buf_tail = 0;
+    for (uint16_t bid = 0; bid < count; bid++) {
+        RecycleBuffer(bid);
+    }
+}
+
+// See Ring.h
+void Ring::RecycleBuffer(uint16_t bid) {
+    // Don't use buf_ring->bufs: flexible array declaration from kernel headers gets shifted by an
+    // empty struct in C++, while ring entries actually start at the very beginning
+    struct io_uring_buf *buf = reinterpret_cast<struct io_uring_buf *>(buf_ring) + (buf_tail & buf_mask);
+    buf->addr = reinterpret_cast<uint64_t>(Buffer(bid));
+    buf->len = buffer_size;
+    buf->bid = bid;
+    buf_tail++;
+    __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+}
+
+// See Ring.h
+bool Ring::Supported() {
+    try {
+        Ring ring;
+        ring.Init(4);
+
+        // Provided buffer rings came in 5.19 together with multishot accept
+        ring.SetupBuffers(0, 1, 64);
+
+        // Multishot recv has no feature bit, but it was merged in the same release as zero copy send
+        // so use the latter as a marker
+        const size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+        uint64_t probe_buf[(probe_size + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+        std::memset(probe_buf, 0, sizeof(probe_buf));
+        struct io_uring_probe *probe = reinterpret_cast<struct io_uring_probe *>(probe_buf);
+        if (io_uring_register(ring.ring_fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+            return false;
+        }
+
+        const uint8_t required[] = {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_READ,
+                                    IORING_OP_ASYNC_CANCEL, IORING_OP_SEND_ZC};
+        for (uint8_t op : required) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    } catch (std::runtime_error &ex) {
+        return false;
+    }
+}
+
+// See Ring.h
+void Ring::Destroy() {
+    if (ring_fd >= 0) {
+        close(ring_fd);
+        ring_fd = -1;
+    }
+    if (sqes != nullptr) {
+        munmap(sqes, sqes_size);
+        sqes = nullptr;
+    }
+    if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+        munmap(cq_ptr, cq_size);
+    }
+    cq_ptr = MAP_FAILED;
+    if (sq_ptr != MAP_FAILED) {
+        munmap(sq_ptr, sq_size);
+        sq_ptr = MAP_FAILED;
+    }
+    if (buf_ring != nullptr) {
+        munmap(buf_ring, buf_ring_size);
+        buf_ring = nullptr;
+    }
+    if (buffers != nullptr) {
+        munmap(buffers, buffers_size);
+        buffers = nullptr;
+    }
+}
+
+} // namespace Uring
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,125 @@
+#ifndef AFINA_NETWORK_URING_RING_H
+#define AFINA_NETWORK_URING_RING_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <linux/io_uring.h>
+
+namespace Afina {
+namespace Network {
+namespace Uring {
+
+/**
+ * # Thin wrapper over raw io_uring syscalls
+ * Owns submission/completion rings of a single io_uring instance and one group of provided buffers
+ * used by recv operations. Not threadsafe, must be used from the thread that owns it
+ */
+class Ring {
+public:
+    Ring();
+    ~Ring();
+
+    Ring(const Ring &) = delete;
+    Ring &operator=(const Ring &) = delete;
+
+    /**
+     * Creates io_uring instance with the given number of submission entries, completion queue is
+     * made four times bigger as multishot operations could produce many completions per submission
+     */
+    void Init(unsigned entries);
+
+    /**
+     * Returns new zeroed submission entry or nullptr if submission queue is full. In the latter
+     * case Submit must be called to pass queued entries to the kernel
+     */
+    struct io_uring_sqe *GetSqe();
+
+    /**
+     * Returns how many submission entries could be taken by GetSqe before queue gets full
+     */
+    unsigned SpaceLeft() const;
+
+    /**
+     * Pass all queued submission entries to the kernel and waits until at least wait_nr completions
+     * are available. Returns number of entries consumed by the kernel
+     */
+    int Submit(unsigned wait_nr);
+
+    /**
+     * Returns next available completion or nullptr if there are no completions yet. Once completion
+     * is processed SeenCqe must be called to release it back to the kernel
+     */
+    struct io_uring_cqe *PeekCqe();
+
+    /**
+     * Releases completion obtained by PeekCqe
+     */
+    void SeenCqe();
+
+    /**
+     * Register ring of count provided buffers of the given size under group id group. After that
+     * operations flagged with IOSQE_BUFFER_SELECT picks buffers from the ring by themselves
+     */
+    void SetupBuffers(uint16_t group, uint16_t count, uint32_t size);
+
+    /**
+     * Returns memory of the provided buffer with the given id
+     */
+    inline char *Buffer(uint16_t bid) const { return buffers + size_t(bid) * buffer_size; }
+
+    /**
+     * Gives buffer back to the kernel, so that it could be used by the next recv
+     */
+    void RecycleBuffer(uint16_t bid);
+
+    /**
+     * Checks that running kernel has everything required by the server: provided buffer rings,
+     * multishot accept & recv
+     */
+    static bool Supported();
+
+private:
+    void Destroy();
+
+    // io_uring instance descriptor
+    int ring_fd;
+
+    // Submission queue
+    void *sq_ptr;
+    size_t sq_size;
+    unsigned *sq_khead;
+    unsigned *sq_ktail;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned sqe_tail;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    // Completion queue
+    void *cq_ptr;
+    size_t cq_size;
+    unsigned *cq_khead;
+    unsigned *cq_ktail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    // Provided buffers ring, shared with kernel
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_size;
+    uint16_t buf_mask;
+    uint16_t buf_tail;
+    uint16_t buf_group;
+
+    // Memory backing provided buffers
+    char *buffers;
+    size_t buffers_size;
+    uint32_t buffer_size;
+};
+
+} // namespace Uring
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_URING_RING_H
@@ -0,0 +1,81 @@
+#include "ServerImpl.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <netinet/in.h>
+
+#include <afina/Storage.h>
+#include <afina/logging/Logger.h>
+
+#include "Ring.h"
+#include "Worker.h"
+
+namespace Afina {
+namespace Network {
+namespace Uring {
+
+// See Server.h
+ServerImpl::ServerImpl(std::shared_ptr<Afina::Storage> ps) : Server(ps) {}
+
+// See Server.h
+ServerImpl::~ServerImpl() {}
+
+// See ServerImpl.h
+bool ServerImpl::Supported() { return Ring::Supported(); }
+
+// See Server.h
+void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
+    LOG_DEBUG(__PRETTY_FUNCTION__);
+
+    struct sockaddr_in server_addr;
+    std::memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;         // IPv4
+    server_addr.sin_port = htons(port);       // TCP port number
+    server_addr.sin_addr.s_addr = INADDR_ANY; // Bind to any address
+
+    // Closing a socket received from the previous process would reset connections queued on it, so
+    // there is a worker for each of them even if fewer were asked for
+    if (adopted_sockets.size() > n_workers) {
+        LOG_WARNING("Run " << adopted_sockets.size() << " workers to serve all listening sockets taken over");
+        n_workers = uint16_t(adopted_sockets.size());
+    }
+
+    workers.reserve(n_workers);
+    for (uint16_t i = 0; i < n_workers; i++) {
+        workers.emplace_back(new Worker(pStorage));
+        workers.back()->Start(server_addr, i < adopted_sockets.size() ? adopted_sockets[i] : -1);
+    }
+
+    adopted_sockets.clear();
+}
+
+// See Server.h
+std::vector<int> ServerImpl::ListeningSockets() const {
+    std::vector<int> sockets;
+    for (auto &worker : workers) {
+        sockets.push_back(worker->ServerSocket());
+    }
+    return sockets;
+}
+
+// See Server.h
+void ServerImpl::Stop() {
+    LOG_DEBUG(__PRETTY_FUNCTION__);
+    for (auto &worker : workers) {
+        worker->Stop();
+    }
+}
+
+// See Server.h
+void ServerImpl::Join() {
+    LOG_DEBUG(__PRETTY_FUNCTION__);
+    for (auto &worker : workers) {
+        worker->Join();
+    }
+    workers.clear();
+}
+
+} // namespace Uring
+} // namespace Network
+} // namespace Afina
@@ -0,0 +1,52 @@
+#ifndef AFINA_NETWORK_URING_SERVER_H
+#define AFINA_NETWORK_URING_SERVER_H
+
+#include <memory>
+#include <vector>
+
+#include <afina/network/Server.h>
+
+namespace Afina {
+namespace Network {
+namespace Uring {
+
+// Forward declaration, see Worker.h
+class Worker;
+
+/**
+ * # Network resource manager implementation
+ * Server on top of io_uring, requires linux 6.0 or newer
+ */
+class ServerImpl : public Server {
+public:
+    ServerImpl(std::shared_ptr<Afina::Storage> ps);
+    ~ServerImpl();
+
+    // See Server.h
+    void Start(uint32_t port, uint16_t workers) override;
+
+    // See Server.h
+    void Stop() override;
+
+    // See Server.h
+    void Join() override;
+
+    /**
+     * Checks if running kernel provides all io_uring features server relies on. Caller should
+     * fall back to some other implementation otherwise
+     */
+    static bool Supported();
+
+    // See Server.h
+    std::vector<int> ListeningSockets() const override;
+
+private:
+    // Each worker runs its own ring and listening socket
+    std::vector<std::unique_ptr<Worker>> workers;
+};
+
+} // namespace Uring
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_URING_SERVER_H
@@ -0,0 +1,452 @@
+#include "Worker.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <afina/Storage.h>
+#include <afina/execute/Command.h>
+#include <afina/logging/Logger.h>
+
+namespace Afina {
+namespace Network {
+namespace Uring {
+
+const size_t Worker::MaxChainLength;
+const size_t Worker::MergeLimit;
+
+// See Worker.h
+Worker::Worker(std::shared_ptr<Afina::Storage> ps)
+    : pStorage(ps), started(false), running(false), server_socket(-1), wakeup_fd(-1), wakeup_value(0),
+      accept_armed(false) {}
+
+// See Worker.h
+Worker::~Worker() {
+    if (server_socket >= 0) {
+        close(server_socket);
+    }
+    if (wakeup_fd >= 0) {
+        close(wakeup_fd);
+    }
+}
+
+// See Worker.h
+void Worker::Start(const struct sockaddr_in &address, int _server_socket) {
+    LOG_DEBUG(__PRETTY_FUNCTION__);
+
+    // Each worker listens on its own socket, kernel balances connections between them
+    server_socket = _server_socket;
+    if (server_socket < 0) {
+        server_socket = socket(PF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (server_socket == -1) {
+            throw std::runtime_error("Failed to open socket");
+        }
+
+        int opts = 1;
+        if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opts, sizeof(opts)) == -1 ||
+            setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &opts, sizeof(opts)) == -1) {
+            throw std::runtime_error("Socket setsockopt() failed");
+        }
+
+        if (bind(server_socket, (const struct sockaddr *)&address, sizeof(address)) == -1) {
+            throw std::runtime_error("Socket bind() failed");
+        }
+
+        if (listen(server_socket, 511) == -1) {
+            throw std::runtime_error("Socket listen() failed");
+        }
+    }
+
+    wakeup_fd = eventfd(0, EFD_CLOEXEC);
+    if (wakeup_fd == -1) {
+        throw std::runtime_error("Failed to create eventfd");
+    }
+
+    ring.Init(RingEntries);
+    ring.SetupBuffers(BufferGroup, BufferCount, BufferSize);
+
+    running.store(true);
+    if (pthread_create(&thread, NULL, Worker::OnRunProxy, this) != 0) {
+        running.store(false);
+        throw std::runtime_error("Could not create worker thread");
+    }
+    started = true;
+}
+
+// See Worker.h
+void Worker::Stop() {
+    LOG_DEBUG(__PRETTY_FUNCTION__);
+    running.store(false);
+    if (!started) {
+        return;
+    }
+
+    uint64_t one = 1;
+    if (write(wakeup_fd, &one, sizeof(one)) != sizeof(one)) {
+        LOG_ERROR("Failed to wake up worker: " << std::strerror(errno));
+    }
+}
+
+// See Worker.h
+void Worker::Join() {
+    LOG_DEBUG(__PRETTY_FUNCTION__);
+    if (!started) {
+        return;
+    }
+    pthread_join(thread, NULL);
+    started = false;
+}
+
+// See Worker.h
+void *Worker::OnRunProxy(void *p) {
+    Worker *worker = reinterpret_cast<Worker *>(p);
+    try {
+        worker->OnRun();
+    } catch (std::runtime_error &ex) {
+        LOG_ERROR("Worker fails: " << ex.what());
+    }
+    return 0;
+}
+
+// See Worker.h
+void Worker::OnRun() {
+    LOG_DEBUG(__PRETTY_FUNCTION__);
+
+    ArmWakeup();
+    ArmAccept();
+
+    // Loop is alive until there is something referencing the ring, each iteration does single
+    // syscall which submits everything queued by the previous one and reaps completions
+    while (running.load() || accept_armed || !alive.empty()) {
+        ring.Submit(1);
+
+        struct io_uring_cqe *cqe;
+        while ((cqe = ring.PeekCqe()) != nullptr) {
+            uint64_t data = cqe->user_data;
+            Connection *conn = reinterpret_cast<Connection *>(data & ~uint64_t(opMask));
+
+            switch (data & opMask) {
+            case opAccept:
+                OnAccept(cqe);
+                break;
+            case opRecv:
+                OnRecv(conn, cqe);
+                break;
+            case opSend:
+                OnSend(conn, cqe);
+                break;
+            case opWakeup:
+                OnWakeup(cqe);
+                break;
+            default:
+                break;
+            }
+            ring.SeenCqe();
+        }
+
+        // Responses of all commands that arrive in the current batch are sent together. Connection
+        // might have been closed in the same batch, it is kept until now and released here
+        for (auto conn : dirty) {
+            conn->dirty = false;
+            Flush(conn);
+            ReleaseIfPossible(conn);
+        }
+        dirty.clear();
+    }
+
+    LOG_DEBUG(__PRETTY_FUNCTION__ << " done");
+}
+
+// See Worker.h
+struct io_uring_sqe *Worker::Sqe() {
+    struct io_uring_sqe *sqe = ring.GetSqe();
+    while (sqe == nullptr) {
+        ring.Submit(0);
+        sqe = ring.GetSqe();
+    }
+    return sqe;
+}
+
+// See Worker.h
+void Worker::ArmAccept() {
+    struct io_uring_sqe *sqe = Sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server_socket;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = opAccept;
+    accept_armed = true;
+}
+
+// See Worker.h
+void Worker::ArmRecv(Connection *conn) {
+    struct io_uring_sqe *sqe = Sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BufferGroup;
+    sqe->user_data = reinterpret_cast<uint64_t>(conn) | opRecv;
+    conn->pending++;
+}
+
+// See Worker.h
+void Worker::ArmWakeup() {
+    struct io_uring_sqe *sqe = Sqe();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeup_fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&wakeup_value);
+    sqe->len = sizeof(wakeup_value);
+    sqe->user_data = opWakeup;
+}
+
+// See Worker.h
+void Worker::OnAccept(struct io_uring_cqe *cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        accept_armed = false;
+    }
+
+    if (cqe->res >= 0) {
+        if (running.load()) {
+            // Responses are sent by separate linked sends, with Nagle on the next chain waits for
+            // the client to ack the previous one, which is delayed ack timeout for pipelined requests
+            int one = 1;
+            setsockopt(cqe->res, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            Connection *conn = new Connection(cqe->res);
+            alive.insert(conn);
+            ArmRecv(conn);
+        } else {
+            close(cqe->res);
+        }
+    } else if (cqe->res != -ECANCELED) {
+        LOG_ERROR("Failed to accept: " << std::strerror(-cqe->res));
+    }
+
+    if (!accept_armed && running.load()) {
+        ArmAccept();
+    }
+}
+
+// See Worker.h
+void Worker::OnRecv(Connection *conn, struct io_uring_cqe *cqe) {
+    bool more = cqe->flags & IORING_CQE_F_MORE;
+    if (!more) {
+        conn->pending--;
+    }
+
+    if (cqe->res > 0) {
+        uint16_t bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        if (conn->state != ConnectionState::sClosed) {
+            Process(conn, ring.Buffer(bid), cqe->res);
+        }
+        ring.RecycleBuffer(bid);
+    } else if (cqe->res == 0) {
+        // Client is done with sending, responses for what was already read still must go out
+        conn->close_on_flush = true;
+        if (conn->output.empty() && conn->sending.empty()) {
+            Close(conn);
+        }
+    } else if (cqe->res != -ENOBUFS) {
+        Close(conn);
+    }
+
+    // Out of provided buffers or kernel decided to terminate multishot, just rearm it
+    if (!more && conn->state != ConnectionState::sClosed && !conn->close_on_flush) {
+        ArmRecv(conn);
+    }
+    ReleaseIfPossible(conn);
+}
+
+// See Worker.h
+void Worker::OnSend(Connection *conn, struct io_uring_cqe *cqe) {
+    conn->pending--;
+
+    bool failed = cqe->res < 0 || size_t(cqe->res) != conn->sending.front().size();
+    conn->sending.pop_front();
+
+    if (failed) {
+        // Rest of the chain get cancelled by kernel
+        Close(conn);
+    } else if (conn->sending.empty()) {
+        Flush(conn);
+    }
+    ReleaseIfPossible(conn);
+}
+
+// See Worker.h
+void Worker::OnWakeup(struct io_uring_cqe *cqe) {
+    if (running.load()) {
+        ArmWakeup();
+        return;
+    }
+
+    // Stop accepting new connections, kernel will complete accept with ECANCELED
+    if (accept_armed) {
+        struct io_uring_sqe *sqe = Sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = opAccept;
+        sqe->user_data = opCancel;
+    }
+
+    // Let connections to send out what they have and close them
+    std::vector<Connection *> connections(alive.begin(), alive.end());
+    for (auto conn : connections) {
+        conn->close_on_flush = true;
+        if (conn->output.empty() && conn->sending.empty()) {
+            Close(conn);
+        }
+        ReleaseIfPossible(conn);
+    }
+}
+
+// See Worker.h
+void Worker::Process(Connection *conn, const char *data, size_t size) {
+    size_t pos = 0;
+    try {
+        while (pos < size && !conn->close_on_flush) {
+            if (conn->state == ConnectionState::sRecvHeader) {
+                size_t parsed = 0;
+                bool complete = conn->parser.Parse(data + pos, size - pos, parsed);
+                pos += parsed;
+                if (!complete) {
+                    continue;
+                }
+
+                conn->cmd = conn->parser.Build(conn->body_size);
+                if (conn->body_size > 0) {
+                    conn->body.clear();
+                    conn->state = ConnectionState::sRecvBody;
+                } else {
+                    Execute(conn);
+                }
+            } else if (conn->state == ConnectionState::sRecvBody) {
+                size_t for_copy = std::min(size_t(conn->body_size), size - pos);
+                conn->body.append(data + pos, for_copy);
+                conn->body_size -= for_copy;
+                pos += for_copy;
+
+                if (conn->body_size == 0 && conn->parser.Binary()) {
+                    Execute(conn);
+                } else if (conn->body_size == 0) {
+                    conn->state = ConnectionState::sRecvTrailerCR;
+                }
+            } else if (conn->state == ConnectionState::sRecvTrailerCR) {
+                if (data[pos] != '\r') {
+                    throw std::runtime_error("Invalid chat, \\r expected");
+                }
+                pos++;
+                conn->state = ConnectionState::sRecvTrailerLF;
+            } else if (conn->state == ConnectionState::sRecvTrailerLF) {
+                if (data[pos] != '\n') {
+                    throw std::runtime_error("Invalid chat, \\n expected");
+                }
+                pos++;
+                Execute(conn);
+            }
+        }
+    } catch (std::runtime_error &ex) {
+        // Parser throws exception in case if something goes wrong with input data format
+        conn->output.push_back(conn->parser.Frame(std::string("CLIENT_ERROR ") + ex.what()));
+        conn->close_on_flush = true;
+    }
+
+    if (!conn->output.empty() && !conn->dirty) {
+        conn->dirty = true;
+        dirty.push_back(conn);
+    }
+}
+
+// See Worker.h
+void Worker::Execute(Connection *conn) {
+    std::string out;
+    try {
+        conn->cmd->Execute(*pStorage, conn->body, out);
+    } catch (std::runtime_error &ex) {
+        out = std::string("SERVER_ERROR ") + ex.what();
+    }
+    out = conn->parser.Frame(std::move(out));
+    if (out.empty()) {
+        // Nothing to send
+    } else if (!conn->output.empty() && conn->output.back().size() + out.size() <= MergeLimit) {
+        conn->output.back().append(out);
+    } else {
+        conn->output.push_back(std::move(out));
+    }
+
+    conn->cmd = nullptr;
+    conn->body.clear();
+    conn->parser.Reset();
+    conn->state = ConnectionState::sRecvHeader;
+}
+
+// See Worker.h
+void Worker::Flush(Connection *conn) {
+    if (conn->state == ConnectionState::sClosed || !conn->sending.empty()) {
+        return;
+    }
+
+    if (conn->output.empty()) {
+        if (conn->close_on_flush) {
+            Close(conn);
+        }
+        return;
+    }
+
+    // Chain must not be split between two submissions
+    size_t chain = std::min(conn->output.size(), MaxChainLength);
+    if (ring.SpaceLeft() < chain) {
+        ring.Submit(0);
+    }
+
+    for (size_t i = 0; i < chain; i++) {
+        conn->sending.push_back(std::move(conn->output.front()));
+        conn->output.pop_front();
+        const std::string &buf = conn->sending.back();
+
+        struct io_uring_sqe *sqe = Sqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = conn->fd;
+        sqe->addr = reinterpret_cast<uint64_t>(buf.data());
+        sqe->len = buf.size();
+        // Kernel holds data of the chain until the last send, so it goes out in full segments
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL | ((i + 1 < chain) ? MSG_MORE : 0);
+        sqe->flags = (i + 1 < chain) ? IOSQE_IO_LINK : 0;
+        sqe->user_data = reinterpret_cast<uint64_t>(conn) | opSend;
+        conn->pending++;
+    }
+}
+
+// See Worker.h
+void Worker::Close(Connection *conn) {
+    if (conn->state == ConnectionState::sClosed) {
+        return;
+    }
+
+    // Shutdown terminates multishot recv and all pending sends, connection memory is released once
+    // the last of them completes
+    conn->state = ConnectionState::sClosed;
+    shutdown(conn->fd, SHUT_RDWR);
+}
+
+// See Worker.h
+void Worker::ReleaseIfPossible(Connection *conn) {
+    if (conn->state != ConnectionState::sClosed || conn->pending > 0 || conn->dirty) {
+        return;
+    }
+
+    close(conn->fd);
+    alive.erase(conn);
+    delete conn;
+}
+
+} // namespace Uring
+} // namespace Network
+} // namespace Afina
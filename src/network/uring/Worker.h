@@ -0,0 +1,205 @@
+#ifndef AFINA_NETWORK_URING_WORKER_H
+#define AFINA_NETWORK_URING_WORKER_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <pthread.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <netinet/in.h>
+
+#include <afina/execute/Command.h>
+#include <protocol/Parser.h>
+
+#include "Ring.h"
+
+namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+
+namespace Network {
+namespace Uring {
+
+/**
+ * # Thread running io_uring event loop
+ * Each worker owns its own listening socket bound with SO_REUSEPORT, so kernel balances incoming
+ * connections between workers. All network io goes through the ring: multishot accept, multishot
+ * recv into provided buffers and chains of linked sends, so that single io_uring_enter call serves
+ * many requests
+ */
+class Worker {
+public:
+    Worker(std::shared_ptr<Afina::Storage> ps);
+    ~Worker();
+
+    Worker(const Worker &) = delete;
+    Worker &operator=(const Worker &) = delete;
+
+    /**
+     * Creates listening socket and spawns background thread running event loop. If server_socket
+     * isn't negative it is used as already bound listening socket instead
+     */
+    void Start(const struct sockaddr_in &address, int server_socket = -1);
+
+    /**
+     * Listening socket owned by the worker
+     */
+    inline int ServerSocket() const { return server_socket; }
+
+    /**
+     * Signal background thread to stop. After that worker stops to accept new connections,
+     * sends out responses for already executed commands and closes connections
+     */
+    void Stop();
+
+    /**
+     * Blocks calling thread until background one for this worker is actually
+     * been destoryed. Returns immediately if thread hasn't been started, i.e. Start failed
+     */
+    void Join();
+
+protected:
+    /**
+     * Method executing by background thread
+     */
+    void OnRun();
+
+private:
+    // Number of submission entries in the ring
+    static const unsigned RingEntries = 1024;
+
+    // Provided buffers used by recv operations
+    static const uint16_t BufferGroup = 0;
+    static const uint16_t BufferCount = 512;
+    static const uint32_t BufferSize = 4096;
+
+    // Type of the operation is kept in lower bits of user_data, upper bits are pointer to the
+    // connection
+    enum Operation : uint64_t { opAccept = 0, opRecv = 1, opSend = 2, opWakeup = 3, opCancel = 4, opMask = 7 };
+
+    // Maximum number of sends linked into a single chain
+    static const size_t MaxChainLength = 64;
+
+    // Small responses queued one after another are merged up to that size, so that pipelined
+    // requests are answered by a single send rather than one per response
+    static const size_t MergeLimit = 16 * 1024;
+
+    // Determinates how connection reacts on input, same as in UV server
+    enum ConnectionState : uint8_t { sRecvHeader, sRecvBody, sRecvTrailerCR, sRecvTrailerLF, sClosed };
+
+    /**
+     * Holds information about single connection from the client
+     */
+    struct Connection {
+        Connection(int _fd)
+            : fd(_fd), state(ConnectionState::sRecvHeader), cmd(nullptr), body_size(0), pending(0),
+              close_on_flush(false), dirty(false) {}
+
+        int fd;
+
+        // Current connection state, defines how input is processed
+        ConnectionState state;
+
+        // State of the header parser
+        Protocol::Parser parser;
+
+        // Command parsed out from the input, owned by the parser
+        Execute::Command *cmd;
+
+        // Number of bytes left to read to get command argument
+        uint32_t body_size;
+
+        // Argument for the command
+        std::string body;
+
+        // Responses that wasn't submitted yet
+        std::deque<std::string> output;
+
+        // Responses submitted to the kernel as a single linked chain of sends. Deque keeps
+        // addresses of strings stable while kernel reads them
+        std::deque<std::string> sending;
+
+        // Number of operations in the ring referencing connection, it could be released only
+        // once counter drops to zero
+        size_t pending;
+
+        // Close connection once all responses are sent
+        bool close_on_flush;
+
+        // Connection has new output to be flushed at the end of current batch
+        bool dirty;
+    };
+
+    static void *OnRunProxy(void *p);
+
+    // Returns submission entry, flushing queue to the kernel if needs
+    struct io_uring_sqe *Sqe();
+
+    void ArmAccept();
+    void ArmRecv(Connection *conn);
+    void ArmWakeup();
+
+    void OnAccept(struct io_uring_cqe *cqe);
+    void OnRecv(Connection *conn, struct io_uring_cqe *cqe);
+    void OnSend(Connection *conn, struct io_uring_cqe *cqe);
+    void OnWakeup(struct io_uring_cqe *cqe);
+
+    /**
+     * Feeds received bytes into connection state machine, executes parsed commands and queues
+     * responses
+     */
+    void Process(Connection *conn, const char *data, size_t size);
+
+    /**
+     * Execute last command readed from the connection and queue its response
+     */
+    void Execute(Connection *conn);
+
+    /**
+     * Submit all queued responses as a chain of linked sends
+     */
+    void Flush(Connection *conn);
+
+    /**
+     * Shutdown connection, it will be released once all operations on it are complete
+     */
+    void Close(Connection *conn);
+    void ReleaseIfPossible(Connection *conn);
+
+    std::shared_ptr<Afina::Storage> pStorage;
+
+    Ring ring;
+
+    pthread_t thread;
+
+    // Background thread has been created and not joined yet, thread is valid only then
+    bool started;
+
+    std::atomic<bool> running;
+
+    // Listening socket owned by this worker
+    int server_socket;
+
+    // eventfd used to wake up event loop from the outside
+    int wakeup_fd;
+    uint64_t wakeup_value;
+
+    // Multishot accept is active
+    bool accept_armed;
+
+    // All open connections
+    std::unordered_set<Connection *> alive;
+
+    // Connections having responses to flush once current batch of completions is processed
+    std::vector<Connection *> dirty;
+};
+
+} // namespace Uring
+} // namespace Network
+} // namespace Afina
+
+#endif // AFINA_NETWORK_URING_WORKER_H
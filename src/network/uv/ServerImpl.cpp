@@ -1,11 +1,11 @@
 #include "ServerImpl.h"
 
 #include <cassert>
-#include <iostream>
 #include <stdexcept>
 #include <sys/mman.h>
 
 #include <afina/Storage.h>
+#include <afina/logging/Logger.h>
 
 namespace Afina {
 namespace Network {
@@ -22,15 +22,25 @@ void ServerImpl::Start(uint32_t port, uint16_t n_workers) {
     struct sockaddr_storage address;
     int rc = uv_ip4_addr("0.0.0.0", port, (struct sockaddr_in *)&address);
     if (rc != 0) {
-        std::cerr << "Failed to call uv_ip4_addr: [" << uv_err_name(rc) << "(" << rc << ")]: " << uv_strerror(rc)
-                  << std::endl;
+        LOG_ERROR("Failed to call uv_ip4_addr: [" << uv_err_name(rc) << "(" << rc << ")]: " << uv_strerror(rc));
         throw std::runtime_error("Failed to call uv_ip4_addr");
     }
 
-    for (auto i = 0; i < n_workers; i++) {
+    // Closing a socket received from the previous process would reset connections queued on it, so
+    // there is a worker for each of them even if fewer were asked for
+    if (adopted_sockets.size() > n_workers) {
+        LOG_WARNING("Run " << adopted_sockets.size() << " workers to serve all listening sockets taken over");
+        n_workers = uint16_t(adopted_sockets.size());
+    }
+
+    for (size_t i = 0; i < n_workers; i++) {
         workers.push_back(new Worker(pStorage));
-        workers[i]->Start(address);
+        workers[i]->SetOutputLimits(connection_output_limit, worker_output_limit);
+        workers[i]->SetTimeouts(idle_timeout, read_timeout);
+        workers[i]->Start(address, i < adopted_sockets.size() ? adopted_sockets[i] : -1);
     }
+
+    adopted_sockets.clear();
 }
 
 // See Server.h
@@ -47,6 +57,15 @@ void ServerImpl::Join() {
     }
 }
 
+// See Server.h
+std::vector<int> ServerImpl::ListeningSockets() const {
+    std::vector<int> sockets;
+    for (auto worker : workers) {
+        sockets.push_back(worker->ServerSocket());
+    }
+    return sockets;
+}
+
 } // namespace UV
 } // namespace Network
 } // namespace Afina
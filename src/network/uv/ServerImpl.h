@@ -31,6 +31,9 @@ public:
     // See Server.h
     void Join() override;
 
+    // See Server.h
+    std::vector<int> ListeningSockets() const override;
+
 protected:
     /**
      * List of all workers created for this instance of server
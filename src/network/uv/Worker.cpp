@@ -3,12 +3,12 @@
 #include <arpa/inet.h>
 #include <cassert>
 #include <cstring>
-#include <iostream>
 #include <sstream>
 #include <stdexcept>
 
 #include <afina/Storage.h>
 #include <afina/execute/Command.h>
+#include <afina/logging/Logger.h>
 
 namespace Afina {
 namespace Network {
@@ -45,6 +45,11 @@ template <typename T, typename... Types> struct delegate {
         (instance->*TMethod)(self, std::forward<Types>(args)...);
     }
 
+    template <void (T::*TMethod)(uv_timer_t *, Types...)> static void callback(uv_timer_t *self, Types... args) {
+        T *instance = static_cast<T *>(self->data);
+        (instance->*TMethod)(self, std::forward<Types>(args)...);
+    }
+
     template <void (T::*TMethod)(Types...)> static void callback(Types... args, void *data) {
         T *instance = static_cast<T *>(data);
         (instance->*TMethod)(std::forward<Types>(args)...);
@@ -54,7 +59,7 @@ template <typename T, typename... Types> struct delegate {
 void noop(uv_signal_t *handle, int signum) {}
 
 // See Worker.h
-void Worker::Start(const struct sockaddr_storage &address) {
+void Worker::Start(const struct sockaddr_storage &address, int server_socket) {
     // Init loop
     int rc = uv_loop_init(&uvLoop);
     if (rc != 0) {
@@ -83,44 +88,75 @@ void Worker::Start(const struct sockaddr_storage &address) {
     uvSigPipe.data = this;
     uv_signal_start(&uvSigPipe, noop, SIGPIPE);
 
-    // Setup Network
-    rc = uv_tcp_init_ex(&uvLoop, &uvNetwork, address.ss_family);
-    if (rc != 0) {
-        std::stringstream ss;
-        ss << "Failed to call uv_tcp_init_ex: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
-        throw std::runtime_error(ss.str());
+    // Init timeouts, the only timer walks the wheel with its resolution
+    if (idle_timeout > 0 || read_timeout > 0) {
+        rc = uv_timer_init(&uvLoop, &uvTimeoutTimer);
+        if (rc != 0) {
+            std::stringstream ss;
+            ss << "Failed to call uv_timer_init: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
+            throw std::runtime_error(ss.str());
+        }
+        uvTimeoutTimer.data = this;
+        timers.Reset(uv_now(&uvLoop));
+        uv_timer_start(&uvTimeoutTimer, delegate<Worker>::callback<&Worker::OnTimeoutTick>, TimerTick, TimerTick);
     }
-    uvNetwork.data = this;
 
-    // Configure network
-    int fd;
-    rc = uv_fileno((uv_handle_t *)&uvNetwork, &fd);
-    if (rc != 0) {
-        std::stringstream ss;
-        ss << "Failed to call uv_fileno: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
-        throw std::runtime_error(ss.str());
-    }
+    // Setup Network
+    if (server_socket >= 0) {
+        // Socket is already bound, i.e inherited from the previous process
+        rc = uv_tcp_init(&uvLoop, &uvNetwork);
+        if (rc != 0) {
+            std::stringstream ss;
+            ss << "Failed to call uv_tcp_init: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
+            throw std::runtime_error(ss.str());
+        }
+        uvNetwork.data = this;
 
-    rc = uv_tcp_keepalive(&uvNetwork, 1, 60);
-    if (rc != 0) {
-        std::stringstream ss;
-        ss << "Failed to call uv_tcp_keepalive: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
-        throw std::runtime_error(ss.str());
-    }
+        rc = uv_tcp_open(&uvNetwork, server_socket);
+        if (rc != 0) {
+            std::stringstream ss;
+            ss << "Failed to call uv_tcp_open: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
+            throw std::runtime_error(ss.str());
+        }
+    } else {
+        rc = uv_tcp_init_ex(&uvLoop, &uvNetwork, address.ss_family);
+        if (rc != 0) {
+            std::stringstream ss;
+            ss << "Failed to call uv_tcp_init_ex: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
+            throw std::runtime_error(ss.str());
+        }
+        uvNetwork.data = this;
 
-    int on = 1;
-    rc = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
-    if (rc != 0) {
-        std::stringstream ss;
-        ss << "Failed to call setsockopt: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
-        throw std::runtime_error(ss.str());
-    }
+        // Configure network
+        int fd;
+        rc = uv_fileno((uv_handle_t *)&uvNetwork, &fd);
+        if (rc != 0) {
+            std::stringstream ss;
+            ss << "Failed to call uv_fileno: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
+            throw std::runtime_error(ss.str());
+        }
 
-    rc = uv_tcp_bind(&uvNetwork, (const struct sockaddr *)&address, 0);
-    if (rc != 0) {
-        std::stringstream ss;
-        ss << "Failed to call uv_tcp_bind: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
-        throw std::runtime_error(ss.str());
+        rc = uv_tcp_keepalive(&uvNetwork, 1, 60);
+        if (rc != 0) {
+            std::stringstream ss;
+            ss << "Failed to call uv_tcp_keepalive: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
+            throw std::runtime_error(ss.str());
+        }
+
+        int on = 1;
+        rc = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+        if (rc != 0) {
+            std::stringstream ss;
+            ss << "Failed to call setsockopt: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
+            throw std::runtime_error(ss.str());
+        }
+
+        rc = uv_tcp_bind(&uvNetwork, (const struct sockaddr *)&address, 0);
+        if (rc != 0) {
+            std::stringstream ss;
+            ss << "Failed to call uv_tcp_bind: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
+            throw std::runtime_error(ss.str());
+        }
     }
 
     rc = uv_listen((uv_stream_t *)&uvNetwork, 511, delegate<Worker, int>::callback<&Worker::OnConnectionOpen>);
@@ -139,6 +175,25 @@ void Worker::Start(const struct sockaddr_storage &address) {
     }
 }
 
+// See Worker.h
+void Worker::SetOutputLimits(size_t connection, size_t worker) {
+    connection_output_limit = connection;
+    worker_output_limit = worker;
+}
+
+// See Worker.h
+void Worker::SetTimeouts(uint32_t idle, uint32_t read) {
+    idle_timeout = idle;
+    read_timeout = read;
+}
+
+// See Worker.h
+int Worker::ServerSocket() const {
+    uv_os_fd_t fd = -1;
+    uv_fileno((const uv_handle_t *)&uvNetwork, &fd);
+    return fd;
+}
+
 // See Worker.h
 void Worker::Stop() { uv_async_send(&uvStopAsync); }
 
@@ -163,12 +218,15 @@ void Worker::OnRun() {
 // before actually terminate the loop
 // See Worker.h
 void Worker::OnStop(uv_async_t *async) {
-    std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
 
     // Stop accept new incomming connections
     uv_close((uv_handle_t *)&uvStopAsync, delegate<Worker>::callback<&Worker::OnHandleClosed>);
     uv_close((uv_handle_t *)&uvSigPipe, delegate<Worker>::callback<&Worker::OnHandleClosed>);
     uv_close((uv_handle_t *)&uvNetwork, delegate<Worker>::callback<&Worker::OnHandleClosed>);
+    if (idle_timeout > 0 || read_timeout > 0) {
+        uv_close((uv_handle_t *)&uvTimeoutTimer, delegate<Worker>::callback<&Worker::OnHandleClosed>);
+    }
 
     // Mark all connections as closed. It is seems possible to not Track
     // connection close state separately in each connection
@@ -188,7 +246,7 @@ void Worker::OnStop(uv_async_t *async) {
 
 // See Worker.h
 void Worker::OnHandleClosed(uv_handle_t *h) {
-    std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     CloseEventLoppIfPossible();
 }
 
@@ -196,9 +254,10 @@ void Worker::OnHandleClosed(uv_handle_t *h) {
 // callback, that one is used for async & server socket handler
 // See Worker.h
 void Worker::OnConnectionClosed(uv_handle_t *h) {
-    std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     Connection *pconn = reinterpret_cast<Connection *>(h);
     assert(pconn->runningTasks == 0);
+    timers.Cancel(&pconn->timer);
 
     if (alive.erase(pconn) != 0) {
         delete pconn;
@@ -227,7 +286,7 @@ void Worker::CloseEventLoppIfPossible() {
 // always reacts to what it gets
 // See Worker.h
 void Worker::OnConnectionOpen(uv_stream_t *server, int status) {
-    std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     // Allocate new connection from the memory pool
     Connection *pconn = new Connection;
     alive.insert(pconn);
@@ -239,7 +298,7 @@ void Worker::OnConnectionOpen(uv_stream_t *server, int status) {
     // Setup client socket
     int rc = uv_accept(server, (uv_stream_t *)pconn);
     if (rc != 0) {
-        std::cerr << "Failed to call uv_accept: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
+        LOG_ERROR("Failed to call uv_accept: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc));
         uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnHandleClosed>);
         return;
     }
@@ -248,10 +307,11 @@ void Worker::OnConnectionOpen(uv_stream_t *server, int status) {
     rc = uv_read_start((uv_stream_t *)pconn, delegate<Worker, size_t, uv_buf_t *>::callback<&Worker::OnAllocate>,
                        delegate<Worker, ssize_t, const uv_buf_t *>::callback<&Worker::OnRead>);
     if (rc != 0) {
-        std::cerr << "Failed to call uv_read_start: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc);
+        LOG_ERROR("Failed to call uv_read_start: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc));
         uv_close((uv_handle_t *)(pconn), delegate<Worker>::callback<&Worker::OnHandleClosed>);
         return;
     }
+    Touch(pconn);
 }
 
 // Just before read, libuv calls that method to allocate some memory chunk where read copies socket data.
@@ -278,7 +338,7 @@ void Worker::OnAllocate(uv_handle_t *conn, size_t suggested_size, uv_buf_t *buf)
 // data read, pconn->in writer position must be updated
 // See Worker.h
 void Worker::OnRead(uv_stream_t *conn, ssize_t nread, const uv_buf_t *buf) {
-    std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     assert(conn != nullptr);
     Connection *pconn = (Connection *)(conn);
 
@@ -290,15 +350,33 @@ void Worker::OnRead(uv_stream_t *conn, ssize_t nread, const uv_buf_t *buf) {
         return;
     }
 
+    pconn->input_used += nread;
+    Process(pconn);
+    Touch(pconn);
+}
+
+// See Worker.h
+void Worker::Process(Connection *pconn) {
     // Look for the command delimeters in the [parsed, input.size()). Note that buffer could contains
     // many commands, not only one
     try {
-        pconn->input_used += nread;
         while (pconn->input_parsed < pconn->input_used) {
+            // Client doesn't read responses fast enough, leave the rest of input in the buffer
+            // until output drains
+            if (OutputFull(pconn)) {
+                pconn->paused = true;
+                uv_read_stop((uv_stream_t *)pconn);
+                break;
+            }
+
             // Read header or body if needs
             if (pconn->state == ConnectionState::sRecvHeader) {
                 // Try to parse command out
-                if (!pconn->parser.Parse(pconn->input, pconn->input_used, pconn->input_parsed)) {
+                size_t parsed = 0;
+                bool complete = pconn->parser.Parse(pconn->input + pconn->input_parsed,
+                                                    pconn->input_used - pconn->input_parsed, parsed);
+                pconn->input_parsed += parsed;
+                if (!complete) {
                     continue;
                 }
 
@@ -321,7 +399,8 @@ void Worker::OnRead(uv_stream_t *conn, ssize_t nread, const uv_buf_t *buf) {
                 pconn->input_parsed += for_copy;
 
                 if (pconn->body_size == 0) {
-                    pconn->state = ConnectionState::sRecvTrailerCR;
+                    pconn->state =
+                        pconn->parser.Binary() ? ConnectionState::sExecute : ConnectionState::sRecvTrailerCR;
                 }
             } else if (pconn->state == ConnectionState::sRecvTrailerCR) {
                 if (pconn->input[pconn->input_parsed] != '\r') {
@@ -340,7 +419,7 @@ void Worker::OnRead(uv_stream_t *conn, ssize_t nread, const uv_buf_t *buf) {
             if (pconn->state == ConnectionState::sExecute) {
                 Execute(*pconn);
 
-                pconn->cmd.reset();
+                pconn->cmd = nullptr;
                 pconn->body.clear();
                 pconn->parser.Reset();
                 pconn->state = ConnectionState::sRecvHeader;
@@ -352,20 +431,20 @@ void Worker::OnRead(uv_stream_t *conn, ssize_t nread, const uv_buf_t *buf) {
         std::stringstream ss;
         ss << "CLIENT_ERROR " << ex.what();
 
-        std::string output = ss.str();
+        std::string output = pconn->parser.Frame(ss.str());
 
         ExecuteTask *ptask = new ExecuteTask();
         ptask->connection = pconn;
         uv_async_init(&uvLoop, &ptask->done, delegate<Worker>::callback<&Worker::OnExecutionDone>);
         ptask->done.data = this;
 
-        size_t size = output.size() + 2;
+        size_t size = output.size();
         ptask->result.base = new char[size];
         ptask->result.len = size;
 
-        std::memcpy(ptask->result.base, &output[0], size - 2);
-        ptask->result.base[size - 2] = '\r';
-        ptask->result.base[size - 1] = '\n';
+        std::memcpy(ptask->result.base, output.data(), size);
+        pconn->output_size += size;
+        output_size += size;
 
         pconn->runningTasks++;
         pconn->state = ConnectionState::sClosed;
@@ -375,13 +454,30 @@ void Worker::OnRead(uv_stream_t *conn, ssize_t nread, const uv_buf_t *buf) {
 
 // See Worker.h
 void Worker::Execute(Connection &pconn) {
-    std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
+
+    // TODO: That should be in another thread
+    std::string output;
+    try {
+        pconn.cmd->Execute(*pStorage, pconn.body, output);
+    } catch (std::runtime_error &ex) {
+        LOG_ERROR("Failed to execute command: " << ex.what());
+
+        std::stringstream ss;
+        ss << "SERVER_ERROR " << ex.what();
+        output = ss.str();
+    }
+
+    // Quiet binary and noreply text commands have nothing to send, so there is no task to complete
+    output = pconn.parser.Frame(std::move(output));
+    if (output.empty()) {
+        return;
+    }
 
     // Setup execution params
     ExecuteTask *ptask = new ExecuteTask();
     ptask->connection = &pconn;
-    ptask->cmd = std::move(pconn.cmd);
-    ptask->argument = std::move(pconn.body);
+    ptask->cmd = pconn.cmd;
     pconn.runningTasks++;
 
     // Setup async signal to be called once task execution is complete
@@ -391,36 +487,22 @@ void Worker::Execute(Connection &pconn) {
     }
     ptask->done.data = this;
 
-    // TODO: That should be in another thread
-    {
-        std::string output;
-        try {
-            ptask->cmd->Execute(*pStorage, ptask->argument, output);
-        } catch (std::runtime_error &ex) {
-            std::cerr << "Failed to execute command: " << ex.what() << std::endl;
-
-            std::stringstream ss;
-            ss << "SERVER_ERROR " << ex.what();
-            output = ss.str();
-        }
-
-        // Prepare output
-        size_t size = output.size() + 2;
-        ptask->result.base = new char[size];
-        ptask->result.len = size;
+    // Prepare output
+    size_t size = output.size();
+    ptask->result.base = new char[size];
+    ptask->result.len = size;
 
-        std::memcpy(ptask->result.base, &output[0], size - 2);
-        ptask->result.base[size - 2] = '\r';
-        ptask->result.base[size - 1] = '\n';
+    std::memcpy(ptask->result.base, output.data(), size);
+    pconn.output_size += size;
+    output_size += size;
 
-        // Notify event loop about task completition
-        uv_async_send(&ptask->done);
-    }
+    // Notify event loop about task completition
+    uv_async_send(&ptask->done);
 }
 
 // See Worker.h
 void Worker::OnExecutionDone(uv_async_t *handle) {
-    std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
 
     assert(handle);
     ExecuteTask *task = (ExecuteTask *)((uint8_t *)handle - offsetof(ExecuteTask, done));
@@ -431,6 +513,7 @@ void Worker::OnExecutionDone(uv_async_t *handle) {
 
     // Send buffer to socket. Even if connection is already closed we are still try to write data out,
     // that would lead to possible write error which is ok and will be handled in the OnWriteDone
+    task->handler.data = this;
     int rc = uv_write(&task->handler, &task->connection->handler, &task->result, 1,
                       delegate<Worker, int>::callback<&Worker::OnWriteDone>);
     if (rc != 0) {
@@ -440,11 +523,15 @@ void Worker::OnExecutionDone(uv_async_t *handle) {
 
 // See Worker.h
 void Worker::OnWriteDone(uv_write_t *req, int status) {
-    std::cout << "network debug:" << __PRETTY_FUNCTION__ << std::endl;
+    LOG_DEBUG(__PRETTY_FUNCTION__);
     assert(req != nullptr);
     ExecuteTask *task = (ExecuteTask *)req;
     Connection *pconn = task->connection;
 
+    bool worker_was_full = (worker_output_limit != 0 && output_size >= worker_output_limit);
+    pconn->output_size -= task->result.len;
+    output_size -= task->result.len;
+
     task->connection->runningTasks--;
     if (task->connection->state == ConnectionState::sClosed && task->connection->runningTasks == 0) {
         uv_close((uv_handle_t *)(task->connection), delegate<Worker>::callback<&Worker::OnConnectionClosed>);
@@ -452,6 +539,87 @@ void Worker::OnWriteDone(uv_write_t *req, int status) {
 
     delete[] task->result.base;
     delete task;
+    Touch(pconn);
+
+    // Output drained, time to get back to the connections that were paused
+    if (worker_was_full && output_size < worker_output_limit) {
+        for (auto conn : alive) {
+            Resume(conn);
+        }
+    } else {
+        Resume(pconn);
+    }
+}
+
+// See Worker.h
+bool Worker::OutputFull(const Connection *pconn) const {
+    return (connection_output_limit != 0 && pconn->output_size >= connection_output_limit) ||
+           (worker_output_limit != 0 && output_size >= worker_output_limit);
+}
+
+// See Worker.h
+void Worker::Resume(Connection *pconn) {
+    if (!pconn->paused || pconn->state == ConnectionState::sClosed || OutputFull(pconn)) {
+        return;
+    }
+
+    pconn->paused = false;
+    Process(pconn);
+    if (pconn->paused || pconn->state == ConnectionState::sClosed) {
+        return;
+    }
+
+    int rc = uv_read_start((uv_stream_t *)pconn, delegate<Worker, size_t, uv_buf_t *>::callback<&Worker::OnAllocate>,
+                           delegate<Worker, ssize_t, const uv_buf_t *>::callback<&Worker::OnRead>);
+    if (rc != 0) {
+        LOG_ERROR("Failed to call uv_read_start: [" << uv_err_name(rc) << ", " << rc << "]: " << uv_strerror(rc));
+        CloseConnection(pconn);
+    }
+}
+
+// See Worker.h
+void Worker::Touch(Connection *pconn) {
+    if (pconn->state == ConnectionState::sClosed) {
+        return;
+    }
+
+    // Connection that has started to send command is expected to finish it soon
+    bool in_command = pconn->state != ConnectionState::sRecvHeader || pconn->input_parsed < pconn->input_used ||
+                      !pconn->parser.Idle();
+    uint32_t timeout = in_command ? read_timeout : idle_timeout;
+    if (timeout == 0) {
+        timers.Cancel(&pconn->timer);
+        return;
+    }
+
+    uint64_t deadline = uv_now(&uvLoop) + timeout;
+    if (pconn->timer.Scheduled() && deadline >= pconn->timer.deadline) {
+        // Wheel picks new deadline up lazily
+        pconn->timer.deadline = deadline;
+    } else {
+        timers.Schedule(&pconn->timer, deadline);
+    }
+}
+
+// See Worker.h
+void Worker::OnTimeoutTick(uv_timer_t *handle) {
+    expired.clear();
+    timers.Advance(uv_now(&uvLoop), expired);
+    for (TimerWheel::Timer *timer : expired) {
+        CloseConnection(reinterpret_cast<Connection *>(timer->data));
+    }
+}
+
+// See Worker.h
+void Worker::CloseConnection(Connection *pconn) {
+    if (pconn->state == ConnectionState::sClosed) {
+        return;
+    }
+    pconn->state = ConnectionState::sClosed;
+    uv_read_stop((uv_stream_t *)pconn);
+    if (pconn->runningTasks == 0) {
+        uv_close((uv_handle_t *)pconn, delegate<Worker>::callback<&Worker::OnConnectionClosed>);
+    }
 }
 
 } // namespace UV
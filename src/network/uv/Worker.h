@@ -7,6 +7,7 @@
 #include <vector>
 
 #include <afina/execute/Command.h>
+#include <network/TimerWheel.h>
 #include <protocol/Parser.h>
 
 namespace Afina {
@@ -24,13 +25,34 @@ namespace UV {
  */
 class Worker {
 public:
-    Worker(std::shared_ptr<Afina::Storage> pStorage) : pStorage(pStorage) {}
+    Worker(std::shared_ptr<Afina::Storage> pStorage)
+        : connection_output_limit(0), worker_output_limit(0), output_size(0), idle_timeout(0), read_timeout(0),
+          pStorage(pStorage) {}
     ~Worker() {}
 
     Worker(const Worker &) = delete;
     Worker &operator=(const Worker &) = delete;
 
-    void Start(const struct sockaddr_storage &addr);
+    /**
+     * Binds listening socket to the address and starts event loop thread. If server_socket isn't
+     * negative it is used as already bound listening socket instead
+     */
+    void Start(const struct sockaddr_storage &addr, int server_socket = -1);
+
+    /**
+     * Listening socket used by the worker
+     */
+    int ServerSocket() const;
+
+    /**
+     * See Server::SetOutputLimits, must be called before Start
+     */
+    void SetOutputLimits(size_t connection, size_t worker);
+
+    /**
+     * See Server::SetTimeouts, must be called before Start
+     */
+    void SetTimeouts(uint32_t idle, uint32_t read);
 
     /**
      * Signal worker that  it should stop. Method returns immediately, after that
@@ -51,6 +73,9 @@ protected:
     // Size of input buffer
     const static size_t ConnectionInputBufferSize = 64 * 1024L;
 
+    // Resolution of connection timeouts, ms
+    const static uint64_t TimerTick = 100;
+
     // Determinates how connection reacts on different async events, such as
     // new input data or command execution complete
     enum ConnectionState : uint8_t {
@@ -98,8 +123,8 @@ protected:
         // State of the header parser
         Protocol::Parser parser;
 
-        // Command parsed out from the input
-        std::unique_ptr<Execute::Command> cmd;
+        // Command parsed out from the input, owned by the parser
+        Execute::Command *cmd;
 
         // Number of bytes left to read to get command
         uint32_t body_size;
@@ -110,11 +135,21 @@ protected:
         // Number of tasks that are running now
         size_t runningTasks;
 
+        // Number of bytes of responses that wasn't written yet
+        size_t output_size;
+
+        // Reading is stopped because of output limits
+        bool paused;
+
+        // Idle/read timeout
+        TimerWheel::Timer timer;
+
         Connection()
             : state(ConnectionState::sRecvHeader), input(nullptr), input_used(0), input_parsed(0), cmd(nullptr),
-              body_size(0), body(""), runningTasks(0) {
+              body_size(0), body(""), runningTasks(0), output_size(0), paused(false) {
             input = new char[ConnectionInputBufferSize];
             parser.Reset();
+            timer.data = this;
         }
 
         ~Connection() { delete[] input; }
@@ -134,11 +169,9 @@ protected:
         // Connection that received command, used to write out response
         Connection *connection;
 
-        // Command to execute
-        std::unique_ptr<Execute::Command> cmd;
-
-        // Argument for the command
-        std::string argument;
+        // Command to execute, owned by the connection parser. Argument is the connection body, both
+        // are reused by the next request, so the task must be executed before it is parsed
+        Execute::Command *cmd;
 
         // Execution result
         uv_buf_t result;
@@ -186,6 +219,22 @@ protected:
      */
     void OnRead(uv_stream_t *, ssize_t nread, const uv_buf_t *buf);
 
+    /**
+     * Parse buffered input and execute commands found there. Stops reading from connection once
+     * its output goes over the limits
+     */
+    void Process(Connection *pconn);
+
+    /**
+     * Output is over connection or worker limit
+     */
+    bool OutputFull(const Connection *pconn) const;
+
+    /**
+     * Continue processing of connection paused because of output limits
+     */
+    void Resume(Connection *pconn);
+
     /**
      * Execute last command readed from the connection. Once method return all fields in connection allocated for the
      * command will be released, so implementation must take care to copy/move data somewhere else in case it needs
@@ -193,6 +242,21 @@ protected:
      */
     void Execute(Connection &pconn);
 
+    /**
+     * Connection has shown some activity, so its timeout starts over
+     */
+    void Touch(Connection *pconn);
+
+    /**
+     * Called by timer each wheel tick to close connections whose timeouts have expired
+     */
+    void OnTimeoutTick(uv_timer_t *);
+
+    /**
+     * Close connection once all its running commands are complete
+     */
+    void CloseConnection(Connection *pconn);
+
     /**
      * Called once command execution is complete
      */
@@ -245,6 +309,30 @@ private:
      */
     std::unordered_set<Connection *> alive;
 
+    /**
+     * Limits of the output waiting to be written, zero means unlimited
+     */
+    size_t connection_output_limit;
+    size_t worker_output_limit;
+
+    /**
+     * Total size of the output waiting to be written by all connections
+     */
+    size_t output_size;
+
+    /**
+     * Connection timeouts in milliseconds, zero means no timeout
+     */
+    uint32_t idle_timeout;
+    uint32_t read_timeout;
+
+    /**
+     * Deadlines of connection timeouts, advanced by a single timer ticking with wheel resolution
+     */
+    TimerWheel timers;
+    uv_timer_t uvTimeoutTimer;
+    std::vector<TimerWheel::Timer *> expired;
+
     /**
      * Storage instance to execute commands on
      */
@@ -1,25 +1,290 @@
 #include "Parser.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include <afina/execute/Add.h>
 #include <afina/execute/Append.h>
+#include <afina/execute/Cas.h>
 #include <afina/execute/Command.h>
 #include <afina/execute/Delete.h>
+#include <afina/execute/FlushAll.h>
 #include <afina/execute/Get.h>
+#include <afina/execute/Incr.h>
+#include <afina/execute/MetaArithmetic.h>
+#include <afina/execute/MetaDelete.h>
+#include <afina/execute/MetaGet.h>
+#include <afina/execute/MetaSet.h>
+#include <afina/execute/Prepend.h>
+#include <afina/execute/Replace.h>
 #include <afina/execute/Set.h>
+#include <afina/execute/Snapshot.h>
 #include <afina/execute/Stats.h>
+#include <afina/execute/Touch.h>
 
 namespace Afina {
 namespace Protocol {
 
+namespace {
+
+// Binary protocol constants, see https://github.com/memcached/memcached/wiki/BinaryProtocolRevamped
+const uint8_t RequestMagic = 0x80;
+const uint8_t ResponseMagic = 0x81;
+const size_t HeaderSize = 24;
+
+enum Opcode : uint8_t {
+    opGet = 0x00,
+    opSet = 0x01,
+    opAdd = 0x02,
+    opReplace = 0x03,
+    opDelete = 0x04,
+    opIncrement = 0x05,
+    opDecrement = 0x06,
+    opFlush = 0x08,
+    opGetQ = 0x09,
+    opNoop = 0x0a,
+    opGetK = 0x0c,
+    opGetKQ = 0x0d,
+    opAppend = 0x0e,
+    opPrepend = 0x0f,
+    opStat = 0x10,
+    opSetQ = 0x11,
+    opAddQ = 0x12,
+    opReplaceQ = 0x13,
+    opDeleteQ = 0x14,
+    opIncrementQ = 0x15,
+    opDecrementQ = 0x16,
+    opFlushQ = 0x18,
+    opAppendQ = 0x19,
+    opPrependQ = 0x1a,
+    opTouch = 0x1c,
+    opGat = 0x1d,
+    opGatQ = 0x1e,
+    opGatK = 0x23,
+    opGatKQ = 0x24
+};
+
+enum Status : uint16_t {
+    stOk = 0x0000,
+    stKeyNotFound = 0x0001,
+    stKeyExists = 0x0002,
+    stInvalidArguments = 0x0004,
+    stNotStored = 0x0005,
+    stNonNumeric = 0x0006,
+    stUnknownCommand = 0x0081,
+    stInternalError = 0x0084
+};
+
+inline uint32_t ReadBE32(const char *p) {
+    const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+    return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16) | (uint32_t(u[2]) << 8) | u[3];
+}
+
+inline uint64_t ReadBE64(const char *p) { return (uint64_t(ReadBE32(p)) << 32) | ReadBE32(p + 4); }
+
+inline void WriteBE(std::string &out, uint64_t value, size_t bytes) {
+    for (size_t i = bytes; i > 0; i--) {
+        out.push_back(char((value >> (8 * (i - 1))) & 0xff));
+    }
+}
+
+// Binary commands which don't touch storage reply with the fixed output
+class Reply : public Execute::Command {
+public:
+    Reply(const std::string &out) : _out(out) {}
+
+    void Execute(Storage &storage, const std::string &args, std::string &out) override { out = _out; }
+
+private:
+    std::string _out;
+};
+
+// Text command names, dispatched by length and the first char
+enum Name : uint8_t {
+    nUnknown,
+    nSet,
+    nAdd,
+    nCas,
+    nGet,
+    nGets,
+    nGat,
+    nGats,
+    nTouch,
+    nIncr,
+    nDecr,
+    nStats,
+    nAppend,
+    nPrepend,
+    nReplace,
+    nDelete,
+    nSnapshot,
+    nFlushAll,
+    nMetaGet,
+    nMetaSet,
+    nMetaDelete,
+    nMetaArithmetic,
+    nMetaNoop
+};
+
+Name Lookup(const std::string &name) {
+    switch (name.size()) {
+    case 2:
+        if (name[0] != 'm') {
+            break;
+        } else if (name[1] == 'g') {
+            return nMetaGet;
+        } else if (name[1] == 's') {
+            return nMetaSet;
+        } else if (name[1] == 'd') {
+            return nMetaDelete;
+        } else if (name[1] == 'a') {
+            return nMetaArithmetic;
+        } else if (name[1] == 'n') {
+            return nMetaNoop;
+        }
+        break;
+    case 3:
+        if (name[0] == 's' && name.compare(1, 2, "et") == 0) {
+            return nSet;
+        } else if (name[0] == 'a' && name.compare(1, 2, "dd") == 0) {
+            return nAdd;
+        } else if (name[0] == 'g' && name.compare(1, 2, "et") == 0) {
+            return nGet;
+        } else if (name[0] == 'c' && name.compare(1, 2, "as") == 0) {
+            return nCas;
+        } else if (name[0] == 'g' && name.compare(1, 2, "at") == 0) {
+            return nGat;
+        }
+        break;
+    case 4:
+        if (name[0] == 'g' && name.compare(1, 3, "ets") == 0) {
+            return nGets;
+        } else if (name[0] == 'i' && name.compare(1, 3, "ncr") == 0) {
+            return nIncr;
+        } else if (name[0] == 'd' && name.compare(1, 3, "ecr") == 0) {
+            return nDecr;
+        } else if (name[0] == 'g' && name.compare(1, 3, "ats") == 0) {
+            return nGats;
+        }
+        break;
+    case 5:
+        if (name[0] == 's' && name.compare(1, 4, "tats") == 0) {
+            return nStats;
+        } else if (name[0] == 't' && name.compare(1, 4, "ouch") == 0) {
+            return nTouch;
+        }
+        break;
+    case 6:
+        if (name[0] == 'a' && name.compare(1, 5, "ppend") == 0) {
+            return nAppend;
+        } else if (name[0] == 'd' && name.compare(1, 5, "elete") == 0) {
+            return nDelete;
+        }
+        break;
+    case 7:
+        if (name[0] == 'p' && name.compare(1, 6, "repend") == 0) {
+            return nPrepend;
+        } else if (name[0] == 'r' && name.compare(1, 6, "eplace") == 0) {
+            return nReplace;
+        }
+        break;
+    case 8:
+        return name == "snapshot" ? nSnapshot : nUnknown;
+    case 9:
+        return name == "flush_all" ? nFlushAll : nUnknown;
+    }
+    return nUnknown;
+}
+
+// Returns number of bytes before the first space or \r, checking 32 or 16 bytes at once if the
+// target supports it
+inline size_t TokenLength(const char *input, size_t size) {
+    size_t pos = 0;
+#if defined(__AVX2__)
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + pos));
+        __m256i found = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, cr));
+        uint32_t mask = _mm256_movemask_epi8(found);
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i space16 = _mm_set1_epi8(' ');
+    const __m128i cr16 = _mm_set1_epi8('\r');
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + pos));
+        __m128i found = _mm_or_si128(_mm_cmpeq_epi8(chunk, space16), _mm_cmpeq_epi8(chunk, cr16));
+        uint32_t mask = _mm_movemask_epi8(found);
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+#endif
+    while (pos < size && input[pos] != ' ' && input[pos] != '\r') {
+        pos++;
+    }
+    return pos;
+}
+
+} // namespace
+
+// Commands are created once per parser and refilled for every request
+struct Parser::Commands {
+    Execute::Set set;
+    Execute::Add add;
+    Execute::Cas cas;
+    Execute::Append append;
+    Execute::Prepend prepend;
+    Execute::Replace replace;
+    Execute::Get get;
+    Execute::Incr incr;
+    Execute::Incr decr{true};
+    Execute::Touch touch;
+    Execute::Delete del;
+    Execute::FlushAll flush_all;
+    Execute::Stats stats;
+    Execute::Snapshot snapshot;
+    Execute::MetaGet meta_get;
+    Execute::MetaSet meta_set;
+    Execute::MetaDelete meta_delete;
+    Execute::MetaArithmetic meta_arithmetic;
+    Reply meta_noop{"MN"};
+    Reply noop{""};
+    Reply unknown{"ERROR"};
+};
+
+// See Parse.h
+Parser::Parser() : commands(new Commands()), keys_count(0) { Reset(); }
+
+// See Parse.h
+Parser::~Parser() {}
+
 // See Parse.h
 bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
     size_t pos;
     parsed = 0;
 
+    if (state == State::sName && name.empty() && size > 0 && uint8_t(input[0]) == RequestMagic) {
+        binary = true;
+        state = State::sbHeader;
+    }
+    if (binary) {
+        parsed = ParseBinary(input, size);
+        return parse_complete;
+    }
+
     for (pos = 0; pos < size && !parse_complete; pos++) {
         char c = input[pos];
 
@@ -27,18 +292,72 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
         case State::sName: {
             if (c == ' ' || c == '\r') {
                 // std::cout << "parser debug: name='" << name << "'" << std::endl;
-                if (name == "set" || name == "add" || name == "append" || name == "prepend") {
+                command = Lookup(name);
+                switch (command) {
+                case nSet:
+                case nAdd:
+                case nCas:
+                case nAppend:
+                case nPrepend:
+                case nReplace:
                     state = State::spKey;
-                } else if (name == "get" || name == "gets") {
+                    OpenKey();
+                    break;
+                case nGet:
+                case nGets:
+                    state = State::sgKey;
+                    OpenKey();
+                    break;
+                case nGat:
+                case nGats:
+                    negative = false;
+                    state = State::spExprTimeStart;
+                    break;
+                case nIncr:
+                case nDecr:
+                    state = State::siKey;
+                    OpenKey();
+                    break;
+                case nTouch:
+                    state = State::stKey;
+                    OpenKey();
+                    break;
+                case nDelete:
+                    state = State::sdKey;
+                    OpenKey();
+                    break;
+                case nFlushAll:
+                    if (c == '\r') {
+                        state = State::sLF;
+                    } else {
+                        negative = false;
+                        state = State::spExprTimeStart;
+                    }
+                    break;
+                case nMetaGet:
+                case nMetaSet:
+                case nMetaDelete:
+                case nMetaArithmetic:
+                    if (c == '\r') {
+                        throw std::runtime_error("Meta command requires a key");
+                    }
+                    // Key and flags are collected as keys, commands tell them apart
                     state = State::sgKey;
-                } else if (name == "stats") {
+                    OpenKey();
+                    break;
+                case nStats:
+                case nSnapshot:
+                case nMetaNoop:
                     state = State::sLF;
                     continue;
-                } else {
+                default:
                     throw std::runtime_error("Unknown command name");
                 }
             } else {
-                name.push_back(c);
+                // Copy the whole name at once, loop goes on from the delimiter
+                size_t length = TokenLength(input + pos, size - pos);
+                name.append(input + pos, length);
+                pos += length - 1;
             }
             break;
         }
@@ -46,32 +365,109 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
         case State::spKey: {
             if (c == ' ') {
                 state = State::spFlags;
-                keys.push_back(curKey);
-                // std::cout << "parser debug: key[" << keys.size() - 1 << "]='" << curKey << "'" << std::endl;
+                keys_count++;
+                // std::cout << "parser debug: key[" << keys_count - 1 << "]='" << keys[0] << "'" << std::endl;
+            } else if (c == '\r') {
+                throw std::runtime_error("Key must be followed by flags");
             } else {
-                curKey.push_back(c);
+                size_t length = TokenLength(input + pos, size - pos);
+                keys[keys_count].append(input + pos, length);
+                pos += length - 1;
             }
             break;
         }
 
         case State::sgKey: {
             if (c == '\r') {
-                keys.push_back(curKey);
-                // std::cout << "parser debug: total '" << keys.size() << " keys" << std::endl;
+                keys_count++;
+                // std::cout << "parser debug: total '" << keys_count << " keys" << std::endl;
+                state = State::sLF;
+            } else if (c == ' ') {
+                // std::cout << "parser debug: key[" << keys_count << "]='" << keys[keys_count] << "'" << std::endl;
+                state = State::sgKey;
+                keys_count++;
+                OpenKey();
+            } else {
+                size_t length = TokenLength(input + pos, size - pos);
+                keys[keys_count].append(input + pos, length);
+                pos += length - 1;
+            }
+            break;
+        }
 
-                if (keys.size() == 0) {
-                    throw std::runtime_error("Client provides no key to retrive");
-                }
+        case State::siKey: {
+            if (c == ' ') {
+                state = State::siDelta;
+                keys_count++;
+            } else if (c == '\r') {
+                throw std::runtime_error("Key must be followed by delta");
+            } else {
+                size_t length = TokenLength(input + pos, size - pos);
+                keys[keys_count].append(input + pos, length);
+                pos += length - 1;
+            }
+            break;
+        }
 
-                curKey.clear();
+        case State::siDelta: {
+            if (c == '\r') {
                 state = State::sLF;
+            } else if (c >= '0' && c <= '9') {
+                if (delta > (UINT64_MAX - (c - '0')) / 10) {
+                    throw std::runtime_error("Delta field overflow");
+                }
+                delta = delta * 10 + (c - '0');
             } else if (c == ' ') {
-                // std::cout << "parser debug: key[" << keys.size() << "]='" << curKey << "'" << std::endl;
-                state = State::sgKey;
-                keys.push_back(curKey);
-                curKey.clear();
+                state = State::sTail;
             } else {
-                curKey.push_back(c);
+                throw std::runtime_error("Invalid numeric delta argument");
+            }
+            break;
+        }
+
+        case State::stKey: {
+            if (c == ' ') {
+                negative = false;
+                state = State::spExprTimeStart;
+                keys_count++;
+            } else if (c == '\r') {
+                throw std::runtime_error("Key must be followed by expiration time");
+            } else {
+                size_t length = TokenLength(input + pos, size - pos);
+                keys[keys_count].append(input + pos, length);
+                pos += length - 1;
+            }
+            break;
+        }
+
+        case State::sdKey: {
+            if (c == ' ' || c == '\r') {
+                state = (c == ' ') ? State::sTail : State::sLF;
+                keys_count++;
+            } else {
+                size_t length = TokenLength(input + pos, size - pos);
+                keys[keys_count].append(input + pos, length);
+                pos += length - 1;
+            }
+            break;
+        }
+
+        case State::sTail: {
+            if (c == ' ' || c == '\r') {
+                if (tail == "noreply") {
+                    noreply = true;
+                } else if (!tail.empty() && !(tail == "0" && command == nDelete)) {
+                    // Legacy time argument of delete, only 0 is allowed by memcached, it is ignored
+                    throw std::runtime_error("Unexpected argument " + tail);
+                }
+                tail.clear();
+                if (c == '\r') {
+                    state = State::sLF;
+                }
+            } else {
+                size_t length = TokenLength(input + pos, size - pos);
+                tail.append(input + pos, length);
+                pos += length - 1;
             }
             break;
         }
@@ -99,36 +495,48 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
             } else if (c >= '0' && c <= '9') {
                 exprtime = (c - '0');
                 state = State::spExprTime;
+            } else if (c != ' ' && command == nFlushAll) {
+                // Delay is optional, handle the char once again as the start of the next argument
+                state = State::sTail;
+                pos--;
             }
             break;
         }
 
         case State::spExprTime: {
             if (c == ' ') {
-                state = State::spBytes;
+                if (command == nGat || command == nGats) {
+                    // Keys follow expiration time
+                    state = State::sgKey;
+                    OpenKey();
+                } else if (command == nTouch || command == nFlushAll) {
+                    state = State::sTail;
+                } else {
+                    state = State::spBytes;
+                }
                 // std::cout << "parser debug: ExprTime='" << exprtime << "'" << std::endl;
+            } else if (c == '\r' && (command == nTouch || command == nFlushAll)) {
+                state = State::sLF;
             } else if (c >= '0' && c <= '9') {
-                int32_t et = exprtime;
-                if (negative) {
-                    et -= (c - '0');
-                    if (et > exprtime) {
-                        throw std::runtime_error("Expire time field overflow");
-                    }
-                } else {
-                    et += (c - '0');
-                    if (et < exprtime) {
-                        throw std::runtime_error("Expire time field overflow");
-                    }
+                int64_t et = int64_t(exprtime) * 10 + (negative ? -(c - '0') : (c - '0'));
+                if (et > INT32_MAX || et < INT32_MIN) {
+                    throw std::runtime_error("Expire time field overflow");
                 }
-                exprtime = et;
+                exprtime = int32_t(et);
             }
             break;
         }
 
         case State::spBytes: {
-            if (c == '\r') {
+            if (c == '\r' && command == nCas) {
+                throw std::runtime_error("Cas unique field expected");
+            } else if (c == '\r') {
                 state = State::sLF;
                 // std::cout << "parser debug: bytes='" << bytes << "'" << std::endl;
+            } else if (c == ' ' && command == nCas) {
+                state = State::spVersion;
+            } else if (c == ' ') {
+                state = State::sTail;
             } else if (c >= '0' && c <= '9') {
                 uint32_t b = (bytes * 10) + (c - '0');
                 if (b < bytes) {
@@ -140,6 +548,23 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
             break;
         }
 
+        case State::spVersion: {
+            if ((c == '\r' || c == ' ') && !version_given) {
+                throw std::runtime_error("Cas unique field expected");
+            } else if (c == '\r') {
+                state = State::sLF;
+            } else if (c == ' ') {
+                state = State::sTail;
+            } else if (c >= '0' && c <= '9') {
+                if (version > (UINT64_MAX - (c - '0')) / 10) {
+                    throw std::runtime_error("Cas unique field overflow");
+                }
+                version = version * 10 + (c - '0');
+                version_given = true;
+            }
+            break;
+        }
+
         case State::sLF: {
             if (c == '\n') {
                 parse_complete = true;
@@ -161,37 +586,449 @@ bool Parser::Parse(const char *input, const size_t size, size_t &parsed) {
 }
 
 // See Parse.h
-std::unique_ptr<Execute::Command> Parser::Build(uint32_t &body_size) const {
+size_t Parser::ParseBinary(const char *input, const size_t size) {
+    size_t pos = 0;
+    if (state == State::sbHeader) {
+        size_t for_copy = std::min(HeaderSize - packet.size(), size);
+        packet.append(input, for_copy);
+        pos += for_copy;
+        if (packet.size() < HeaderSize) {
+            return pos;
+        }
+
+        const char *header = packet.data();
+        opcode = uint8_t(header[1]);
+        uint32_t key_size = (uint32_t(uint8_t(header[2])) << 8) | uint8_t(header[3]);
+        uint32_t extras_size = uint8_t(header[4]);
+        uint32_t total_size = ReadBE32(header + 8);
+        std::memcpy(&opaque, header + 12, sizeof(opaque));
+        version = ReadBE64(header + 16);
+        if (total_size < key_size + extras_size) {
+            throw std::runtime_error("Invalid binary request body length");
+        }
+
+        bytes = total_size - key_size - extras_size;
+        packet_size = HeaderSize + extras_size + key_size;
+        state = State::sbKey;
+    }
+
+    size_t for_copy = std::min(packet_size - packet.size(), size - pos);
+    packet.append(input + pos, for_copy);
+    pos += for_copy;
+    if (packet.size() < packet_size) {
+        return pos;
+    }
+
+    uint32_t extras_size = uint8_t(packet[4]);
+    const char *extras = packet.data() + HeaderSize;
+    switch (opcode) {
+    case opSet:
+    case opSetQ:
+    case opAdd:
+    case opAddQ:
+    case opReplace:
+    case opReplaceQ:
+        if (extras_size < 8) {
+            throw std::runtime_error("Binary storage command requires flags and expiration");
+        }
+        flags = ReadBE32(extras);
+        exprtime = int32_t(ReadBE32(extras + 4));
+        break;
+    case opIncrement:
+    case opIncrementQ:
+    case opDecrement:
+    case opDecrementQ:
+        if (extras_size < 20) {
+            throw std::runtime_error("Binary counter command requires delta, initial value and expiration");
+        }
+        delta = ReadBE64(extras);
+        initial = ReadBE64(extras + 8);
+        exprtime = int32_t(ReadBE32(extras + 16));
+        break;
+    case opGat:
+    case opGatQ:
+    case opGatK:
+    case opGatKQ:
+    case opTouch:
+        if (extras_size < 4) {
+            throw std::runtime_error("Binary touch command requires expiration");
+        }
+        exprtime = int32_t(ReadBE32(extras));
+        break;
+    case opFlush:
+    case opFlushQ:
+        // Expiration is optional
+        if (extras_size >= 4) {
+            exprtime = int32_t(ReadBE32(extras));
+        }
+        break;
+    default:
+        break;
+    }
+
+    OpenKey().assign(packet, HeaderSize + extras_size, packet_size - HeaderSize - extras_size);
+    keys_count++;
+    parse_complete = true;
+    return pos;
+}
+
+// See Parse.h
+Execute::Command *Parser::Build(uint32_t &body_size) {
+    if (binary) {
+        if (!parse_complete) {
+            return nullptr;
+        }
+
+        body_size = bytes;
+        switch (opcode) {
+        case opGet:
+        case opGetQ:
+        case opGetK:
+        case opGetKQ:
+            // Response is built from the item itself, see Frame
+            commands->get.Reset(keys[0]);
+            return &commands->get;
+        case opGat:
+        case opGatQ:
+        case opGatK:
+        case opGatKQ:
+            commands->get.Reset(keys[0], true, exprtime);
+            return &commands->get;
+        case opTouch:
+            commands->touch.Reset(keys[0], exprtime);
+            return &commands->touch;
+        case opDelete:
+        case opDeleteQ:
+            commands->del.Reset(keys[0]);
+            return &commands->del;
+        case opFlush:
+        case opFlushQ:
+            commands->flush_all.Reset(exprtime);
+            return &commands->flush_all;
+        case opSet:
+        case opSetQ:
+            if (version != 0) {
+                commands->cas.Reset(keys[0], flags, exprtime, version);
+                store = &commands->cas;
+                return &commands->cas;
+            }
+            commands->set.Reset(keys[0], flags, exprtime);
+            store = &commands->set;
+            return &commands->set;
+        case opAdd:
+        case opAddQ:
+            commands->add.Reset(keys[0], flags, exprtime);
+            store = &commands->add;
+            return &commands->add;
+        case opReplace:
+        case opReplaceQ:
+            if (version != 0) {
+                commands->cas.Reset(keys[0], flags, exprtime, version);
+                store = &commands->cas;
+                return &commands->cas;
+            }
+            commands->replace.Reset(keys[0], flags, exprtime);
+            store = &commands->replace;
+            return &commands->replace;
+        case opAppend:
+        case opAppendQ:
+            commands->append.Reset(keys[0], flags, exprtime);
+            store = &commands->append;
+            return &commands->append;
+        case opPrepend:
+        case opPrependQ:
+            commands->prepend.Reset(keys[0], flags, exprtime);
+            store = &commands->prepend;
+            return &commands->prepend;
+        case opIncrement:
+        case opIncrementQ:
+            // Expiration of all ones means that missing counter must not be created
+            commands->incr.Reset(keys[0], delta, uint32_t(exprtime) != UINT32_MAX, initial, exprtime);
+            return &commands->incr;
+        case opDecrement:
+        case opDecrementQ:
+            commands->decr.Reset(keys[0], delta, uint32_t(exprtime) != UINT32_MAX, initial, exprtime);
+            return &commands->decr;
+        case opStat:
+            return &commands->stats;
+        case opNoop:
+            return &commands->noop;
+        default:
+            // Packet length is known, so unlike the text protocol connection could go on
+            return &commands->unknown;
+        }
+    }
+
     if (state != State::sLF) {
-        return std::unique_ptr<Execute::Command>(nullptr);
+        return nullptr;
     }
 
     body_size = bytes;
-    if (name == "set") {
-        return std::unique_ptr<Execute::Command>(new Execute::Set(keys[0], flags, exprtime));
-    } else if (name == "add") {
-        return std::unique_ptr<Execute::Command>(new Execute::Add(keys[0], flags, exprtime));
-    } else if (name == "append") {
-        return std::unique_ptr<Execute::Command>(new Execute::Append(keys[0], flags, exprtime));
-    } else if (name == "get") {
-        return std::unique_ptr<Execute::Command>(new Execute::Get(keys));
-    } else if (name == "stats") {
-        return std::unique_ptr<Execute::Command>(new Execute::Stats());
-    } else {
+    switch (command) {
+    case nSet:
+        commands->set.Reset(keys[0], flags, exprtime);
+        return &commands->set;
+    case nAdd:
+        commands->add.Reset(keys[0], flags, exprtime);
+        return &commands->add;
+    case nCas:
+        commands->cas.Reset(keys[0], flags, exprtime, version);
+        return &commands->cas;
+    case nAppend:
+        commands->append.Reset(keys[0], flags, exprtime);
+        return &commands->append;
+    case nPrepend:
+        commands->prepend.Reset(keys[0], flags, exprtime);
+        return &commands->prepend;
+    case nReplace:
+        commands->replace.Reset(keys[0], flags, exprtime);
+        return &commands->replace;
+    case nGet:
+        commands->get.Reset(keys, keys_count);
+        return &commands->get;
+    case nGets:
+        commands->get.Reset(keys, keys_count, true);
+        return &commands->get;
+    case nGat:
+        commands->get.Reset(keys, keys_count, false, true, exprtime);
+        return &commands->get;
+    case nGats:
+        commands->get.Reset(keys, keys_count, true, true, exprtime);
+        return &commands->get;
+    case nTouch:
+        commands->touch.Reset(keys[0], exprtime);
+        return &commands->touch;
+    case nDelete:
+        commands->del.Reset(keys[0]);
+        return &commands->del;
+    case nFlushAll:
+        commands->flush_all.Reset(exprtime);
+        return &commands->flush_all;
+    case nIncr:
+        commands->incr.Reset(keys[0], delta);
+        return &commands->incr;
+    case nDecr:
+        commands->decr.Reset(keys[0], delta);
+        return &commands->decr;
+    case nStats:
+        return &commands->stats;
+    case nSnapshot:
+        return &commands->snapshot;
+    case nMetaGet:
+        commands->meta_get.Reset(keys, keys_count);
+        return &commands->meta_get;
+    case nMetaSet:
+        commands->meta_set.Reset(keys, keys_count);
+        body_size = commands->meta_set.bytes();
+        return &commands->meta_set;
+    case nMetaDelete:
+        commands->meta_delete.Reset(keys, keys_count);
+        return &commands->meta_delete;
+    case nMetaArithmetic:
+        commands->meta_arithmetic.Reset(keys, keys_count);
+        return &commands->meta_arithmetic;
+    case nMetaNoop:
+        return &commands->meta_noop;
+    default:
         throw std::runtime_error("Unsupported command");
     }
 }
 
+// See Parse.h
+std::string Parser::Frame(std::string out) const {
+    if (!binary) {
+        if (noreply || out.empty()) {
+            return std::string();
+        }
+        out.append("\r\n");
+        return out;
+    }
+
+    uint16_t status = stOk;
+    uint64_t cas = 0;
+    std::string extras, key, value, response;
+    bool quiet = false;
+    if (out == Execute::Incr::NonNumeric) {
+        status = stNonNumeric;
+        value = out;
+    } else if (out.compare(0, 12, "CLIENT_ERROR") == 0) {
+        status = stInvalidArguments;
+        value = out;
+    } else if (out.compare(0, 12, "SERVER_ERROR") == 0) {
+        status = stInternalError;
+        value = out;
+    } else if (out == "ERROR") {
+        status = stUnknownCommand;
+        value = "Unknown command";
+    } else {
+        switch (opcode) {
+        case opGetK:
+        case opGetKQ:
+        case opGatK:
+        case opGatKQ:
+            key = keys[0];
+            // fallthrough
+        case opGet:
+        case opGetQ:
+        case opGat:
+        case opGatQ:
+            if (commands->get.found()) {
+                // Value goes right into the packet, extras are the flags which aren't stored
+                WriteBE(extras, 0, 4);
+                Packet(response, stOk, commands->get.version(), extras, key, commands->get.value());
+                return response;
+            } else {
+                // Quiet gets report hits only
+                quiet = (opcode == opGetQ || opcode == opGetKQ || opcode == opGatQ || opcode == opGatKQ);
+                status = stKeyNotFound;
+                value = "Not found";
+            }
+            break;
+
+        case opSet:
+        case opSetQ:
+        case opAdd:
+        case opAddQ:
+        case opReplace:
+        case opReplaceQ:
+        case opAppend:
+        case opAppendQ:
+        case opPrepend:
+        case opPrependQ:
+            switch (store->result()) {
+            case Execute::InsertCommand::rStored:
+                cas = store->stored();
+
+                // Quiet updates report errors only
+                quiet = (opcode == opSetQ || opcode == opAddQ || opcode == opReplaceQ || opcode == opAppendQ ||
+                         opcode == opPrependQ);
+                break;
+            case Execute::InsertCommand::rExists:
+                status = stKeyExists;
+                break;
+            case Execute::InsertCommand::rNotFound:
+                status = stKeyNotFound;
+                break;
+            default:
+                // Add fails because the key exists, replace because it doesn't
+                if (opcode == opAdd || opcode == opAddQ) {
+                    status = stKeyExists;
+                } else if (opcode == opReplace || opcode == opReplaceQ) {
+                    status = stKeyNotFound;
+                } else {
+                    status = stNotStored;
+                }
+                break;
+            }
+            if (status != stOk) {
+                value = out;
+            }
+            break;
+
+        case opIncrement:
+        case opIncrementQ:
+        case opDecrement:
+        case opDecrementQ: {
+            const Execute::Incr &counter = (opcode == opIncrement || opcode == opIncrementQ) ? commands->incr
+                                                                                              : commands->decr;
+            if (counter.found()) {
+                quiet = (opcode == opIncrementQ || opcode == opDecrementQ);
+                WriteBE(value, counter.value(), 8);
+            } else {
+                status = stKeyNotFound;
+                value = out;
+            }
+            break;
+        }
+
+        case opTouch:
+            if (out != "TOUCHED") {
+                status = stKeyNotFound;
+                value = out;
+            }
+            break;
+
+        case opDelete:
+        case opDeleteQ:
+            if (out == "DELETED") {
+                quiet = (opcode == opDeleteQ);
+            } else {
+                status = stKeyNotFound;
+                value = out;
+            }
+            break;
+
+        case opFlushQ:
+            quiet = true;
+            break;
+
+        case opStat:
+            // Every STAT <name> <value>\r\n line goes in its own packet, the empty one terminates them
+            for (size_t pos = 0; out.compare(pos, 5, "STAT ") == 0;) {
+                size_t eol = out.find("\r\n", pos);
+                size_t space = out.find(' ', pos + 5);
+                if (eol == std::string::npos || space == std::string::npos || space > eol) {
+                    break;
+                }
+                Packet(response, stOk, 0, extras, out.substr(pos + 5, space - pos - 5),
+                       out.substr(space + 1, eol - space - 1));
+                pos = eol + 2;
+            }
+            break;
+
+        default:
+            // Noop has no body
+            break;
+        }
+    }
+
+    if (quiet) {
+        return std::string();
+    }
+    Packet(response, status, cas, extras, key, value);
+    return response;
+}
+
+// See Parse.h
+void Parser::Packet(std::string &response, uint16_t status, uint64_t cas, const std::string &extras,
+                    const std::string &key, const std::string &value) const {
+    response.reserve(response.size() + HeaderSize + extras.size() + key.size() + value.size());
+    response.push_back(char(ResponseMagic));
+    response.push_back(char(opcode));
+    WriteBE(response, key.size(), 2);
+    response.push_back(char(extras.size()));
+    response.push_back(0); // data type
+    WriteBE(response, status, 2);
+    WriteBE(response, extras.size() + key.size() + value.size(), 4);
+    response.append(reinterpret_cast<const char *>(&opaque), sizeof(opaque));
+    WriteBE(response, cas, 8);
+    response.append(extras);
+    response.append(key);
+    response.append(value);
+}
+
 // See Parse.h
 void Parser::Reset() {
     state = State::sName;
     name.clear();
-    keys.clear();
-    curKey.clear();
+    command = nUnknown;
+    keys_count = 0;
     parse_complete = false;
     flags = 0;
     bytes = 0;
+    version = 0;
+    version_given = false;
+    delta = 0;
+    initial = 0;
     exprtime = 0;
+    noreply = false;
+    tail.clear();
+    binary = false;
+    opcode = 0;
+    opaque = 0;
+    packet.clear();
+    packet_size = 0;
+    store = nullptr;
 }
 
 } // namespace Protocol
@@ -11,16 +11,28 @@
 namespace Afina {
 namespace Execute {
 class Command;
+class InsertCommand;
 } // namespace Execute
 namespace Protocol {
 
 /**
  * # Memcached protocol parser
- * Parser supports subset of memcached protocol
+ * Parser supports subset of memcached protocol, both text and binary ones. Protocol is chosen for
+ * each command by its first byte: binary requests start with magic 0x80 that can't start text
+ * command, so the same connection could mix them.
+ *
+ * Binary request is a fixed 24 bytes header followed by extras, key and value. Header and key are
+ * read in bulk and the value becomes the command body, so there is no per byte work at all. Unlike
+ * the text protocol the body isn't followed by \r\n, see Binary()
  */
 class Parser {
 public:
-    Parser() { Reset(); }
+    Parser();
+    ~Parser();
+
+    Parser(const Parser &) = delete;
+    Parser &operator=(const Parser &) = delete;
+
     /**
      * Push given string into parser input. Method returns true if it was a command parsed out
      * from comulative input. In a such case method Build will return new command
@@ -43,33 +55,108 @@ public:
     bool Parse(const char *input, const size_t size, size_t &parsed);
 
     /**
-     * Builds new command from parsed input. In case if it wasn't enough input to prse command out
-     * method return nullptr
+     * Builds command from parsed input. In case if it wasn't enough input to prse command out
+     * method return nullptr.
+     *
+     * Command is owned by the parser and stays valid until the next call to Build: parser keeps one
+     * instance of each command and refills it for every request, so that once key buffers are big
+     * enough requests are handled without allocations
      */
-    std::unique_ptr<Execute::Command> Build(uint32_t &body_size) const;
+    Execute::Command *Build(uint32_t &body_size);
 
     /**
      * Reset parse so that it could be used to parse out new command
      */
     void Reset();
 
+    /**
+     * Frames output of the executed command, or error message starting with CLIENT_ERROR or
+     * SERVER_ERROR, as response in the protocol of the current command. Returns empty string if
+     * nothing must be sent back, that is the case for quiet binary commands succeeded, for text
+     * commands with noreply and for quiet meta commands, which leave output empty. Text response is
+     * framed in place, so big values passed with std::move aren't copied. Binary responses to get, store
+     * and counter commands are built from results kept by the command itself, not from its text output
+     */
+    std::string Frame(std::string out) const;
+
+    // Name of the current text command, binary commands are dispatched by opcode and leave it empty
     inline const std::string &Name() const { return name; }
 
+    /**
+     * Returns true if no byte of the next command has been consumed yet, so that parser could be
+     * replaced by the fresh one without losing anything
+     */
+    inline bool Idle() const { return state == State::sName && name.empty() && !binary; }
+
+    /**
+     * Returns true if the current command came in binary protocol, its body isn't followed by \r\n
+     */
+    inline bool Binary() const { return binary; }
+
 private:
     /**
      * State of the command parser. Prefixes are:
      * - s: state for PUT and GET commands
      * - sp: for PUT commands only
-     * - sg: for GET commands only
+     * - sg: for GET commands only, meta commands collect key and flags through it as well
+     * - si: for INCR/DECR commands only
+     * - st: for TOUCH command only, GAT/GATS go through spExprTime and sgKey
+     * - sd: for DELETE command only, FLUSH_ALL goes through spExprTime
+     * - sTail: optional arguments at the end of the command line, that is noreply
+     * - sb: for binary commands
      */
-    enum State : uint16_t { sCR, sLF, sName, spKey, spFlags, spExprTimeStart, spExprTime, spBytes, sgKey };
+    enum State : uint16_t {
+        sCR,
+        sLF,
+        sName,
+        spKey,
+        spFlags,
+        spExprTimeStart,
+        spExprTime,
+        spBytes,
+        spVersion,
+        sgKey,
+        siKey,
+        siDelta,
+        stKey,
+        sdKey,
+        sTail,
+        sbHeader,
+        sbKey
+    };
+
+    // Reads binary request header, extras and key, returns number of consumed bytes
+    size_t ParseBinary(const char *input, const size_t size);
+
+    // Appends binary response packet for the current request
+    void Packet(std::string &response, uint16_t status, uint64_t cas, const std::string &extras,
+                const std::string &key, const std::string &value) const;
+
+    // Starts the next key, reusing buffer of the key parsed by one of the previous commands
+    inline std::string &OpenKey() {
+        if (keys_count == keys.size()) {
+            keys.emplace_back();
+        }
+        keys[keys_count].clear();
+        return keys[keys_count];
+    }
+
+    // Instances of commands reused by Build
+    struct Commands;
+    std::unique_ptr<Commands> commands;
 
     // Current parser state
     State state;
 
     // vrious fields of the command
     std::string name;
+
+    // Text command looked up by name once it has been read, see Name in Parser.cpp
+    uint8_t command;
+
+    // Only the first keys_count keys belong to the current command, the rest are kept for reuse
     std::vector<std::string> keys;
+    size_t keys_count;
 
     // <flags> is an arbitrary 16-bit unsigned integer (written out in decimal) that the server stores along with
     // the data and sends back when the item is retrieved. Clients may use this as a bit field to store data-specific
@@ -88,9 +175,32 @@ private:
     // it's followed by an empty data block).
     uint32_t bytes;
 
+    // <cas unique> of the cas command, CAS field of the binary request header
+    uint64_t version;
+    bool version_given;
+
+    // Arguments of incr/decr, binary request could ask to create missing counter with the initial value
+    uint64_t delta;
+    uint64_t initial;
+
+    // Text command asked not to send the reply, quiet binary commands are told by the opcode
+    bool noreply;
+
+    // Current token of the optional arguments, see sTail
+    std::string tail;
+
     bool negative;
-    std::string curKey;
     bool parse_complete;
+
+    // Binary request: header, extras and key are collected here until packet_size bytes are read
+    bool binary;
+    uint8_t opcode;
+    uint32_t opaque;
+    std::string packet;
+    size_t packet_size;
+
+    // Store command built for the binary request, response carries its result and version of the stored value
+    const Execute::InsertCommand *store;
 };
 
 } // namespace Protocol
@@ -0,0 +1,308 @@
+#include "Journal.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <afina/Storage.h>
+#include <afina/logging/Logger.h>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+void throw_errno(const std::string &what) { throw std::runtime_error(what + ": " + std::strerror(errno)); }
+
+} // namespace
+
+// See Journal.h
+Journal::Journal(const std::string &path, uint32_t sync_interval, size_t sync_ops)
+    : path(path), rotated_path(path + ".old"), sync_interval(sync_interval), sync_ops(sync_ops), queued_ops(0),
+      running(false), flush_at(0), fd(-1) {}
+
+// See Journal.h
+Journal::~Journal() { Stop(); }
+
+// See Journal.h
+void Journal::Start() {
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        throw_errno("Failed to open " + path);
+    }
+
+    // Cut off record torn by crash, otherwise new records would be unreachable after it
+    size_t applied;
+    size_t valid = ReadFile(path, nullptr, applied);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) > valid && ftruncate(fd, valid) == -1) {
+        throw_errno("Failed to truncate " + path);
+    }
+
+    running = true;
+    thread = std::thread(&Journal::OnRun, this);
+}
+
+// See Journal.h
+void Journal::Stop() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!running) {
+            return;
+        }
+        running = false;
+        QueueFlush(false);
+    }
+    changed.notify_one();
+    thread.join();
+
+    // Changes queued while thread was finishing its last batch
+    try {
+        std::lock_guard<std::mutex> io_guard(io_lock);
+        Sync();
+    } catch (std::runtime_error &ex) {
+        LOG_ERROR(ex.what());
+    }
+    close(fd);
+    fd = -1;
+}
+
+// See Journal.h
+void Journal::Put(const std::string &key, const std::string &value, uint32_t expire) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (expire == 0) {
+        Append(opPut, key, value);
+    } else {
+        Append(opPutExpire, key, value, &expire);
+    }
+}
+
+// See Journal.h
+void Journal::Touch(const std::string &key, uint32_t expire) {
+    std::lock_guard<std::mutex> guard(lock);
+    Append(opTouch, key, std::string(), &expire);
+}
+
+// See Journal.h
+void Journal::Delete(const std::string &key) {
+    std::lock_guard<std::mutex> guard(lock);
+    Append(opDelete, key, std::string());
+}
+
+// See Journal.h
+void Journal::Flush(uint32_t at) {
+    std::lock_guard<std::mutex> guard(lock);
+    flush_at = at;
+    if (at == 0 || at <= uint32_t(std::time(nullptr))) {
+        flush_at = 0;
+        uint32_t immediately = 0;
+        Append(opFlush, std::string(), std::string(), &immediately);
+    }
+}
+
+// See Journal.h
+void Journal::Rotate() {
+    std::lock_guard<std::mutex> guard(io_lock);
+    Sync();
+
+    struct stat st;
+    if (stat(rotated_path.c_str(), &st) == 0) {
+        return;
+    }
+
+    int new_fd = open((path + ".new").c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (new_fd == -1) {
+        throw_errno("Failed to open " + path + ".new");
+    }
+    if (rename(path.c_str(), rotated_path.c_str()) == -1 || rename((path + ".new").c_str(), path.c_str()) == -1) {
+        close(new_fd);
+        throw_errno("Failed to rotate " + path);
+    }
+
+    close(fd);
+    fd = new_fd;
+}
+
+// See Journal.h
+void Journal::DropRotated() { unlink(rotated_path.c_str()); }
+
+// See Journal.h
+size_t Journal::Replay(Afina::Storage &storage, const std::string &path) {
+    size_t rotated = 0, current = 0;
+    ReadFile(path + ".old", &storage, rotated);
+    ReadFile(path, &storage, current);
+    return rotated + current;
+}
+
+// See Journal.h
+void Journal::Append(Operation op, const std::string &key, const std::string &value, const uint32_t *time) {
+    // Change made after the delayed flush took effect must be replayed after it
+    if (op != opFlush) {
+        QueueFlush(true);
+    }
+
+    size_t time_size = (time != nullptr) ? sizeof(*time) : 0;
+    uint32_t sizes[2] = {uint32_t(key.size()), uint32_t(time_size + value.size())};
+    queue.push_back(op);
+    queue.append(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+    queue.append(key);
+    queue.append(reinterpret_cast<const char *>(time), time_size);
+    queue.append(value);
+    if (++queued_ops == sync_ops) {
+        changed.notify_one();
+    }
+}
+
+// See Journal.h
+void Journal::QueueFlush(bool due) {
+    if (flush_at == 0 || (due && flush_at > uint32_t(std::time(nullptr)))) {
+        return;
+    }
+
+    uint32_t at = due ? 0 : flush_at;
+    flush_at = 0;
+    Append(opFlush, std::string(), std::string(), &at);
+}
+
+// See Journal.h
+void Journal::Sync() {
+    std::string batch;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        batch.swap(queue);
+        queued_ops = 0;
+    }
+    if (batch.empty()) {
+        return;
+    }
+
+    size_t written = 0;
+    while (written < batch.size()) {
+        ssize_t n = write(fd, batch.data() + written, batch.size() - written);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1) {
+            throw_errno("Failed to write " + path);
+        }
+        written += n;
+    }
+
+    if (fdatasync(fd) == -1) {
+        throw_errno("Failed to sync " + path);
+    }
+}
+
+// See Journal.h
+void Journal::OnRun() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (running) {
+        changed.wait_for(guard, std::chrono::milliseconds(sync_interval),
+                         [this]() { return !running || (sync_ops > 0 && queued_ops >= sync_ops); });
+        if (running) {
+            QueueFlush(true);
+        }
+
+        guard.unlock();
+        try {
+            std::lock_guard<std::mutex> io_guard(io_lock);
+            Sync();
+        } catch (std::runtime_error &ex) {
+            LOG_ERROR(ex.what());
+        }
+        guard.lock();
+    }
+}
+
+// See Journal.h
+size_t Journal::ReadFile(const std::string &path, Afina::Storage *storage, size_t &applied) {
+    applied = 0;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1 && errno == ENOENT) {
+        return 0;
+    } else if (fd == -1) {
+        throw_errno("Failed to open " + path);
+    }
+
+    std::string data;
+    char buf[64 * 1024];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) != 0) {
+        if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1) {
+            close(fd);
+            throw_errno("Failed to read " + path);
+        }
+        data.append(buf, n);
+    }
+    close(fd);
+
+    size_t pos = 0;
+    const size_t header_size = 1 + 2 * sizeof(uint32_t);
+    const uint32_t now = uint32_t(std::time(nullptr));
+    while (data.size() - pos >= header_size) {
+        uint8_t op = data[pos];
+        uint32_t sizes[2];
+        std::memcpy(sizes, &data[pos + 1], sizeof(sizes));
+        if (data.size() - pos - header_size < uint64_t(sizes[0]) + sizes[1]) {
+            // Record torn by crash
+            break;
+        }
+
+        bool valid;
+        switch (op) {
+        case opPut:
+        case opDelete:
+            valid = true;
+            break;
+        case opPutExpire:
+            valid = sizes[1] >= sizeof(uint32_t);
+            break;
+        case opFlush:
+        case opTouch:
+            valid = sizes[1] == sizeof(uint32_t);
+            break;
+        default:
+            valid = false;
+            break;
+        }
+        if (!valid) {
+            throw std::runtime_error("Journal " + path + " is corrupted");
+        }
+
+        if (storage != nullptr) {
+            const char *record = &data[pos + header_size];
+            std::string key(record, sizes[0]);
+            bool timed = (op == opFlush || op == opPutExpire || op == opTouch);
+            uint32_t time = 0;
+            if (timed) {
+                std::memcpy(&time, record + sizes[0], sizeof(time));
+            }
+
+            const char *value = record + sizes[0] + (timed ? sizeof(time) : 0);
+            size_t value_size = sizes[1] - (timed ? sizeof(time) : 0);
+            if (op == opFlush) {
+                storage->Flush(time);
+            } else if (op == opDelete || ((op == opPutExpire || op == opTouch) && time <= now)) {
+                storage->Delete(key);
+            } else if (op == opTouch) {
+                storage->Touch(key, time);
+            } else {
+                storage->Put(key, std::string(value, value_size), time);
+            }
+        }
+
+        pos += header_size + sizes[0] + sizes[1];
+        applied++;
+    }
+    return pos;
+}
+
+} // namespace Backend
+} // namespace Afina
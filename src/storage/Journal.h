@@ -0,0 +1,137 @@
+#ifndef AFINA_STORAGE_JOURNAL_H
+#define AFINA_STORAGE_JOURNAL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Afina {
+
+// Forward declaration, see afina/Storage.h
+class Storage;
+
+namespace Backend {
+
+/**
+ * # Append only log of storage changes
+ * Changes are collected in memory and written by the background thread which calls fsync once per
+ * batch: every sync interval or once that many changes are queued, whichever comes first. So the
+ * cost of durability is a single fsync per batch rather than per write.
+ *
+ * Each record is 8 bit operation, 32 bit key size, 32 bit value size, key and value bytes. Record
+ * torn by a crash at the end of file is ignored on replay. Flush record has no key and the 32 bit flush
+ * time as the value. Record of the key that expires has 32 bit expiration time in front of the value,
+ * so does touch record which has nothing else in the value. Change whose time has passed by replay
+ * removes the key, so that older value of it isn't brought back.
+ *
+ * Delayed flush is recorded once it takes effect rather than when it is requested, otherwise replay
+ * would apply it right away and keep changes made before its time. Flush still pending on Stop is
+ * recorded with its time, so that it is delayed on replay as well.
+ *
+ * Log is compacted against snapshots: before snapshot is taken log is rotated, and once snapshot is
+ * complete rotated part is not needed anymore and could be dropped
+ */
+class Journal {
+public:
+    /**
+     * @param path of the log file
+     * @param sync_interval maximum time in milliseconds change could stay unsynced
+     * @param sync_ops number of queued changes triggering sync right away, 0 for no limit
+     */
+    Journal(const std::string &path, uint32_t sync_interval, size_t sync_ops);
+    ~Journal();
+
+    /**
+     * Opens log for append and starts background thread
+     */
+    void Start();
+
+    /**
+     * Syncs all queued changes and stops background thread
+     */
+    void Stop();
+
+    /**
+     * Queue record of the key set to the value, expire is unix time as Storage::Put takes it
+     */
+    void Put(const std::string &key, const std::string &value, uint32_t expire = 0);
+
+    /**
+     * Queue record of the new expiration time of the key, see Storage::Touch
+     */
+    void Touch(const std::string &key, uint32_t expire);
+
+    /**
+     * Queue record of the key removal
+     */
+    void Delete(const std::string &key);
+
+    /**
+     * Queue record of the flush of the whole storage, see Storage::Flush. Delayed flush replaces
+     * the pending one and is queued once its time comes
+     */
+    void Flush(uint32_t at);
+
+    /**
+     * Syncs queued changes and moves log aside, so that new changes go to the new file. If the
+     * previous rotated log wasn't dropped, i.e snapshot failed, changes keep going to the current one
+     */
+    void Rotate();
+
+    /**
+     * Removes rotated log once its changes are in the snapshot
+     */
+    void DropRotated();
+
+    /**
+     * Applies changes from the rotated and then from the current log to the storage, returns
+     * number of applied records
+     */
+    static size_t Replay(Afina::Storage &storage, const std::string &path);
+
+private:
+    enum Operation : uint8_t { opPut = 1, opDelete = 2, opFlush = 3, opPutExpire = 4, opTouch = 5 };
+
+    // Time, if given, is written in front of the value. Must be called with lock held
+    void Append(Operation op, const std::string &key, const std::string &value, const uint32_t *time = nullptr);
+
+    // Queues pending flush if its time has come, must be called with lock held
+    void QueueFlush(bool due);
+
+    // Writes out and syncs queued changes, must be called with io_lock held
+    void Sync();
+
+    void OnRun();
+
+    // Reads records from the file applying them to the storage if it isn't null, returns length
+    // of the file part having complete records
+    static size_t ReadFile(const std::string &path, Afina::Storage *storage, size_t &applied);
+
+    const std::string path;
+    const std::string rotated_path;
+    const uint32_t sync_interval;
+    const size_t sync_ops;
+
+    // Guards queued changes
+    std::mutex lock;
+    std::condition_variable changed;
+    std::string queue;
+    size_t queued_ops;
+    bool running;
+
+    // Time of the delayed flush not recorded yet, 0 if there is none
+    uint32_t flush_at;
+
+    // Guards log file, taken before lock
+    std::mutex io_lock;
+    int fd;
+
+    std::thread thread;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_JOURNAL_H
@@ -1,10 +1,36 @@
 #include "MapBasedGlobalLockImpl.h"
 
+#include <pthread.h>
+#include <unordered_set>
+
 namespace Afina {
 namespace Backend {
 
+namespace {
+
+std::mutex instances_lock;
+std::unordered_set<MapBasedGlobalLockImpl *> instances;
+std::once_flag fork_handlers;
+
+} // namespace
+
 // See MapBasedGlobalLockImpl.h
-bool MapBasedGlobalLockImpl::Put(const std::string &key, const std::string &value)
+MapBasedGlobalLockImpl::MapBasedGlobalLockImpl(size_t max_size) : _max_size(max_size), _size(0), _version(0), _flushed_version(0), _flush_at(0) {
+    std::call_once(fork_handlers, []() { pthread_atfork(BeforeFork, AfterFork, AfterFork); });
+
+    std::lock_guard<std::mutex> lock(instances_lock);
+    instances.insert(this);
+}
+
+// See MapBasedGlobalLockImpl.h
+MapBasedGlobalLockImpl::~MapBasedGlobalLockImpl() {
+    std::lock_guard<std::mutex> lock(instances_lock);
+    instances.erase(this);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Put(const std::string &key, const std::string &value, uint32_t expire,
+                                 uint64_t *version)
 {
     std::lock_guard<std::mutex> lock(_lock);
 
@@ -14,30 +40,33 @@ bool MapBasedGlobalLockImpl::Put(const std::string &key, const std::string &valu
         return false;
     }
 
-    auto cache_elem = _backend.find(key);
-    if (cache_elem != _backend.end())
+    Node *node = Find(key);
+    if (node != nullptr)
     {
-        _cache.to_front(cache_elem->second);
-        _cache.front()->second = value;
-        return true;
+        _cache.to_front(node);
+        size_t old_size = ValueSize(node);
+        node->second = value;
+        node->prefix.clear();
+        node->counter = false;
+        node->expire = expire;
+        return Stored(Fit(node, old_size), version);
     }
 
     while (needed_size > _max_size - _size)
     {
-        auto old_key = _cache.back();
-        _size -= old_key->first.size();
-        _size -= old_key->second.size();
-        _cache.pop_back();
-        _backend.erase(old_key->first);
+        Remove(_cache.back());
     }
     _size += needed_size;
     _cache.push_front(key, value);
+    _cache.front()->version = ++_version;
+    _cache.front()->expire = expire;
     _backend[_cache.front()->first] = _cache.front();
-    return true;
+    return Stored(true, version);
 }
 
 // See MapBasedGlobalLockImpl.h
-bool MapBasedGlobalLockImpl::PutIfAbsent(const std::string &key, const std::string &value)
+bool MapBasedGlobalLockImpl::PutIfAbsent(const std::string &key, const std::string &value, uint32_t expire,
+                                         uint64_t *version)
 {
     std::lock_guard<std::mutex> lock(_lock);
 
@@ -47,27 +76,26 @@ bool MapBasedGlobalLockImpl::PutIfAbsent(const std::string &key, const std::stri
         return false;
     }
 
-    if (_backend.find(key) == _backend.end())
+    if (Find(key) == nullptr)
     {
         while (needed_size > _max_size - _size)
         {
-            auto old_key = _cache.back();
-            _size -= old_key->first.size();
-            _size -= old_key->second.size();
-            _cache.pop_back();
-            _backend.erase(old_key->first);
+            Remove(_cache.back());
         }
         _size += needed_size;
         _cache.push_front(key, value);
+        _cache.front()->version = ++_version;
+        _cache.front()->expire = expire;
         _backend[_cache.front()->first] = _cache.front();
-        return true;
+        return Stored(true, version);
     }
 
     return false;
 }
 
 // See MapBasedGlobalLockImpl.h
-bool MapBasedGlobalLockImpl::Set(const std::string &key, const std::string &value)
+bool MapBasedGlobalLockImpl::Set(const std::string &key, const std::string &value, uint32_t expire,
+                                 uint64_t *version)
 {
     std::lock_guard<std::mutex> lock(_lock);
 
@@ -77,53 +105,478 @@ bool MapBasedGlobalLockImpl::Set(const std::string &key, const std::string &valu
         return false;
     }
 
-    auto cache_elem = _backend.find(key);
-    if (cache_elem != _backend.end())
+    Node *node = Find(key);
+    if (node != nullptr)
     {
-        _cache.to_front(cache_elem->second);
-        needed_size -= _cache.front()->second.size();
-        while (needed_size > _max_size - _size)
-        {
-            auto old_key = _cache.back();
-            _size -= old_key->first.size();
-            _size -= old_key->second.size();
-            _cache.pop_back();
-            _backend.erase(old_key->first);
-        }
-        _cache.front()->second = value;
-        return true;
+        _cache.to_front(node);
+        size_t old_size = ValueSize(node);
+        node->second = value;
+        node->prefix.clear();
+        node->counter = false;
+        node->expire = expire;
+        return Stored(Fit(node, old_size), version);
     }
 
     return false;
 }
 
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::CompareAndSet(const std::string &key, const std::string &value, uint64_t &version,
+                                           uint32_t expire)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    Node *node = Find(key);
+    if (node == nullptr)
+    {
+        version = 0;
+        return false;
+    }
+
+    if (node->version != version)
+    {
+        version = node->version;
+        return false;
+    }
+
+    _cache.to_front(node);
+    size_t old_size = ValueSize(node);
+    node->second = value;
+    node->prefix.clear();
+    node->counter = false;
+    node->expire = expire;
+    if (!Fit(node, old_size))
+    {
+        version = 0;
+        return false;
+    }
+    version = node->version;
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Update(const std::string &key, const Updater &updater, uint64_t *version)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    Node *node = Find(key);
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    // Value is changed right in the node
+    _cache.to_front(node);
+    Flatten(node);
+    size_t old_size = node->second.size();
+    if (!updater(node->second))
+    {
+        return false;
+    }
+    return Stored(Fit(node, old_size), version);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Append(const std::string &key, const std::string &data, uint64_t *version)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    Node *node = Find(key);
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    _cache.to_front(node);
+    size_t old_size = ValueSize(node);
+    if (node->counter)
+    {
+        Flatten(node);
+    }
+    node->second.append(data);
+    return Stored(Fit(node, old_size), version);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Prepend(const std::string &key, const std::string &data, uint64_t *version)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    Node *node = Find(key);
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    _cache.to_front(node);
+    size_t old_size = ValueSize(node);
+    if (node->counter)
+    {
+        Flatten(node);
+    }
+    node->prefix.append(data.rbegin(), data.rend());
+    return Stored(Fit(node, old_size), version);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Increment(const std::string &key, uint64_t delta, uint64_t &value)
+{
+    return Count(key, delta, false, value);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Decrement(const std::string &key, uint64_t delta, uint64_t &value)
+{
+    return Count(key, delta, true, value);
+}
+
 // See MapBasedGlobalLockImpl.h
 bool MapBasedGlobalLockImpl::Delete(const std::string &key)
 {
     std::lock_guard<std::mutex> lock(_lock);
 
-    auto cache_elem = _backend.find(key);
-    _cache.erase(cache_elem->second);
-    _backend.erase(key);
+    Node *node = Find(key);
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    Remove(node);
     return true;
 }
 
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::Flush(uint32_t at)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    if (at == 0 || at <= Now())
+    {
+        _flushed_version = _version;
+        _flush_at = 0;
+    } else {
+        _flush_at = at;
+    }
+}
+
 // See MapBasedGlobalLockImpl.h
 bool MapBasedGlobalLockImpl::Get(const std::string &key, std::string &value) const
 {
     std::lock_guard<std::mutex> lock(_lock);
     
-    auto cache_it = _backend.find(key);
-    if (cache_it != _backend.end())
+    Node *node = Find(key);
+    if (node != nullptr)
+    {
+        _cache.to_front(node);
+        Flatten(node);
+        node->fetched = true;
+        value = node->second;
+        return true;
+    }
+
+    return false;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Get(const std::string &key, std::string &value, uint64_t &version) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    Node *node = Find(key);
+    if (node != nullptr)
     {
-        _cache.to_front(cache_it->second);
-        value = _cache.front()->second;
+        _cache.to_front(node);
+        Flatten(node);
+        node->fetched = true;
+        value = node->second;
+        version = node->version;
         return true;
     }
 
     return false;
 }
 
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::MultiGet(const std::string *keys, size_t count, const Receiver &receiver) const
+{
+    MultiGet(keys, nullptr, count, receiver);
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::MultiGet(const std::string *keys, const size_t *positions, size_t count,
+                                      const Receiver &receiver) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t position = (positions == nullptr) ? i : positions[i];
+        Node *node = Find(keys[position]);
+        if (node == nullptr)
+        {
+            continue;
+        }
+
+        _cache.to_front(node);
+        Flatten(node);
+        node->fetched = true;
+        receiver(position, node->second.data(), node->second.size(), node->version);
+    }
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Touch(const std::string &key, uint32_t expire)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    Node *node = Find(key);
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    _cache.to_front(node);
+    node->expire = expire;
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::GetAndTouch(const std::string &key, uint32_t expire, std::string &value,
+                                         uint64_t &version)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    Node *node = Find(key);
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    _cache.to_front(node);
+    node->expire = expire;
+    Flatten(node);
+    node->fetched = true;
+    value = node->second;
+    version = node->version;
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Inspect(const std::string &key, Info &info, std::string *value) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    Node *node = Find(key);
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    _cache.to_front(node);
+    info.version = node->version;
+    info.expire = node->expire;
+    info.size = ValueSize(node);
+    info.fetched = node->fetched;
+    if (value != nullptr)
+    {
+        Flatten(node);
+        node->fetched = true;
+        *value = node->second;
+    }
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::ForEach(const Visitor &visitor) const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    ApplyFlush();
+    uint32_t now = Now();
+    for (Node *node = _cache.back(); node != NULL; node = node->prev)
+    {
+        if (node->version <= _flushed_version || (node->expire != 0 && node->expire <= now))
+        {
+            continue;
+        }
+        Flatten(node);
+        visitor(node->first, node->second, node->expire);
+    }
+}
+
+// See MapBasedGlobalLockImpl.h
+Node *MapBasedGlobalLockImpl::Find(const std::string &key) const
+{
+    // Applied before the lookup, even for keys which aren't there, otherwise key inserted after the
+    // flush time would get its version before the flush takes it into account
+    ApplyFlush();
+
+    auto cache_elem = _backend.find(key);
+    if (cache_elem == _backend.end())
+    {
+        return nullptr;
+    }
+
+    Node *node = cache_elem->second;
+    if (Stale(node))
+    {
+        Remove(node);
+        return nullptr;
+    }
+    return node;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Stale(const Node *node) const
+{
+    return node->version <= _flushed_version || Expired(node->expire);
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::ApplyFlush() const
+{
+    if (_flush_at != 0 && _flush_at <= Now())
+    {
+        // Every change looks its key up first and so applies the flush once it is due, thus all
+        // versions given so far belong to changes made before the flush time
+        _flushed_version = _version;
+        _flush_at = 0;
+    }
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::Remove(Node *node) const
+{
+    _size -= node->first.size() + ValueSize(node);
+    _backend.erase(node->first);
+    _cache.erase(node);
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Fit(Node *node, size_t old_size)
+{
+    size_t new_size = ValueSize(node);
+    if (node->first.size() + new_size > _max_size)
+    {
+        _size -= node->first.size() + old_size;
+        _backend.erase(node->first);
+        _cache.erase(node);
+        return false;
+    }
+
+    _size -= old_size;
+    while (new_size > _max_size - _size)
+    {
+        // Node itself is at the front and fits, so it is never evicted here
+        Remove(_cache.back());
+    }
+    _size += new_size;
+    node->version = ++_version;
+    node->fetched = false;
+    return true;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Stored(bool stored, uint64_t *version) const
+{
+    if (stored && version != nullptr)
+    {
+        *version = _version;
+    }
+    return stored;
+}
+
+// See MapBasedGlobalLockImpl.h
+bool MapBasedGlobalLockImpl::Count(const std::string &key, uint64_t delta, bool decrement, uint64_t &value)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    Node *node = Find(key);
+    if (node == nullptr)
+    {
+        return false;
+    }
+
+    size_t old_size = ValueSize(node);
+    if (!node->counter)
+    {
+        Flatten(node);
+        node->number = ParseCounter(node->second);
+        node->counter = true;
+    }
+
+    if (decrement)
+    {
+        node->number = node->number > delta ? node->number - delta : 0;
+    } else {
+        node->number += delta;
+    }
+    value = node->number;
+
+    _cache.to_front(node);
+    return Fit(node, old_size);
+}
+
+// See MapBasedGlobalLockImpl.h
+size_t MapBasedGlobalLockImpl::ValueSize(const Node *node) const
+{
+    if (!node->counter)
+    {
+        return node->second.size() + node->prefix.size();
+    }
+
+    size_t digits = 1;
+    for (uint64_t number = node->number; number >= 10; number /= 10)
+    {
+        digits++;
+    }
+    return digits;
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::Flatten(Node *node) const
+{
+    if (node->counter)
+    {
+        // Digits are written right into the string, so it doesn't allocate once it has capacity
+        char digits[20];
+        size_t length = 0;
+        uint64_t number = node->number;
+        do
+        {
+            digits[sizeof(digits) - ++length] = '0' + number % 10;
+            number /= 10;
+        } while (number != 0);
+        node->second.assign(digits + sizeof(digits) - length, length);
+        node->counter = false;
+    }
+    if (!node->prefix.empty())
+    {
+        node->second.insert(node->second.begin(), node->prefix.rbegin(), node->prefix.rend());
+        node->prefix.clear();
+    }
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::BeforeFork()
+{
+    instances_lock.lock();
+    for (auto storage : instances)
+    {
+        storage->_lock.lock();
+    }
+}
+
+// See MapBasedGlobalLockImpl.h
+void MapBasedGlobalLockImpl::AfterFork()
+{
+    for (auto storage : instances)
+    {
+        storage->_lock.unlock();
+    }
+    instances_lock.unlock();
+}
+
 List::List()
 {
     _front = NULL;
@@ -170,18 +623,18 @@ void List::pop_back()
 
 void List::erase(Node* node)
 {
-    if (node->next == NULL)
-    {
-        pop_back();
-    }
     if (node->prev == NULL)
     {
         _front = node->next;
-        _front->prev = NULL;
     } else {
         node->prev->next = node->next;
     }
-    node->next->prev = node->prev;
+    if (node->next == NULL)
+    {
+        _back = node->prev;
+    } else {
+        node->next->prev = node->prev;
+    }
     delete node;
 }
 
@@ -213,8 +666,8 @@ void List::to_front(Node* new_front)
     if (new_front->next != NULL)
     {
         new_front->next->prev = new_front->prev;
-    } else if ((_back != NULL) && (_back->prev != NULL)) {
-        _back->prev->next = NULL;
+    } else {
+        _back = new_front->prev;
     }
     new_front->prev = NULL;
     new_front->next = _front;
@@ -22,6 +22,24 @@ namespace Backend {
     Node* next;
     std::string first;
     std::string second;
+
+    // Data prepended since the value was read last time, in reverse order, so that prepend
+    // appends to it. Value is reversed prefix followed by second, see Flatten
+    std::string prefix;
+
+    // Changed by every modification of the value, see Storage::Get
+    uint64_t version;
+
+    // Value is the counter changed by Increment/Decrement, it is kept in binary form and second
+    // is stale until the value is read, see Flatten
+    bool counter = false;
+    uint64_t number;
+
+    // Unix time the node expires at, 0 if never
+    uint32_t expire = 0;
+
+    // Value was read since it was changed last time, see Storage::Info
+    bool fetched = false;
  };
 
  class List {
@@ -42,33 +60,136 @@ namespace Backend {
 
 class MapBasedGlobalLockImpl : public Afina::Storage {
 public:
-    MapBasedGlobalLockImpl(size_t max_size = 1024) : _max_size(max_size), _size(0) {}
-    ~MapBasedGlobalLockImpl() {}
+    MapBasedGlobalLockImpl(size_t max_size = 1024);
+    ~MapBasedGlobalLockImpl();
 
     // Implements Afina::Storage interface
-    bool Put(const std::string &key, const std::string &value) override;
+    bool Put(const std::string &key, const std::string &value, uint32_t expire = 0,
+             uint64_t *version = nullptr) override;
 
     // Implements Afina::Storage interface
-    bool PutIfAbsent(const std::string &key, const std::string &value) override;
+    bool PutIfAbsent(const std::string &key, const std::string &value, uint32_t expire = 0,
+                     uint64_t *version = nullptr) override;
 
     // Implements Afina::Storage interface
-    bool Set(const std::string &key, const std::string &value) override;
+    bool Set(const std::string &key, const std::string &value, uint32_t expire = 0,
+             uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool CompareAndSet(const std::string &key, const std::string &value, uint64_t &version,
+                       uint32_t expire = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Update(const std::string &key, const Updater &updater, uint64_t *version = nullptr) override;
+
+    /**
+     * Value string grows with slack, so append takes time proportional to the appended data
+     */
+    bool Append(const std::string &key, const std::string &data, uint64_t *version = nullptr) override;
+
+    /**
+     * Data is collected in front of the value and merged into it once value is read
+     */
+    bool Prepend(const std::string &key, const std::string &data, uint64_t *version = nullptr) override;
+
+    /**
+     * Counter is parsed once and then kept as a number until it is read as a string
+     */
+    bool Increment(const std::string &key, uint64_t delta, uint64_t &value) override;
+
+    /**
+     * See Increment
+     */
+    bool Decrement(const std::string &key, uint64_t delta, uint64_t &value) override;
 
     // Implements Afina::Storage interface
     bool Delete(const std::string &key) override;
 
+    // Implements Afina::Storage interface
+    void Flush(uint32_t at = 0) override;
+
     // Implements Afina::Storage interface
     bool Get(const std::string &key, std::string &value) const override;
 
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value, uint64_t &version) const override;
+
+    /**
+     * All keys are looked up under the lock taken once
+     */
+    void MultiGet(const std::string *keys, size_t count, const Receiver &receiver) const override;
+
+    /**
+     * Same as MultiGet, but only keys at the given positions are looked up, so that the caller
+     * could pass keys of one shard without copying them, see MapBasedStripedLockImpl
+     */
+    void MultiGet(const std::string *keys, const size_t *positions, size_t count, const Receiver &receiver) const;
+
+    // Implements Afina::Storage interface
+    bool Touch(const std::string &key, uint32_t expire) override;
+
+    // Implements Afina::Storage interface
+    bool GetAndTouch(const std::string &key, uint32_t expire, std::string &value, uint64_t &version) override;
+
+    // Implements Afina::Storage interface
+    bool Inspect(const std::string &key, Info &info, std::string *value = nullptr) const override;
+
+    // Implements Afina::Storage interface
+    void ForEach(const Visitor &visitor) const override;
+
 private:
+    // All live instances are locked for the time of fork(), so that child process gets consistent
+    // copy of each storage and could walk it without disturbing the parent
+    static void BeforeFork();
+    static void AfterFork();
+
+    // Looks node up, expired or flushed node is removed on the way and isn't returned. Nodes aren't expired
+    // in background, so expired node is kept until it is looked up or evicted
+    Node *Find(const std::string &key) const;
+
+    // Checks if node is expired or flushed, delayed flush must be applied already, see Find
+    bool Stale(const Node *node) const;
+
+    // Applies delayed flush once its time has come
+    void ApplyFlush() const;
+
+    // Removes node from both the map and the list. Keys of the map refer to the node, so it is
+    // unlinked from the map before it is freed, eviction goes through it for that reason too
+    void Remove(Node *node) const;
+
+    // Accounts new size of the changed value evicting least recently used nodes if needs and gives
+    // it new version. If value doesn't fit into the storage anymore node is removed and false
+    // returned
+    bool Fit(Node *node, size_t old_size);
+
+    // Reports version of the node just stored, that is the last given one, if it is asked for
+    bool Stored(bool stored, uint64_t *version) const;
+
+    // Brings value to the plain string: formats counter and merges prepended data
+    void Flatten(Node *node) const;
+
+    // Adds signed delta to the counter, see Increment
+    bool Count(const std::string &key, uint64_t delta, bool decrement, uint64_t &value);
+
+    size_t ValueSize(const Node *node) const;
+
     size_t _max_size;
-    size_t _size;
+    mutable size_t _size;
+
+    // The last given version
+    uint64_t _version;
+
+    // Nodes with version up to this one are flushed, see Flush
+    mutable uint64_t _flushed_version;
+
+    // Time of the delayed flush, 0 if there is none
+    mutable uint32_t _flush_at;
     mutable std::mutex _lock;
 
-    std::unordered_map< std::reference_wrapper<const std::string>,
-                        Node*,
-                        std::hash<std::string>,
-                        std::equal_to<std::string>> _backend;
+    mutable std::unordered_map< std::reference_wrapper<const std::string>,
+                                Node*,
+                                std::hash<std::string>,
+                                std::equal_to<std::string>> _backend;
     mutable List _cache;
 };
 
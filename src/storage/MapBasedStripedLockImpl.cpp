@@ -0,0 +1,151 @@
+#include "MapBasedStripedLockImpl.h"
+
+#include <functional>
+#include <vector>
+
+namespace Afina {
+namespace Backend {
+
+const size_t MapBasedStripedLockImpl::DefaultSize;
+const size_t MapBasedStripedLockImpl::DefaultShards;
+
+// See MapBasedStripedLockImpl.h
+MapBasedStripedLockImpl::MapBasedStripedLockImpl(size_t max_size, size_t n_shards) {
+    for (size_t i = 0; i < n_shards; i++) {
+        shards.emplace_back(new MapBasedGlobalLockImpl(max_size / n_shards));
+    }
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::Put(const std::string &key, const std::string &value, uint32_t expire,
+                                  uint64_t *version) {
+    return Shard(key).Put(key, value, expire, version);
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::PutIfAbsent(const std::string &key, const std::string &value, uint32_t expire,
+                                          uint64_t *version) {
+    return Shard(key).PutIfAbsent(key, value, expire, version);
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::Set(const std::string &key, const std::string &value, uint32_t expire,
+                                  uint64_t *version) {
+    return Shard(key).Set(key, value, expire, version);
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::CompareAndSet(const std::string &key, const std::string &value, uint64_t &version,
+                                            uint32_t expire) {
+    return Shard(key).CompareAndSet(key, value, version, expire);
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::Update(const std::string &key, const Updater &updater, uint64_t *version) {
+    return Shard(key).Update(key, updater, version);
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::Append(const std::string &key, const std::string &data, uint64_t *version) {
+    return Shard(key).Append(key, data, version);
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::Prepend(const std::string &key, const std::string &data, uint64_t *version) {
+    return Shard(key).Prepend(key, data, version);
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::Increment(const std::string &key, uint64_t delta, uint64_t &value) {
+    return Shard(key).Increment(key, delta, value);
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::Decrement(const std::string &key, uint64_t delta, uint64_t &value) {
+    return Shard(key).Decrement(key, delta, value);
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::Delete(const std::string &key) { return Shard(key).Delete(key); }
+
+// See MapBasedStripedLockImpl.h
+void MapBasedStripedLockImpl::Flush(uint32_t at) {
+    for (auto &shard : shards) {
+        shard->Flush(at);
+    }
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::Get(const std::string &key, std::string &value) const {
+    return Shard(key).Get(key, value);
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::Get(const std::string &key, std::string &value, uint64_t &version) const {
+    return Shard(key).Get(key, value, version);
+}
+
+// See MapBasedStripedLockImpl.h
+void MapBasedStripedLockImpl::MultiGet(const std::string *keys, size_t count, const Receiver &receiver) const {
+    // Single key goes right to its shard, no need to sort anything
+    if (count == 1) {
+        Shard(keys[0]).MultiGet(keys, count, receiver);
+        return;
+    }
+
+    // Counting sort of key positions by shard, keys of the shard keep their order. Buffers are kept by
+    // the thread, so once they are big enough multi-key gets don't allocate
+    thread_local std::vector<size_t> index, starts, positions;
+    index.resize(count);
+    positions.resize(count);
+    starts.assign(shards.size() + 1, 0);
+    for (size_t i = 0; i < count; i++) {
+        index[i] = Index(keys[i]);
+        starts[index[i] + 1]++;
+    }
+    for (size_t s = 1; s <= shards.size(); s++) {
+        starts[s] += starts[s - 1];
+    }
+
+    // Placing keys moves start of each shard to its end, that is to the start of the next one
+    for (size_t i = 0; i < count; i++) {
+        positions[starts[index[i]]++] = i;
+    }
+
+    size_t begin = 0;
+    for (size_t s = 0; s < shards.size(); s++) {
+        if (starts[s] > begin) {
+            shards[s]->MultiGet(keys, positions.data() + begin, starts[s] - begin, receiver);
+        }
+        begin = starts[s];
+    }
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::Touch(const std::string &key, uint32_t expire) { return Shard(key).Touch(key, expire); }
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::GetAndTouch(const std::string &key, uint32_t expire, std::string &value,
+                                          uint64_t &version) {
+    return Shard(key).GetAndTouch(key, expire, value, version);
+}
+
+// See MapBasedStripedLockImpl.h
+bool MapBasedStripedLockImpl::Inspect(const std::string &key, Info &info, std::string *value) const {
+    return Shard(key).Inspect(key, info, value);
+}
+
+// See MapBasedStripedLockImpl.h
+void MapBasedStripedLockImpl::ForEach(const Visitor &visitor) const {
+    for (auto &shard : shards) {
+        shard->ForEach(visitor);
+    }
+}
+
+// See MapBasedStripedLockImpl.h
+size_t MapBasedStripedLockImpl::Index(const std::string &key) const {
+    return std::hash<std::string>()(key) % shards.size();
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,103 @@
+#ifndef AFINA_STORAGE_MAP_BASED_STRIPED_LOCK_IMPL_H
+#define AFINA_STORAGE_MAP_BASED_STRIPED_LOCK_IMPL_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+
+#include "MapBasedGlobalLockImpl.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Map based implementation split into shards
+ * Keys are spread over independent shards by hash, each shard has its own lock and LRU list and
+ * gets equal part of the memory limit. So threads working with different keys rarely contend,
+ * that is what parallel snapshot loading relies on
+ */
+class MapBasedStripedLockImpl : public Afina::Storage {
+public:
+    MapBasedStripedLockImpl(size_t max_size = DefaultSize, size_t shards = DefaultShards);
+    ~MapBasedStripedLockImpl() {}
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value, uint32_t expire = 0,
+             uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, uint32_t expire = 0,
+                     uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, uint32_t expire = 0,
+             uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool CompareAndSet(const std::string &key, const std::string &value, uint64_t &version,
+                       uint32_t expire = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Update(const std::string &key, const Updater &updater, uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool Append(const std::string &key, const std::string &data, uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool Prepend(const std::string &key, const std::string &data, uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool Increment(const std::string &key, uint64_t delta, uint64_t &value) override;
+
+    // Implements Afina::Storage interface
+    bool Decrement(const std::string &key, uint64_t delta, uint64_t &value) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    // Implements Afina::Storage interface
+    void Flush(uint32_t at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) const override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value, uint64_t &version) const override;
+
+    /**
+     * Keys are grouped by shard, so each shard lock is taken once
+     */
+    void MultiGet(const std::string *keys, size_t count, const Receiver &receiver) const override;
+
+    // Implements Afina::Storage interface
+    bool Touch(const std::string &key, uint32_t expire) override;
+
+    // Implements Afina::Storage interface
+    bool GetAndTouch(const std::string &key, uint32_t expire, std::string &value, uint64_t &version) override;
+
+    // Implements Afina::Storage interface
+    bool Inspect(const std::string &key, Info &info, std::string *value = nullptr) const override;
+
+    /**
+     * Walks shards one after another, order is kept within a shard only
+     */
+    void ForEach(const Visitor &visitor) const override;
+
+    static const size_t DefaultSize = 64 * 1024 * 1024;
+    static const size_t DefaultShards = 16;
+
+private:
+    MapBasedGlobalLockImpl &Shard(const std::string &key) const { return *shards[Index(key)]; }
+
+    // Number of the shard the key belongs to
+    size_t Index(const std::string &key) const;
+
+    std::vector<std::unique_ptr<MapBasedGlobalLockImpl>> shards;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_MAP_BASED_STRIPED_LOCK_IMPL_H
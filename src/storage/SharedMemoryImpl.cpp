@@ -0,0 +1,840 @@
+#include "SharedMemoryImpl.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+// Identifies segment created by this implementation, version must be changed on any layout change
+const uint64_t Magic = 0x61666e6173686d31ULL;
+const uint32_t Version = 6;
+
+// All blocks and tables are aligned on cache line
+const size_t Alignment = 64;
+
+// Expected average item size, used to pick number of hash buckets
+const size_t ItemSizeHint = 512;
+
+// Segment must have room at least for the header, index and a few items
+const size_t MinSegmentSize = 64 * 1024;
+
+// MultiGet prefetches bucket of the key that far ahead of the one being looked up
+const size_t PrefetchDistance = 4;
+
+inline size_t align(size_t v) { return (v + Alignment - 1) & ~(Alignment - 1); }
+
+// Hash must not change between builds, otherwise restarted process won't find anything
+uint64_t hash_key(const std::string &key) {
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+void throw_errno(const std::string &what) { throw std::runtime_error(what + ": " + std::strerror(errno)); }
+
+} // namespace
+
+/**
+ * Lays at the very beginning of the segment
+ */
+struct SharedMemoryImpl::Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t size;
+
+    // Robust process shared mutex guarding everything below
+    pthread_mutex_t lock;
+
+    // Hash index, each bucket is the head of items chain
+    offset_t buckets;
+    uint64_t buckets_mask;
+
+    // Memory for blocks, block of size 1 << class starts at offset from heap_start aligned on its
+    // size, so its buddy is found by offset. max_class is the class of the biggest block there is
+    offset_t heap_start;
+    offset_t heap_end;
+    uint32_t max_class;
+
+    // LRU list, head is the most recently used item
+    offset_t lru_head;
+    offset_t lru_tail;
+    uint64_t items;
+
+    // The last version given to an item, it isn't reset when segment is wiped out
+    uint64_t last_version;
+
+    // Items with version up to this one are flushed, flush_at is time of the delayed flush or 0
+    uint64_t flushed_version;
+    uint32_t flush_at;
+
+    // Free blocks of size 1 << class, double linked through lru_prev and lru_next
+    offset_t free_lists[NumClasses];
+};
+
+/**
+ * Header of the block holding single key/value pair, both follow it immediately
+ */
+struct SharedMemoryImpl::Item {
+    // Also link free blocks together
+    offset_t lru_prev;
+    offset_t lru_next;
+    offset_t hash_next;
+    uint64_t hash;
+    uint64_t version;
+    uint32_t key_size;
+    uint32_t value_size;
+
+    // Unix time the item expires at, 0 if never
+    uint32_t expire;
+    uint8_t block_class;
+
+    // Value was read since it was changed last time, see Storage::Info
+    uint8_t fetched;
+
+    // Block is in the free list of its class, rather than being used or merged into a bigger one
+    uint8_t free_block;
+
+    inline char *key() { return reinterpret_cast<char *>(this + 1); }
+    inline char *value() { return key() + key_size; }
+};
+
+/**
+ * Holds segment lock. If previous owner died holding it, lock is made consistent again and the
+ * segment is used as is, see SharedMemoryImpl
+ */
+class SharedMemoryImpl::Guard {
+public:
+    Guard(const SharedMemoryImpl *storage) : storage(storage) {
+        Header *h = storage->header();
+        if (h == nullptr) {
+            throw std::runtime_error("Storage isn't started");
+        }
+
+        int rc = pthread_mutex_lock(&h->lock);
+        if (rc == EOWNERDEAD) {
+            pthread_mutex_consistent(&h->lock);
+        } else if (rc != 0) {
+            throw std::runtime_error(std::string("Failed to lock storage: ") + std::strerror(rc));
+        }
+    }
+
+    ~Guard() { pthread_mutex_unlock(&storage->header()->lock); }
+
+private:
+    const SharedMemoryImpl *storage;
+};
+
+const size_t SharedMemoryImpl::DefaultSize;
+const unsigned SharedMemoryImpl::MinClass;
+const unsigned SharedMemoryImpl::NumClasses;
+
+// See SharedMemoryImpl.h
+SharedMemoryImpl::SharedMemoryImpl(const std::string &path, size_t size)
+    : path(path), size(size), base(nullptr), mapped(0) {}
+
+// See SharedMemoryImpl.h
+SharedMemoryImpl::~SharedMemoryImpl() { Stop(); }
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::Start() {
+    if (base != nullptr) {
+        return;
+    }
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        throw_errno("Failed to open " + path);
+    }
+
+    // Another process could be attaching to the same segment right now
+    if (flock(fd, LOCK_EX) == -1) {
+        close(fd);
+        throw_errno("Failed to lock " + path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        throw_errno("Failed to stat " + path);
+    }
+
+    bool created = (st.st_size == 0);
+    mapped = created ? size : st.st_size;
+    if (mapped < MinSegmentSize) {
+        close(fd);
+        throw std::runtime_error("Storage segment is too small");
+    }
+    if (created && ftruncate(fd, mapped) == -1) {
+        close(fd);
+        throw_errno("Failed to resize " + path);
+    }
+
+    void *p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        close(fd);
+        throw_errno("Failed to map " + path);
+    }
+    base = static_cast<char *>(p);
+
+    Header *h = header();
+    if (created || h->magic != Magic || h->version != Version || h->header_size != sizeof(Header) ||
+        h->size != mapped) {
+        h->magic = 0;
+
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&h->lock, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        Format();
+        h->last_version = 0;
+        h->flushed_version = 0;
+        h->version = Version;
+        h->header_size = sizeof(Header);
+        h->size = mapped;
+        h->magic = Magic;
+    }
+
+    // Mapping stays valid after descriptor is closed. It references the file the same way
+    // descriptor does, so the lock must be released explicitly
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::Stop() {
+    if (base != nullptr) {
+        munmap(base, mapped);
+        base = nullptr;
+    }
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Put(const std::string &key, const std::string &value, uint32_t expire,
+                           uint64_t *version) {
+    uint64_t hash = hash_key(key);
+    Guard guard(this);
+
+    Item *it = Find(key, hash);
+    bool stored = (it != nullptr) ? Replace(it, key, value, expire) : Insert(key, hash, value, expire);
+    return Stored(stored, version);
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::PutIfAbsent(const std::string &key, const std::string &value, uint32_t expire,
+                                   uint64_t *version) {
+    uint64_t hash = hash_key(key);
+    Guard guard(this);
+
+    if (Find(key, hash) != nullptr) {
+        return false;
+    }
+    return Stored(Insert(key, hash, value, expire), version);
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Set(const std::string &key, const std::string &value, uint32_t expire,
+                           uint64_t *version) {
+    uint64_t hash = hash_key(key);
+    Guard guard(this);
+
+    Item *it = Find(key, hash);
+    if (it == nullptr) {
+        return false;
+    }
+    return Stored(Replace(it, key, value, expire), version);
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::CompareAndSet(const std::string &key, const std::string &value, uint64_t &version,
+                                     uint32_t expire) {
+    uint64_t hash = hash_key(key);
+    Guard guard(this);
+
+    Item *it = Find(key, hash);
+    if (it == nullptr || it->version != version) {
+        version = (it == nullptr) ? 0 : it->version;
+        return false;
+    }
+
+    if (!Replace(it, key, value, expire)) {
+        version = 0;
+        return false;
+    }
+    version = header()->last_version;
+    return true;
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Update(const std::string &key, const Updater &updater, uint64_t *version) {
+    uint64_t hash = hash_key(key);
+    Guard guard(this);
+
+    Item *it = Find(key, hash);
+    if (it == nullptr) {
+        return false;
+    }
+
+    // Buffer keeps its capacity, so appending to the same key doesn't allocate every time
+    thread_local std::string value;
+    value.assign(it->value(), it->value_size);
+    if (!updater(value)) {
+        Touch(it);
+        return false;
+    }
+    return Stored(Replace(it, key, value, it->expire), version);
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Append(const std::string &key, const std::string &data, uint64_t *version) {
+    return Stored(Extend(key, data, false), version);
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Prepend(const std::string &key, const std::string &data, uint64_t *version) {
+    return Stored(Extend(key, data, true), version);
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Delete(const std::string &key) {
+    uint64_t hash = hash_key(key);
+    Guard guard(this);
+
+    Item *it = Find(key, hash);
+    if (it == nullptr) {
+        return false;
+    }
+
+    Unlink(it);
+    Release(it);
+    return true;
+}
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::Flush(uint32_t at) {
+    Guard guard(this);
+
+    Header *h = header();
+    if (at == 0 || at <= Now()) {
+        h->flushed_version = h->last_version;
+        h->flush_at = 0;
+    } else {
+        h->flush_at = at;
+    }
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Get(const std::string &key, std::string &value) const {
+    uint64_t hash = hash_key(key);
+    Guard guard(this);
+
+    Item *it = Find(key, hash);
+    if (it == nullptr) {
+        return false;
+    }
+
+    Touch(it);
+    it->fetched = 1;
+    value.assign(it->value(), it->value_size);
+    return true;
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Get(const std::string &key, std::string &value, uint64_t &version) const {
+    uint64_t hash = hash_key(key);
+    Guard guard(this);
+
+    Item *it = Find(key, hash);
+    if (it == nullptr) {
+        return false;
+    }
+
+    Touch(it);
+    it->fetched = 1;
+    value.assign(it->value(), it->value_size);
+    version = it->version;
+    return true;
+}
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::MultiGet(const std::string *keys, size_t count, const Receiver &receiver) const {
+    // Single key is the most common case, it needs no allocation
+    uint64_t single;
+    std::vector<uint64_t> many;
+    uint64_t *hashes = &single;
+    if (count > 1) {
+        many.resize(count);
+        hashes = many.data();
+    }
+    for (size_t i = 0; i < count; i++) {
+        hashes[i] = hash_key(keys[i]);
+    }
+
+    Guard guard(this);
+    for (size_t i = 0; i < count; i++) {
+        if (i + PrefetchDistance < count) {
+            __builtin_prefetch(bucket(hashes[i + PrefetchDistance]));
+        }
+
+        Item *it = Find(keys[i], hashes[i]);
+        if (it == nullptr) {
+            continue;
+        }
+
+        Touch(it);
+        it->fetched = 1;
+        receiver(i, it->value(), it->value_size, it->version);
+    }
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Touch(const std::string &key, uint32_t expire) {
+    uint64_t hash = hash_key(key);
+    Guard guard(this);
+
+    Item *it = Find(key, hash);
+    if (it == nullptr) {
+        return false;
+    }
+
+    Touch(it);
+    it->expire = expire;
+    return true;
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::GetAndTouch(const std::string &key, uint32_t expire, std::string &value, uint64_t &version) {
+    uint64_t hash = hash_key(key);
+    Guard guard(this);
+
+    Item *it = Find(key, hash);
+    if (it == nullptr) {
+        return false;
+    }
+
+    Touch(it);
+    it->expire = expire;
+    it->fetched = 1;
+    value.assign(it->value(), it->value_size);
+    version = it->version;
+    return true;
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Inspect(const std::string &key, Info &info, std::string *value) const {
+    uint64_t hash = hash_key(key);
+    Guard guard(this);
+
+    Item *it = Find(key, hash);
+    if (it == nullptr) {
+        return false;
+    }
+
+    Touch(it);
+    info.version = it->version;
+    info.expire = it->expire;
+    info.size = it->value_size;
+    info.fetched = it->fetched != 0;
+    if (value != nullptr) {
+        it->fetched = 1;
+        value->assign(it->value(), it->value_size);
+    }
+    return true;
+}
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::ForEach(const Visitor &visitor) const {
+    std::vector<std::pair<offset_t, uint64_t>> live;
+    {
+        Guard guard(this);
+        Header *h = header();
+        uint32_t now = Now();
+        uint64_t flushed = (h->flush_at != 0 && h->flush_at <= now) ? h->last_version : h->flushed_version;
+        live.reserve(h->items);
+        for (offset_t off = h->lru_tail; off != 0;) {
+            Item *it = item(off);
+            off = it->lru_prev;
+            if (it->version <= flushed || (it->expire != 0 && it->expire <= now)) {
+                continue;
+            }
+            live.emplace_back(offset(it), it->version);
+        }
+    }
+
+    std::string key, value;
+    uint32_t expire;
+    for (const auto &entry : live) {
+        if (Copy(item(entry.first), entry.second, key, value, expire)) {
+            visitor(key, value, expire);
+        }
+    }
+}
+
+// See SharedMemoryImpl.h
+size_t SharedMemoryImpl::Size() const {
+    Guard guard(this);
+    return header()->items;
+}
+
+// See SharedMemoryImpl.h
+SharedMemoryImpl::offset_t *SharedMemoryImpl::bucket(uint64_t hash) const {
+    Header *h = header();
+    return reinterpret_cast<offset_t *>(base + h->buckets) + (hash & h->buckets_mask);
+}
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::Format() const {
+    Header *h = header();
+
+    size_t buckets = 64;
+    while (buckets * 2 <= mapped / ItemSizeHint) {
+        buckets *= 2;
+    }
+
+    h->buckets = align(sizeof(Header));
+    h->buckets_mask = buckets - 1;
+    std::memset(base + h->buckets, 0, buckets * sizeof(offset_t));
+
+    h->heap_start = align(h->buckets + buckets * sizeof(offset_t));
+    h->heap_end = mapped & ~(Alignment - 1);
+
+    h->lru_head = 0;
+    h->lru_tail = 0;
+    h->items = 0;
+    h->flush_at = 0;
+    std::memset(h->free_lists, 0, sizeof(h->free_lists));
+
+    // Heap is cut into the biggest blocks aligned on their size, the first one is the biggest
+    h->max_class = 0;
+    for (offset_t off = h->heap_start; off < h->heap_end;) {
+        unsigned cls = NumClasses - 1;
+        while ((offset_t(1) << cls) > h->heap_end - off || ((off - h->heap_start) & ((offset_t(1) << cls) - 1)) != 0) {
+            cls--;
+        }
+        h->max_class = std::max<uint32_t>(h->max_class, cls);
+        PushFree(item(off), cls);
+        off += offset_t(1) << cls;
+    }
+}
+
+// See SharedMemoryImpl.h
+SharedMemoryImpl::Item *SharedMemoryImpl::Find(const std::string &key, uint64_t hash) const {
+    // Every change looks its item up first, so nothing has been changed since the flush time
+    Header *h = header();
+    if (h->flush_at != 0 && h->flush_at <= Now()) {
+        h->flushed_version = h->last_version;
+        h->flush_at = 0;
+    }
+
+    for (Item *it = item(*bucket(hash)); it != nullptr; it = item(it->hash_next)) {
+        if (it->hash == hash && it->key_size == key.size() && std::memcmp(it->key(), key.data(), key.size()) == 0) {
+            if (it->version <= h->flushed_version || Expired(it->expire)) {
+                Unlink(it);
+                Release(it);
+                return nullptr;
+            }
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+// See SharedMemoryImpl.h
+SharedMemoryImpl::Item *SharedMemoryImpl::Allocate(size_t key_size, size_t value_size) {
+    Header *h = header();
+
+    size_t need = sizeof(Item) + key_size + value_size;
+    unsigned cls = MinClass;
+    while (cls < NumClasses && (size_t(1) << cls) < need) {
+        cls++;
+    }
+    if (cls > h->max_class) {
+        return nullptr;
+    }
+
+    while (true) {
+        // Take the smallest block that fits and split it in halves down to the required size
+        for (unsigned bigger = cls; bigger < NumClasses; bigger++) {
+            if (h->free_lists[bigger] == 0) {
+                continue;
+            }
+
+            Item *it = item(h->free_lists[bigger]);
+            PopFree(it);
+            while (bigger > cls) {
+                bigger--;
+                PushFree(item(offset(it) + (offset_t(1) << bigger)), bigger);
+            }
+            it->block_class = cls;
+            return it;
+        }
+
+        // Evict least recently used item, its block is merged with free neighbours, and try again.
+        // Once nothing is stored the whole heap is free again, so the biggest block is there
+        if (h->lru_tail == 0) {
+            return nullptr;
+        }
+        Item *victim = item(h->lru_tail);
+        Unlink(victim);
+        Release(victim);
+    }
+}
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::Release(Item *it) const {
+    Invalidate(it);
+
+    Header *h = header();
+    offset_t off = offset(it);
+    unsigned cls = it->block_class;
+
+    // Merge with the buddy while it is free as a whole
+    while (cls < h->max_class) {
+        offset_t buddy = h->heap_start + ((off - h->heap_start) ^ (offset_t(1) << cls));
+        if (buddy + (offset_t(1) << cls) > h->heap_end) {
+            break;
+        }
+
+        Item *other = item(buddy);
+        if (!other->free_block || other->block_class != cls) {
+            break;
+        }
+        PopFree(other);
+        off = std::min(off, buddy);
+        cls++;
+    }
+    PushFree(item(off), cls);
+}
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::Invalidate(Item *it) const {
+    __atomic_store_n(&it->version, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Copy(Item *it, uint64_t version, std::string &key, std::string &value,
+                            uint32_t &expire) const {
+    if (__atomic_load_n(&it->version, __ATOMIC_ACQUIRE) != version) {
+        return false;
+    }
+
+    // Block could be reused right now, so sizes are checked not to read past it
+    const Header *h = header();
+    size_t key_size = it->key_size;
+    size_t value_size = it->value_size;
+    unsigned cls = std::min<unsigned>(it->block_class, h->max_class);
+    if (offset(it) + (offset_t(1) << cls) > h->heap_end || sizeof(Item) + key_size + value_size > (size_t(1) << cls)) {
+        return false;
+    }
+
+    const char *data = reinterpret_cast<const char *>(it + 1);
+    key.assign(data, key_size);
+    value.assign(data + key_size, value_size);
+    expire = __atomic_load_n(&it->expire, __ATOMIC_RELAXED);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&it->version, __ATOMIC_RELAXED) == version;
+}
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::PushFree(Item *it, unsigned cls) const {
+    Header *h = header();
+    it->block_class = cls;
+    it->free_block = 1;
+    it->lru_prev = 0;
+    it->lru_next = h->free_lists[cls];
+    if (it->lru_next != 0) {
+        item(it->lru_next)->lru_prev = offset(it);
+    }
+    h->free_lists[cls] = offset(it);
+}
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::PopFree(Item *it) const {
+    if (it->lru_prev != 0) {
+        item(it->lru_prev)->lru_next = it->lru_next;
+    } else {
+        header()->free_lists[it->block_class] = it->lru_next;
+    }
+    if (it->lru_next != 0) {
+        item(it->lru_next)->lru_prev = it->lru_prev;
+    }
+    it->free_block = 0;
+}
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::Link(Item *it) {
+    Header *h = header();
+    offset_t off = offset(it);
+
+    offset_t *head = bucket(it->hash);
+    it->hash_next = *head;
+    *head = off;
+
+    it->lru_prev = 0;
+    it->lru_next = h->lru_head;
+    if (h->lru_head != 0) {
+        item(h->lru_head)->lru_prev = off;
+    } else {
+        h->lru_tail = off;
+    }
+    h->lru_head = off;
+    h->items++;
+}
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::Unlink(Item *it) const {
+    Header *h = header();
+    offset_t off = offset(it);
+
+    offset_t *link = bucket(it->hash);
+    while (*link != off) {
+        link = &item(*link)->hash_next;
+    }
+    *link = it->hash_next;
+
+    if (it->lru_prev != 0) {
+        item(it->lru_prev)->lru_next = it->lru_next;
+    } else {
+        h->lru_head = it->lru_next;
+    }
+    if (it->lru_next != 0) {
+        item(it->lru_next)->lru_prev = it->lru_prev;
+    } else {
+        h->lru_tail = it->lru_prev;
+    }
+    h->items--;
+}
+
+// See SharedMemoryImpl.h
+void SharedMemoryImpl::Touch(Item *it) const {
+    Header *h = header();
+    offset_t off = offset(it);
+    if (h->lru_head == off) {
+        return;
+    }
+
+    item(it->lru_prev)->lru_next = it->lru_next;
+    if (it->lru_next != 0) {
+        item(it->lru_next)->lru_prev = it->lru_prev;
+    } else {
+        h->lru_tail = it->lru_prev;
+    }
+
+    it->lru_prev = 0;
+    it->lru_next = h->lru_head;
+    item(h->lru_head)->lru_prev = off;
+    h->lru_head = off;
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Insert(const std::string &key, uint64_t hash, const std::string &value, uint32_t expire,
+                              size_t slack) {
+    Item *it = Allocate(key.size(), value.size() + slack);
+    if (it == nullptr && slack != 0) {
+        it = Allocate(key.size(), value.size());
+    }
+    if (it == nullptr) {
+        return false;
+    }
+
+    it->hash = hash;
+    it->version = ++header()->last_version;
+    it->key_size = key.size();
+    it->value_size = value.size();
+    it->expire = expire;
+    it->fetched = 0;
+    std::memcpy(it->key(), key.data(), key.size());
+    std::memcpy(it->value(), value.data(), value.size());
+    Link(it);
+    return true;
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Replace(Item *it, const std::string &key, const std::string &value, uint32_t expire) {
+    if (sizeof(Item) + key.size() + value.size() <= (size_t(1) << it->block_class)) {
+        Invalidate(it);
+        std::memcpy(it->value(), value.data(), value.size());
+        it->value_size = value.size();
+        it->expire = expire;
+        it->fetched = 0;
+        __atomic_store_n(&it->version, ++header()->last_version, __ATOMIC_RELEASE);
+        Touch(it);
+        return true;
+    }
+
+    uint64_t hash = it->hash;
+    Unlink(it);
+    Release(it);
+    return Insert(key, hash, value, expire);
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Stored(bool stored, uint64_t *version) const {
+    if (stored && version != nullptr) {
+        *version = header()->last_version;
+    }
+    return stored;
+}
+
+// See SharedMemoryImpl.h
+bool SharedMemoryImpl::Extend(const std::string &key, const std::string &data, bool front) {
+    uint64_t hash = hash_key(key);
+    Guard guard(this);
+
+    Item *it = Find(key, hash);
+    if (it == nullptr) {
+        return false;
+    }
+
+    if (sizeof(Item) + key.size() + it->value_size + data.size() <= (size_t(1) << it->block_class)) {
+        Invalidate(it);
+        if (front) {
+            std::memmove(it->value() + data.size(), it->value(), it->value_size);
+            std::memcpy(it->value(), data.data(), data.size());
+        } else {
+            std::memcpy(it->value() + it->value_size, data.data(), data.size());
+        }
+        it->value_size += data.size();
+        __atomic_store_n(&it->version, ++header()->last_version, __ATOMIC_RELEASE);
+        it->fetched = 0;
+        Touch(it);
+        return true;
+    }
+
+    thread_local std::string value;
+    value.assign(it->value(), it->value_size);
+    if (front) {
+        value.insert(0, data);
+    } else {
+        value.append(data);
+    }
+
+    uint32_t expire = it->expire;
+    Unlink(it);
+    Release(it);
+    return Insert(key, hash, value, expire, value.size());
+}
+
+} // namespace Backend
+} // namespace Afina
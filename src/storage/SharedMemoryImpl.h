@@ -0,0 +1,194 @@
+#ifndef AFINA_STORAGE_SHARED_MEMORY_IMPL_H
+#define AFINA_STORAGE_SHARED_MEMORY_IMPL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <afina/Storage.h>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Storage living in the shared memory segment
+ * Items, hash index and LRU list are placed into the file mapped with MAP_SHARED (normally it is
+ * somewhere in /dev/shm) and reference each other by offsets from the segment start. So memory
+ * survives process restart: new process maps the same file and serves cached items right away.
+ *
+ * Segment is guarded by robust process shared mutex, so old and new processes could work with it
+ * at the same time during restart. If process dies while holding the lock, the next one taking it
+ * marks the lock consistent and goes on with the segment as is: a change is a few stores, so at most
+ * one item is left half way changed, which is better than losing the whole cache.
+ *
+ * Memory is managed by the buddy allocator: blocks are powers of two, free blocks are kept in per
+ * size lists, bigger blocks are split on demand and freed blocks are merged back with their free
+ * buddies. Once segment is full least recently used items are evicted until the block of the
+ * required size is freed, so big values don't wipe out small ones
+ */
+class SharedMemoryImpl : public Afina::Storage {
+public:
+    /**
+     * @param path of the file backing the segment, created if doesn't exist
+     * @param size of the segment in bytes, used only when segment is created. Existing segment
+     * keeps its size
+     */
+    SharedMemoryImpl(const std::string &path, size_t size = DefaultSize);
+    ~SharedMemoryImpl();
+
+    /**
+     * Maps the segment, formats it if it is new or was created by incompatible version
+     */
+    void Start() override;
+
+    /**
+     * Unmaps the segment, content stays in the file
+     */
+    void Stop() override;
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value, uint32_t expire = 0,
+             uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, uint32_t expire = 0,
+                     uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, uint32_t expire = 0,
+             uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool CompareAndSet(const std::string &key, const std::string &value, uint64_t &version,
+                       uint32_t expire = 0) override;
+
+    /**
+     * Value is copied out of the segment for the updater and written back in place if it still fits
+     * in the block
+     */
+    bool Update(const std::string &key, const Updater &updater, uint64_t *version = nullptr) override;
+
+    /**
+     * Data is written right after the value if the block has room for it. Otherwise item moves to
+     * the block with room for as much data again, so series of appends takes time proportional to
+     * the appended data
+     */
+    bool Append(const std::string &key, const std::string &data, uint64_t *version = nullptr) override;
+
+    /**
+     * Same as Append, value is moved within the block to make room in front of it
+     */
+    bool Prepend(const std::string &key, const std::string &data, uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    // Implements Afina::Storage interface
+    void Flush(uint32_t at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) const override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value, uint64_t &version) const override;
+
+    /**
+     * All keys are looked up under the lock taken once, hash buckets of the next keys are
+     * prefetched while the current one is looked up
+     */
+    void MultiGet(const std::string *keys, size_t count, const Receiver &receiver) const override;
+
+    // Implements Afina::Storage interface
+    bool Touch(const std::string &key, uint32_t expire) override;
+
+    // Implements Afina::Storage interface
+    bool GetAndTouch(const std::string &key, uint32_t expire, std::string &value, uint64_t &version) override;
+
+    // Implements Afina::Storage interface
+    bool Inspect(const std::string &key, Info &info, std::string *value = nullptr) const override;
+
+    /**
+     * Segment is mapped shared, so the forked snapshot process sees every change made by the server
+     * rather than a copy-on-write image. Only positions and versions of live items are taken under
+     * the lock, keys and values are copied without it and the copy is dropped if the version of the
+     * item has changed meanwhile. So writers are blocked for the walk over the LRU list only, and
+     * items changed while the walk goes on are left out
+     */
+    void ForEach(const Visitor &visitor) const override;
+
+    /**
+     * Number of items in the segment
+     */
+    size_t Size() const;
+
+    static const size_t DefaultSize = 64 * 1024 * 1024;
+
+private:
+    struct Header;
+    struct Item;
+    class Guard;
+
+    // Offset of an object in the segment, 0 is the header so it is used as null
+    typedef uint64_t offset_t;
+
+    // Blocks smaller than that are never allocated
+    static const unsigned MinClass = 6;
+    static const unsigned NumClasses = 48;
+
+    inline Header *header() const { return reinterpret_cast<Header *>(base); }
+    inline Item *item(offset_t off) const { return off == 0 ? nullptr : reinterpret_cast<Item *>(base + off); }
+    inline offset_t offset(const Item *it) const { return reinterpret_cast<const char *>(it) - base; }
+    offset_t *bucket(uint64_t hash) const;
+
+    // Resets segment to the empty state, leaving lock untouched
+    void Format() const;
+
+    // Expired or flushed item is released on the way and isn't returned
+    Item *Find(const std::string &key, uint64_t hash) const;
+
+    // Allocates item of the given size evicting old ones if needs, returns nullptr if item could
+    // never fit in the segment
+    Item *Allocate(size_t key_size, size_t value_size);
+    void Release(Item *it) const;
+
+    // Tells readers copying the item without the lock that it is about to change, see ForEach.
+    // Content of the item is changed only after that and gets the new version once it is done
+    void Invalidate(Item *it) const;
+
+    // Copies key, value and expiration time of the item without the lock, returns false if it had
+    // been changed since it got the given version
+    bool Copy(Item *it, uint64_t version, std::string &key, std::string &value, uint32_t &expire) const;
+
+    // Free lists maintenance, PushFree also sets class of the block
+    void PushFree(Item *it, unsigned cls) const;
+    void PopFree(Item *it) const;
+
+    // Index and LRU list maintenance
+    void Link(Item *it);
+    void Unlink(Item *it) const;
+    void Touch(Item *it) const;
+
+    // Allocates new item with given content and puts it in the index, block gets room for the
+    // value to grow by slack bytes
+    bool Insert(const std::string &key, uint64_t hash, const std::string &value, uint32_t expire, size_t slack = 0);
+
+    // Changes value and expiration time of the existing item, in place if it still fits in the block
+    bool Replace(Item *it, const std::string &key, const std::string &value, uint32_t expire);
+
+    // Reports version of the item just stored, that is the last given one, if it is asked for
+    bool Stored(bool stored, uint64_t *version) const;
+
+    // Adds data to the value of the existing item, see Append
+    bool Extend(const std::string &key, const std::string &data, bool front);
+
+    const std::string path;
+    const size_t size;
+
+    char *base;
+    size_t mapped;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_SHARED_MEMORY_IMPL_H
@@ -0,0 +1,269 @@
+#include "SnapshotFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+const char Magic[8] = {'A', 'F', 'S', 'N', 'A', 'P', '0', '3'};
+const char TrailerMagic[8] = {'A', 'F', 'S', 'N', 'A', 'P', 'N', 'D'};
+
+struct SectionHeader {
+    uint32_t records;
+    uint32_t crc;
+    uint64_t size;
+};
+
+struct Trailer {
+    uint64_t table_offset;
+    uint64_t sections;
+    uint64_t records;
+    uint32_t table_crc;
+    uint32_t reserved;
+    char magic[8];
+};
+
+void throw_errno(const std::string &what) { throw std::runtime_error(what + ": " + std::strerror(errno)); }
+
+// Lookup tables for slicing-by-8 CRC-32C, reversed polynomial 0x82f63b78
+struct CrcTables {
+    CrcTables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int j = 0; j < 8; j++) {
+                crc = (crc >> 1) ^ (0x82f63b78 & (0 - (crc & 1)));
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int t = 1; t < 8; t++) {
+                table[t][i] = (table[t - 1][i] >> 8) ^ table[0][table[t - 1][i] & 0xff];
+            }
+        }
+    }
+
+    uint32_t table[8][256];
+};
+
+const CrcTables crc_tables;
+
+} // namespace
+
+// See SnapshotFile.h
+uint32_t Crc32c(uint32_t crc, const void *data, size_t size) {
+    const auto &t = crc_tables.table;
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+
+    crc = ~crc;
+    while (size >= 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, sizeof(lo));
+        std::memcpy(&hi, p + 4, sizeof(hi));
+        lo ^= crc;
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+    }
+    return ~crc;
+}
+
+const size_t SnapshotWriter::SectionSize;
+
+// See SnapshotFile.h
+SnapshotWriter::SnapshotWriter(const std::string &path)
+    : path(path), offset(0), section_records(0), records(0) {
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        throw_errno("Failed to open " + path);
+    }
+    section.reserve(SectionSize + SectionSize / 4);
+    Write(Magic, sizeof(Magic));
+}
+
+// See SnapshotFile.h
+SnapshotWriter::~SnapshotWriter() {
+    if (fd != -1) {
+        close(fd);
+    }
+}
+
+// See SnapshotFile.h
+void SnapshotWriter::Add(const std::string &key, const std::string &value, uint32_t expire) {
+    uint32_t fields[3] = {uint32_t(key.size()), uint32_t(value.size()), expire};
+    section.append(reinterpret_cast<const char *>(fields), sizeof(fields));
+    section.append(key);
+    section.append(value);
+    section_records++;
+    records++;
+
+    if (section.size() >= SectionSize) {
+        CloseSection();
+    }
+}
+
+// See SnapshotFile.h
+void SnapshotWriter::Close() {
+    CloseSection();
+
+    Trailer trailer;
+    std::memset(&trailer, 0, sizeof(trailer));
+    trailer.table_offset = offset;
+    trailer.sections = sections.size();
+    trailer.records = records;
+    trailer.table_crc = Crc32c(0, sections.data(), sections.size() * sizeof(uint64_t));
+    std::memcpy(trailer.magic, TrailerMagic, sizeof(TrailerMagic));
+
+    Write(sections.data(), sections.size() * sizeof(uint64_t));
+    Write(&trailer, sizeof(trailer));
+
+    if (fsync(fd) == -1) {
+        throw_errno("Failed to sync " + path);
+    }
+    close(fd);
+    fd = -1;
+}
+
+// See SnapshotFile.h
+void SnapshotWriter::CloseSection() {
+    if (section_records == 0) {
+        return;
+    }
+
+    SectionHeader header;
+    header.records = section_records;
+    header.crc = Crc32c(0, section.data(), section.size());
+    header.size = section.size();
+
+    sections.push_back(offset);
+    Write(&header, sizeof(header));
+    Write(section.data(), section.size());
+
+    section.clear();
+    section_records = 0;
+}
+
+// See SnapshotFile.h
+void SnapshotWriter::Write(const void *data, size_t size) {
+    const char *p = static_cast<const char *>(data);
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(fd, p + written, size - written);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n == -1) {
+            throw_errno("Failed to write " + path);
+        }
+        written += n;
+    }
+    offset += size;
+}
+
+// See SnapshotFile.h
+SnapshotReader::SnapshotReader(const std::string &path) : path(path), data(nullptr), size(0), records(0) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw_errno("Failed to open " + path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        throw_errno("Failed to stat " + path);
+    }
+    size = st.st_size;
+    if (size < sizeof(Magic) + sizeof(Trailer)) {
+        close(fd);
+        throw std::runtime_error("Snapshot " + path + " is truncated");
+    }
+
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        throw_errno("Failed to map " + path);
+    }
+    data = static_cast<const char *>(p);
+
+    // Sections are going to be read by many threads at once, ask kernel to read file ahead
+    madvise(p, size, MADV_WILLNEED);
+
+    Trailer trailer;
+    std::memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+    if (std::memcmp(data, Magic, sizeof(Magic)) != 0 ||
+        std::memcmp(trailer.magic, TrailerMagic, sizeof(TrailerMagic)) != 0) {
+        munmap(p, size);
+        throw std::runtime_error(path + " isn't a snapshot file or it is truncated");
+    }
+
+    // Section count is bounded by the file size first, so that the table size can't overflow
+    if (trailer.table_offset > size - sizeof(trailer) ||
+        trailer.sections > (size - sizeof(trailer) - trailer.table_offset) / sizeof(uint64_t)) {
+        munmap(p, size);
+        throw std::runtime_error("Snapshot " + path + " is corrupted");
+    }
+    size_t table_size = trailer.sections * sizeof(uint64_t);
+    if (table_size != size - sizeof(trailer) - trailer.table_offset) {
+        munmap(p, size);
+        throw std::runtime_error("Snapshot " + path + " is corrupted");
+    }
+
+    sections.resize(trailer.sections);
+    std::memcpy(sections.data(), data + trailer.table_offset, table_size);
+    if (Crc32c(0, sections.data(), table_size) != trailer.table_crc) {
+        munmap(p, size);
+        throw std::runtime_error("Snapshot " + path + " is corrupted");
+    }
+    records = trailer.records;
+}
+
+// See SnapshotFile.h
+SnapshotReader::~SnapshotReader() { munmap(const_cast<char *>(data), size); }
+
+// See SnapshotFile.h
+void SnapshotReader::ReadSection(size_t index, const Afina::Storage::Visitor &visitor) const {
+    uint64_t offset = sections[index];
+    SectionHeader header;
+    if (offset > size - sizeof(header)) {
+        throw std::runtime_error("Snapshot " + path + " is corrupted");
+    }
+    std::memcpy(&header, data + offset, sizeof(header));
+
+    const char *payload = data + offset + sizeof(header);
+    if (header.size > size - offset - sizeof(header) || Crc32c(0, payload, header.size) != header.crc) {
+        throw std::runtime_error("Snapshot " + path + " is corrupted");
+    }
+
+    std::string key, value;
+    size_t pos = 0;
+    for (uint32_t i = 0; i < header.records; i++) {
+        uint32_t fields[3];
+        if (header.size - pos < sizeof(fields)) {
+            throw std::runtime_error("Snapshot " + path + " is corrupted");
+        }
+        std::memcpy(fields, payload + pos, sizeof(fields));
+        pos += sizeof(fields);
+        if (header.size - pos < uint64_t(fields[0]) + fields[1]) {
+            throw std::runtime_error("Snapshot " + path + " is corrupted");
+        }
+
+        key.assign(payload + pos, fields[0]);
+        value.assign(payload + pos + fields[0], fields[1]);
+        pos += fields[0] + fields[1];
+        visitor(key, value, fields[2]);
+    }
+}
+
+} // namespace Backend
+} // namespace Afina
@@ -0,0 +1,107 @@
+#ifndef AFINA_STORAGE_SNAPSHOT_FILE_H
+#define AFINA_STORAGE_SNAPSHOT_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <afina/Storage.h>
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Snapshot file format
+ * File is written as a stream and read through mmap:
+ *
+ *   magic "AFSNAP03"
+ *   section*
+ *   section offsets table: 64 bit offset of each section
+ *   trailer: 64 bit table offset, 64 bit number of sections, 64 bit number of records,
+ *            32 bit table crc, 32 bit zero, magic "AFSNAPND"
+ *
+ * Each section is a header of 32 bit number of records, 32 bit payload crc and 64 bit payload size
+ * followed by payload. Payload is a sequence of records: 32 bit key size, 32 bit value size, 32 bit
+ * expiration time, key and value bytes. Sections are cut once payload gets bigger than SectionSize, so that they could
+ * be checked and loaded independently by different threads. Checksums are CRC-32C
+ */
+class SnapshotWriter {
+public:
+    /**
+     * Creates file at the given path, truncating existing one
+     */
+    SnapshotWriter(const std::string &path);
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter &) = delete;
+    SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+
+    /**
+     * Appends record to the current section, expire is unix time as Storage::Put takes it
+     */
+    void Add(const std::string &key, const std::string &value, uint32_t expire);
+
+    /**
+     * Writes out the last section, sections table and trailer, then syncs file to disk
+     */
+    void Close();
+
+    static const size_t SectionSize = 1024 * 1024;
+
+private:
+    void CloseSection();
+    void Write(const void *data, size_t size);
+
+    const std::string path;
+    int fd;
+
+    // Bytes written so far
+    uint64_t offset;
+
+    // Payload of the current section
+    std::string section;
+    uint32_t section_records;
+
+    std::vector<uint64_t> sections;
+    uint64_t records;
+};
+
+/**
+ * Maps snapshot file written by SnapshotWriter, checks its trailer and sections table
+ */
+class SnapshotReader {
+public:
+    SnapshotReader(const std::string &path);
+    ~SnapshotReader();
+
+    SnapshotReader(const SnapshotReader &) = delete;
+    SnapshotReader &operator=(const SnapshotReader &) = delete;
+
+    inline size_t Sections() const { return sections.size(); }
+    inline uint64_t Records() const { return records; }
+
+    /**
+     * Checks section checksum and calls visitor for each its record. Could be called for different
+     * sections from different threads
+     */
+    void ReadSection(size_t index, const Afina::Storage::Visitor &visitor) const;
+
+private:
+    const std::string path;
+    const char *data;
+    size_t size;
+
+    std::vector<uint64_t> sections;
+    uint64_t records;
+};
+
+/**
+ * Updates CRC-32C checksum with the data
+ */
+uint32_t Crc32c(uint32_t crc, const void *data, size_t size);
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_SNAPSHOT_FILE_H
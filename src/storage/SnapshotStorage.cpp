@@ -0,0 +1,383 @@
+#include "SnapshotStorage.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <afina/logging/Logger.h>
+
+#include "SnapshotFile.h"
+
+namespace Afina {
+namespace Backend {
+
+namespace {
+
+void throw_errno(const std::string &what) { throw std::runtime_error(what + ": " + std::strerror(errno)); }
+
+} // namespace
+
+// See SnapshotStorage.h
+SnapshotStorage::SnapshotStorage(std::shared_ptr<Afina::Storage> backend, const std::string &path)
+    : backend(backend), path(path), child(-1) {}
+
+// See SnapshotStorage.h
+SnapshotStorage::~SnapshotStorage() { Reap(true); }
+
+// See SnapshotStorage.h
+void SnapshotStorage::EnableJournal(const std::string &path, uint32_t sync_interval, size_t sync_ops,
+                                    const std::string &prefix) {
+    journal.reset(new Journal(path, sync_interval, sync_ops));
+    journal_path = path;
+    journal_prefix = prefix;
+}
+
+// See SnapshotStorage.h
+void SnapshotStorage::Start() {
+    backend->Start();
+    if (journal) {
+        journal->Start();
+    }
+}
+
+// See SnapshotStorage.h
+void SnapshotStorage::Stop() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        Reap(true);
+    }
+    if (journal) {
+        journal->Stop();
+    }
+    backend->Stop();
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Put(const std::string &key, const std::string &value, uint32_t expire,
+                          uint64_t *version) {
+    if (!Durable(key)) {
+        return backend->Put(key, value, expire, version);
+    }
+
+    std::lock_guard<std::mutex> guard(journal_lock);
+    bool result = backend->Put(key, value, expire, version);
+    if (result) {
+        journal->Put(key, value, expire);
+    }
+    return result;
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::PutIfAbsent(const std::string &key, const std::string &value, uint32_t expire,
+                                  uint64_t *version) {
+    if (!Durable(key)) {
+        return backend->PutIfAbsent(key, value, expire, version);
+    }
+
+    std::lock_guard<std::mutex> guard(journal_lock);
+    bool result = backend->PutIfAbsent(key, value, expire, version);
+    if (result) {
+        journal->Put(key, value, expire);
+    }
+    return result;
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Set(const std::string &key, const std::string &value, uint32_t expire,
+                          uint64_t *version) {
+    if (!Durable(key)) {
+        return backend->Set(key, value, expire, version);
+    }
+
+    std::lock_guard<std::mutex> guard(journal_lock);
+    bool result = backend->Set(key, value, expire, version);
+    if (result) {
+        journal->Put(key, value, expire);
+    }
+    return result;
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::CompareAndSet(const std::string &key, const std::string &value, uint64_t &version,
+                                    uint32_t expire) {
+    if (!Durable(key)) {
+        return backend->CompareAndSet(key, value, version, expire);
+    }
+
+    std::lock_guard<std::mutex> guard(journal_lock);
+    bool result = backend->CompareAndSet(key, value, version, expire);
+    if (result) {
+        journal->Put(key, value, expire);
+    }
+    return result;
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Update(const std::string &key, const Updater &updater, uint64_t *version) {
+    if (!Durable(key)) {
+        return backend->Update(key, updater, version);
+    }
+
+    // Journal needs the new value, it is copied while the wrapped storage still holds the key.
+    // Expiration time stays the same, it is read back while the lock keeps other changes of the key out
+    std::lock_guard<std::mutex> guard(journal_lock);
+    bool accepted = false;
+    std::string value;
+    bool result = backend->Update(key,
+                                  [&updater, &accepted, &value](std::string &current) {
+                                      accepted = updater(current);
+                                      if (accepted) {
+                                          value = current;
+                                      }
+                                      return accepted;
+                                  },
+                                  version);
+    Info info{};
+    if (result && backend->Inspect(key, info)) {
+        journal->Put(key, value, info.expire);
+    } else if (accepted) {
+        // Key is gone: new value didn't fit, or it has expired in between
+        journal->Delete(key);
+    }
+    return result;
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Append(const std::string &key, const std::string &data, uint64_t *version) {
+    return Durable(key) ? Storage::Append(key, data, version) : backend->Append(key, data, version);
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Prepend(const std::string &key, const std::string &data, uint64_t *version) {
+    return Durable(key) ? Storage::Prepend(key, data, version) : backend->Prepend(key, data, version);
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Increment(const std::string &key, uint64_t delta, uint64_t &value) {
+    return Durable(key) ? Storage::Increment(key, delta, value) : backend->Increment(key, delta, value);
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Decrement(const std::string &key, uint64_t delta, uint64_t &value) {
+    return Durable(key) ? Storage::Decrement(key, delta, value) : backend->Decrement(key, delta, value);
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Delete(const std::string &key) {
+    if (!Durable(key)) {
+        return backend->Delete(key);
+    }
+
+    std::lock_guard<std::mutex> guard(journal_lock);
+    bool result = backend->Delete(key);
+    if (result) {
+        journal->Delete(key);
+    }
+    return result;
+}
+
+// See SnapshotStorage.h
+void SnapshotStorage::Flush(uint32_t at) {
+    if (journal == nullptr) {
+        backend->Flush(at);
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(journal_lock);
+    backend->Flush(at);
+    journal->Flush(at);
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Get(const std::string &key, std::string &value) const { return backend->Get(key, value); }
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Get(const std::string &key, std::string &value, uint64_t &version) const {
+    return backend->Get(key, value, version);
+}
+
+// See SnapshotStorage.h
+void SnapshotStorage::MultiGet(const std::string *keys, size_t count, const Receiver &receiver) const {
+    backend->MultiGet(keys, count, receiver);
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Touch(const std::string &key, uint32_t expire) {
+    if (!Durable(key)) {
+        return backend->Touch(key, expire);
+    }
+
+    std::lock_guard<std::mutex> guard(journal_lock);
+    bool result = backend->Touch(key, expire);
+    if (result) {
+        journal->Touch(key, expire);
+    }
+    return result;
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::GetAndTouch(const std::string &key, uint32_t expire, std::string &value, uint64_t &version) {
+    if (!Durable(key)) {
+        return backend->GetAndTouch(key, expire, value, version);
+    }
+
+    std::lock_guard<std::mutex> guard(journal_lock);
+    bool result = backend->GetAndTouch(key, expire, value, version);
+    if (result) {
+        journal->Touch(key, expire);
+    }
+    return result;
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Inspect(const std::string &key, Info &info, std::string *value) const {
+    return backend->Inspect(key, info, value);
+}
+
+// See SnapshotStorage.h
+void SnapshotStorage::ForEach(const Visitor &visitor) const { backend->ForEach(visitor); }
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Snapshot() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!Reap(false)) {
+        return false;
+    }
+
+    // Journal is rotated right before fork, so the new journal has only changes made after the
+    // point snapshot is taken at
+    std::unique_lock<std::mutex> journal_guard(journal_lock, std::defer_lock);
+    if (journal) {
+        journal_guard.lock();
+        try {
+            journal->Rotate();
+        } catch (std::runtime_error &ex) {
+            LOG_ERROR(ex.what());
+            return false;
+        }
+    }
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        LOG_ERROR("Failed to fork snapshot process: " << std::strerror(errno));
+        return false;
+    } else if (pid == 0) {
+        // Only the forking thread exists in the child, so don't touch anything but the storage
+        // and leave without running destructors and atexit handlers of the server
+        try {
+            Write(*backend, path);
+            _exit(0);
+        } catch (std::exception &ex) {
+            _exit(1);
+        }
+    }
+
+    child = pid;
+    return true;
+}
+
+// See SnapshotStorage.h
+size_t SnapshotStorage::Load(unsigned threads) {
+    size_t loaded = 0;
+    if (access(path.c_str(), F_OK) == 0) {
+        loaded = Load(*backend, path, threads);
+    }
+    if (journal) {
+        loaded += Journal::Replay(*backend, journal_path);
+    }
+    return loaded;
+}
+
+// See SnapshotStorage.h
+void SnapshotStorage::Write(const Afina::Storage &storage, const std::string &path) {
+    std::string tmp_path = path + ".tmp";
+    SnapshotWriter writer(tmp_path);
+    storage.ForEach([&writer](const std::string &key, const std::string &value, uint32_t expire) {
+        writer.Add(key, value, expire);
+    });
+    writer.Close();
+
+    if (rename(tmp_path.c_str(), path.c_str()) == -1) {
+        throw_errno("Failed to rename " + tmp_path);
+    }
+}
+
+// See SnapshotStorage.h
+size_t SnapshotStorage::Load(Afina::Storage &storage, const std::string &path, unsigned threads) {
+    SnapshotReader reader(path);
+
+    // Threads take sections one by one, so that they all finish at about the same time even if
+    // sections differ in size. Records expired while the server was down are skipped
+    const uint32_t now = uint32_t(std::time(nullptr));
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> loaded(0);
+    std::mutex error_lock;
+    std::exception_ptr error;
+    auto load = [&]() {
+        try {
+            for (size_t i = next++; i < reader.Sections(); i = next++) {
+                reader.ReadSection(i, [&storage, &loaded, now](const std::string &key, const std::string &value,
+                                                               uint32_t expire) {
+                    if ((expire == 0 || expire > now) && storage.Put(key, value, expire)) {
+                        loaded++;
+                    }
+                });
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(error_lock);
+            error = std::current_exception();
+            next = reader.Sections();
+        }
+    };
+
+    std::vector<std::thread> loaders;
+    for (unsigned i = 1; i < threads && i < reader.Sections(); i++) {
+        loaders.emplace_back(load);
+    }
+    load();
+    for (auto &loader : loaders) {
+        loader.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return loaded;
+}
+
+// See SnapshotStorage.h
+bool SnapshotStorage::Reap(bool wait) {
+    if (child == -1) {
+        return true;
+    }
+
+    int status;
+    pid_t rc;
+    do {
+        rc = waitpid(child, &status, wait ? 0 : WNOHANG);
+    } while (rc == -1 && errno == EINTR);
+
+    if (rc == 0) {
+        return false;
+    }
+    if (rc == child && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        if (journal) {
+            journal->DropRotated();
+        }
+    } else {
+        LOG_ERROR("Failed to write snapshot " << path);
+    }
+    child = -1;
+    return true;
+}
+
+} // namespace Backend
+} // namespace Afina
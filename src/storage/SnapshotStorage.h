@@ -0,0 +1,185 @@
+#ifndef AFINA_STORAGE_SNAPSHOT_STORAGE_H
+#define AFINA_STORAGE_SNAPSHOT_STORAGE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <sys/types.h>
+
+#include <afina/Storage.h>
+
+#include "Journal.h"
+
+namespace Afina {
+namespace Backend {
+
+/**
+ * # Storage taking snapshots to disk
+ * Wraps another storage and adds snapshots to it. Snapshot is written by the child process forked
+ * from the server: it gets copy-on-write view of the process memory, so the server keeps serving
+ * writes while file is written. Wrapped storage is responsible to be consistent in the child, see
+ * ForEach implementations.
+ *
+ * Snapshot file format is described in SnapshotFile.h. File is written next to the target one and
+ * renamed over it once complete, so there is always one complete snapshot on disk.
+ *
+ * Optionally changes of keys with the given prefix are written to the journal, so they survive
+ * crash between snapshots. Journal is rotated at the moment of fork and rotated part is dropped
+ * once snapshot is written.
+ *
+ * Both snapshot and journal keep expiration times, keys expired by the time they are loaded are
+ * skipped
+ */
+class SnapshotStorage : public Afina::Storage {
+public:
+    SnapshotStorage(std::shared_ptr<Afina::Storage> backend, const std::string &path);
+    ~SnapshotStorage();
+
+    /**
+     * Enables journal of changes, must be called before Start
+     *
+     * @param path of the journal file
+     * @param sync_interval see Journal
+     * @param sync_ops see Journal
+     * @param prefix only changes of keys starting with it are journaled
+     */
+    void EnableJournal(const std::string &path, uint32_t sync_interval, size_t sync_ops, const std::string &prefix);
+
+    // Implements Afina::Storage interface
+    void Start() override;
+
+    /**
+     * Waits for snapshot in progress and stops wrapped storage
+     */
+    void Stop() override;
+
+    // Implements Afina::Storage interface
+    bool Put(const std::string &key, const std::string &value, uint32_t expire = 0,
+             uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool PutIfAbsent(const std::string &key, const std::string &value, uint32_t expire = 0,
+                     uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool Set(const std::string &key, const std::string &value, uint32_t expire = 0,
+             uint64_t *version = nullptr) override;
+
+    // Implements Afina::Storage interface
+    bool CompareAndSet(const std::string &key, const std::string &value, uint64_t &version,
+                       uint32_t expire = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Update(const std::string &key, const Updater &updater, uint64_t *version = nullptr) override;
+
+    /**
+     * Journal needs the whole value, so for durable keys it goes through Update
+     */
+    bool Append(const std::string &key, const std::string &data, uint64_t *version = nullptr) override;
+
+    /**
+     * See Append
+     */
+    bool Prepend(const std::string &key, const std::string &data, uint64_t *version = nullptr) override;
+
+    /**
+     * See Append
+     */
+    bool Increment(const std::string &key, uint64_t delta, uint64_t &value) override;
+
+    /**
+     * See Append
+     */
+    bool Decrement(const std::string &key, uint64_t delta, uint64_t &value) override;
+
+    // Implements Afina::Storage interface
+    bool Delete(const std::string &key) override;
+
+    /**
+     * Flush is written to the journal, so durable keys don't come back after restart
+     */
+    void Flush(uint32_t at = 0) override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value) const override;
+
+    // Implements Afina::Storage interface
+    bool Get(const std::string &key, std::string &value, uint64_t &version) const override;
+
+    // Implements Afina::Storage interface
+    void MultiGet(const std::string *keys, size_t count, const Receiver &receiver) const override;
+
+    /**
+     * New expiration time of durable key is journaled
+     */
+    bool Touch(const std::string &key, uint32_t expire) override;
+
+    /**
+     * See Touch
+     */
+    bool GetAndTouch(const std::string &key, uint32_t expire, std::string &value, uint64_t &version) override;
+
+    // Implements Afina::Storage interface
+    bool Inspect(const std::string &key, Info &info, std::string *value = nullptr) const override;
+
+    // Implements Afina::Storage interface
+    void ForEach(const Visitor &visitor) const override;
+
+    // Implements Afina::Storage interface
+    bool Snapshot() override;
+
+    /**
+     * Loads snapshot file, if there is one, into the wrapped storage and replays journal on top of
+     * it. Returns number of loaded records
+     *
+     * @param threads number of threads inserting records
+     */
+    size_t Load(unsigned threads);
+
+    /**
+     * Writes content of the storage into snapshot file in the calling thread
+     */
+    static void Write(const Afina::Storage &storage, const std::string &path);
+
+    /**
+     * Reads snapshot file into the storage. Sections of the file are checked and inserted by the
+     * given number of threads in parallel. Returns number of loaded records, the ones expired by
+     * now aren't loaded.
+     *
+     * Records are written from the least recently used one, so loading them in order restores LRU
+     * order. Each section is inserted in order, but sections are inserted at the same time, so with
+     * more than one thread LRU order holds only within a section and is mixed across them
+     */
+    static size_t Load(Afina::Storage &storage, const std::string &path, unsigned threads);
+
+private:
+    // Collects finished snapshot process, returns true if there is no snapshot in progress
+    bool Reap(bool wait);
+
+    // Key changes must be written to the journal
+    inline bool Durable(const std::string &key) const {
+        return journal != nullptr && key.compare(0, journal_prefix.size(), journal_prefix) == 0;
+    }
+
+    std::shared_ptr<Afina::Storage> backend;
+    const std::string path;
+
+    std::unique_ptr<Journal> journal;
+    std::string journal_path;
+    std::string journal_prefix;
+
+    // Makes change of the storage and its journal record atomic, so that journal has changes of the
+    // same key in the order they were applied. Also keeps journal rotation and fork together
+    std::mutex journal_lock;
+
+    std::mutex lock;
+
+    // Process writing snapshot, -1 if there is no one
+    pid_t child;
+};
+
+} // namespace Backend
+} // namespace Afina
+
+#endif // AFINA_STORAGE_SNAPSHOT_STORAGE_H
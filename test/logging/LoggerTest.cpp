@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <afina/logging/Logger.h>
+
+using namespace Afina::Logging;
+
+class LoggerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char name[] = "/tmp/afina-log-XXXXXX";
+        fd = mkstemp(name);
+        ASSERT_NE(fd, -1);
+        unlink(name);
+    }
+
+    void TearDown() override {
+        Logger::Instance().SetLevel(Info);
+        close(fd);
+    }
+
+    // Everything written to the log so far
+    std::string Read() {
+        std::string result;
+        char buffer[4096];
+        ssize_t n;
+        lseek(fd, 0, SEEK_SET);
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+            result.append(buffer, n);
+        }
+        return result;
+    }
+
+    int fd;
+};
+
+TEST_F(LoggerTest, Levels) {
+    Logger &logger = Logger::Instance();
+    logger.SetLevel(Warning);
+    logger.Start(fd, 1);
+
+    LOG_DEBUG("debug " << 1);
+    LOG_INFO("info " << 2);
+    LOG_WARNING("warning " << 3);
+    LOG_ERROR("error " << 4);
+    logger.Stop();
+
+    EXPECT_EQ(Read(), "[W] warning 3\n[E] error 4\n");
+}
+
+TEST_F(LoggerTest, ManyThreads) {
+    const int threads = 4, records = 2000;
+    Logger &logger = Logger::Instance();
+    logger.Start(fd, 1);
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; t++) {
+        writers.emplace_back([t, records]() {
+            for (int i = 0; i < records; i++) {
+                LOG_INFO(t << " " << i);
+                if (i % 100 == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        });
+    }
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    logger.Stop();
+
+    // Records of each thread are complete and in order
+    std::vector<int> next(threads, 0);
+    std::stringstream log(Read());
+    std::string prefix;
+    int t, i;
+    while (log >> prefix >> t >> i) {
+        ASSERT_EQ(prefix, "[I]");
+        ASSERT_EQ(i, next[t]);
+        next[t]++;
+    }
+    for (t = 0; t < threads; t++) {
+        EXPECT_EQ(next[t], records);
+    }
+}
+
+TEST_F(LoggerTest, Dropped) {
+    Logger &logger = Logger::Instance();
+    logger.Start(fd, 60000);
+
+    // Background thread sleeps, so the ring overflows
+    std::string record(1000, 'x');
+    for (size_t i = 0; i < 2 * Logger::RingSize / record.size(); i++) {
+        LOG_INFO(record);
+    }
+    logger.Stop();
+
+    std::string log = Read();
+    EXPECT_NE(log.find("log records dropped"), std::string::npos);
+    EXPECT_LT(log.size(), 2 * Logger::RingSize);
+}
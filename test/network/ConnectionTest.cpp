@@ -0,0 +1,41 @@
+#include "gtest/gtest.h"
+#include <string>
+
+#include <network/nonblocking/Worker.h>
+
+using namespace Afina::Network::NonBlocking;
+using namespace std;
+
+// Connection is handed off to another worker only between commands, fresh parser there would take
+// the rest of a half read command for the new one
+TEST(ConnectionTest, Movable) {
+    BufferPool pool;
+    Connection conn(-1, &pool);
+    EXPECT_TRUE(conn.Movable());
+
+    size_t parsed = 0;
+    EXPECT_FALSE(conn.parser.Parse("get fo", parsed));
+    EXPECT_FALSE(conn.Movable());
+    EXPECT_TRUE(conn.parser.Parse("o\r\n", parsed));
+    conn.parser.Reset();
+    EXPECT_TRUE(conn.Movable());
+
+    // Part of binary header is already copied into the parser, while command name isn't known yet
+    string header = {char(0x80), 0, 0, 3};
+    EXPECT_FALSE(conn.parser.Parse(header, parsed));
+    EXPECT_TRUE(conn.parser.Name().empty());
+    EXPECT_FALSE(conn.Movable());
+    conn.parser.Reset();
+
+    conn.input.push_back(pool.Get());
+    conn.input_tail = 1;
+    EXPECT_FALSE(conn.Movable());
+    conn.ReleaseInput();
+
+    conn.write.push_back("END\r\n");
+    EXPECT_FALSE(conn.Movable());
+    conn.write.clear();
+
+    conn.state = State::kBody;
+    EXPECT_FALSE(conn.Movable());
+}
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <network/nonblocking/HandoffQueue.h>
+
+using namespace Afina::Network::NonBlocking;
+using namespace std;
+
+TEST(HandoffQueueTest, PushPop) {
+    HandoffQueue<int> queue(4);
+
+    int value;
+    EXPECT_FALSE(queue.Pop(value));
+
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(queue.Push(i));
+    }
+    EXPECT_FALSE(queue.Push(4));
+
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(queue.Pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.Pop(value));
+}
+
+TEST(HandoffQueueTest, BadCapacity) { EXPECT_THROW(HandoffQueue<int>(6), std::runtime_error); }
+
+TEST(HandoffQueueTest, Concurrent) {
+    const int producers = 4;
+    const int per_producer = 10000;
+    HandoffQueue<int> queue(64);
+
+    vector<thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&queue, p, per_producer]() {
+            for (int i = 0; i < per_producer; i++) {
+                while (!queue.Push(p * per_producer + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    set<int> seen;
+    int value;
+    while (seen.size() < producers * per_producer) {
+        if (queue.Pop(value)) {
+            EXPECT_TRUE(seen.insert(value).second);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+    EXPECT_FALSE(queue.Pop(value));
+}
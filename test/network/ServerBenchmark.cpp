@@ -0,0 +1,122 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <afina/network/Server.h>
+#include <network/nonblocking/ServerImpl.h>
+#ifdef HAVE_IO_URING
+#include <network/uring/ServerImpl.h>
+#endif
+#include <storage/MapBasedStripedLockImpl.h>
+
+/**
+ * Measures request rate of the nonblocking and io_uring servers: each client connection sends
+ * batches of pipelined set and get pairs and waits for all responses of the batch before the next
+ * one. Both servers run the same number of workers on top of the same storage
+ *
+ * Usage: runServerBenchmark [connections, default 64] [batches per connection, default 2000]
+ *        [pairs per batch, default 16] [workers, default 4]
+ */
+int main(int argc, char **argv) {
+    unsigned connections = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    size_t batches = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000;
+    size_t pairs = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 16;
+    uint16_t workers = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 4;
+    const uint32_t port = 18090;
+
+    auto client = [batches, pairs, port](unsigned id, std::atomic<size_t> &failed) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == -1) {
+            failed++;
+            close(fd);
+            return;
+        }
+
+        // Batch is the same every time, so is the response
+        std::string request, response;
+        const std::string value(32, 'v');
+        for (size_t i = 0; i < pairs; i++) {
+            std::string key = "key-" + std::to_string(id) + "-" + std::to_string(i);
+            request += "set " + key + " 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+            request += "get " + key + "\r\n";
+            response += "STORED\r\nVALUE " + key + " 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\nEND\r\n";
+        }
+
+        std::string buffer(response.size(), '\0');
+        for (size_t b = 0; b < batches; b++) {
+            if (write(fd, request.data(), request.size()) != ssize_t(request.size())) {
+                failed++;
+                break;
+            }
+
+            size_t got = 0;
+            while (got < buffer.size()) {
+                ssize_t n = read(fd, &buffer[got], buffer.size() - got);
+                if (n <= 0) {
+                    break;
+                }
+                got += n;
+            }
+            if (got != buffer.size() || buffer != response) {
+                failed++;
+                break;
+            }
+        }
+        close(fd);
+    };
+
+    auto run = [&](const char *name, std::shared_ptr<Afina::Network::Server> server) {
+        server->Start(port, workers);
+
+        std::atomic<size_t> failed(0);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> clients;
+        for (unsigned i = 0; i < connections; i++) {
+            clients.emplace_back(client, i, std::ref(failed));
+        }
+        for (auto &thread : clients) {
+            thread.join();
+        }
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)
+                      .count();
+
+        server->Stop();
+        server->Join();
+
+        size_t requests = size_t(connections) * batches * pairs * 2;
+        std::cout << name << ": " << ms << "ms, " << (ms > 0 ? requests * 1000 / ms : 0) << " requests/s, "
+                  << failed << " connections failed" << std::endl;
+    };
+
+    auto storage = std::make_shared<Afina::Backend::MapBasedStripedLockImpl>();
+    run("nonblocking", std::make_shared<Afina::Network::NonBlocking::ServerImpl>(storage));
+#ifdef HAVE_IO_URING
+    if (Afina::Network::Uring::ServerImpl::Supported()) {
+        run("uring", std::make_shared<Afina::Network::Uring::ServerImpl>(storage));
+    } else {
+        std::cout << "uring: io_uring isn't supported by the kernel" << std::endl;
+    }
+#else
+    std::cout << "uring: not built, system headers don't know io_uring operations" << std::endl;
+#endif
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include <vector>
+
+#include <network/TimerWheel.h>
+
+using namespace Afina::Network;
+using namespace std;
+
+TEST(TimerWheelTest, Expire) {
+    TimerWheel wheel(10, 8);
+    wheel.Reset(0);
+
+    TimerWheel::Timer a, b;
+    wheel.Schedule(&a, 25);
+    wheel.Schedule(&b, 55);
+    EXPECT_EQ(wheel.Size(), 2);
+    EXPECT_EQ(wheel.NextTimeout(3), 7);
+
+    vector<TimerWheel::Timer *> expired;
+    wheel.Advance(20, expired);
+    EXPECT_TRUE(expired.empty());
+
+    wheel.Advance(30, expired);
+    ASSERT_EQ(expired.size(), 1);
+    EXPECT_EQ(expired[0], &a);
+    EXPECT_FALSE(a.Scheduled());
+
+    expired.clear();
+    wheel.Advance(60, expired);
+    ASSERT_EQ(expired.size(), 1);
+    EXPECT_EQ(expired[0], &b);
+    EXPECT_EQ(wheel.Size(), 0);
+    EXPECT_EQ(wheel.NextTimeout(60), -1);
+}
+
+TEST(TimerWheelTest, Cancel) {
+    TimerWheel wheel(10, 8);
+    wheel.Reset(0);
+
+    TimerWheel::Timer a;
+    wheel.Schedule(&a, 15);
+    wheel.Cancel(&a);
+    wheel.Cancel(&a);
+
+    vector<TimerWheel::Timer *> expired;
+    wheel.Advance(100, expired);
+    EXPECT_TRUE(expired.empty());
+    EXPECT_EQ(wheel.Size(), 0);
+}
+
+TEST(TimerWheelTest, LazyExtend) {
+    TimerWheel wheel(10, 8);
+    wheel.Reset(0);
+
+    TimerWheel::Timer a;
+    wheel.Schedule(&a, 15);
+
+    // Deadline moved further than the whole wheel span without rescheduling
+    a.deadline = 500;
+
+    vector<TimerWheel::Timer *> expired;
+    wheel.Advance(100, expired);
+    wheel.Advance(490, expired);
+    EXPECT_TRUE(expired.empty());
+    EXPECT_TRUE(a.Scheduled());
+
+    wheel.Advance(510, expired);
+    ASSERT_EQ(expired.size(), 1);
+    EXPECT_EQ(expired[0], &a);
+}
+
+TEST(TimerWheelTest, Many) {
+    TimerWheel wheel(1, 64);
+    wheel.Reset(0);
+
+    vector<TimerWheel::Timer> timers(1000);
+    for (size_t i = 0; i < timers.size(); i++) {
+        wheel.Schedule(&timers[i], i + 1);
+    }
+
+    vector<TimerWheel::Timer *> expired;
+    for (uint64_t now = 1; now <= 1000; now += 7) {
+        size_t before = expired.size();
+        wheel.Advance(now, expired);
+        for (size_t i = before; i < expired.size(); i++) {
+            EXPECT_LE(expired[i]->deadline, now);
+        }
+        EXPECT_EQ(expired.size(), now);
+    }
+}
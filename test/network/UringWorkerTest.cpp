@@ -0,0 +1,149 @@
+#include "gtest/gtest.h"
+
+// Server is built only if system headers know about io_uring operations it needs
+#ifdef HAVE_IO_URING
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <network/uring/Ring.h>
+#include <network/uring/Worker.h>
+#include <storage/MapBasedGlobalLockImpl.h>
+
+using namespace Afina::Network::Uring;
+using namespace std;
+
+static shared_ptr<Afina::Storage> NewStorage() {
+    return make_shared<Afina::Backend::MapBasedGlobalLockImpl>(1024 * 1024);
+}
+
+// Number of file descriptors open by the process
+static size_t OpenFiles() {
+    size_t count = 0;
+    DIR *dir = opendir("/proc/self/fd");
+    while (readdir(dir) != nullptr) {
+        count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+// Worker failed to start has no thread, so there is nothing to stop or join
+TEST(UringWorkerTest, JoinAfterFailedStart) {
+    Worker worker(NewStorage());
+
+    // Address doesn't belong to any interface, so bind fails
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = inet_addr("192.0.2.1");
+    ASSERT_THROW(worker.Start(address), runtime_error);
+
+    worker.Stop();
+    worker.Join();
+}
+
+TEST(UringWorkerTest, RequestResponse) {
+    if (!Ring::Supported()) {
+        cout << "io_uring isn't supported by the kernel, skipped" << endl;
+        return;
+    }
+
+    Worker worker(NewStorage());
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    worker.Start(address);
+
+    socklen_t len = sizeof(address);
+    ASSERT_EQ(getsockname(worker.ServerSocket(), (struct sockaddr *)&address, &len), 0);
+
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_NE(client, -1);
+    ASSERT_EQ(connect(client, (struct sockaddr *)&address, sizeof(address)), 0);
+    struct timeval timeout = {5, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // Pipelined requests, value big enough to take a few recv buffers
+    string value(10000, 'v');
+    string request = "set small 0 0 3\r\nabc\r\nset big 0 0 " + to_string(value.size()) + "\r\n" + value +
+                     "\r\nset quiet 0 0 1 noreply\r\nq\r\nget small big quiet\r\n";
+    ASSERT_EQ(write(client, request.data(), request.size()), ssize_t(request.size()));
+
+    string expected = "STORED\r\nSTORED\r\nVALUE small 0 3\r\nabc\r\nVALUE big 0 " + to_string(value.size()) + "\r\n" +
+                      value + "\r\nVALUE quiet 0 1\r\nq\r\nEND\r\n";
+    string response(expected.size(), '\0');
+    size_t got = 0;
+    while (got < response.size()) {
+        ssize_t n = read(client, &response[got], response.size() - got);
+        if (n <= 0) {
+            break;
+        }
+        got += n;
+    }
+    response.resize(got);
+    EXPECT_EQ(response, expected);
+
+    close(client);
+    worker.Stop();
+    worker.Join();
+}
+
+// Connection reset right after the request is closed in the same batch that got the request, it
+// must be released anyway
+TEST(UringWorkerTest, ResetAfterRequest) {
+    if (!Ring::Supported()) {
+        cout << "io_uring isn't supported by the kernel, skipped" << endl;
+        return;
+    }
+
+    Worker worker(NewStorage());
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    worker.Start(address);
+
+    socklen_t len = sizeof(address);
+    ASSERT_EQ(getsockname(worker.ServerSocket(), (struct sockaddr *)&address, &len), 0);
+
+    size_t before = OpenFiles();
+    string request = "set key 0 0 5\r\nvalue\r\nget key\r\n";
+    for (int i = 0; i < 20; i++) {
+        int client = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_NE(client, -1);
+        ASSERT_EQ(connect(client, (struct sockaddr *)&address, sizeof(address)), 0);
+        ASSERT_EQ(write(client, request.data(), request.size()), ssize_t(request.size()));
+
+        // Zero linger makes close send RST
+        struct linger reset = {1, 0};
+        setsockopt(client, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+        close(client);
+    }
+
+    // Worker closes server side sockets in background
+    for (int i = 0; i < 100 && OpenFiles() != before; i++) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    EXPECT_EQ(OpenFiles(), before);
+
+    worker.Stop();
+    worker.Join();
+}
+
+#endif // HAVE_IO_URING
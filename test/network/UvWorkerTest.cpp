@@ -0,0 +1,115 @@
+#include "gtest/gtest.h"
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <network/uv/Worker.h>
+#include <storage/MapBasedGlobalLockImpl.h>
+
+using namespace Afina::Network::UV;
+using namespace std;
+
+class UvWorkerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        worker.reset(new Worker(make_shared<Afina::Backend::MapBasedGlobalLockImpl>(1024 * 1024)));
+
+        struct sockaddr_storage address;
+        ASSERT_EQ(uv_ip4_addr("127.0.0.1", 0, (struct sockaddr_in *)&address), 0);
+        worker->Start(address);
+
+        struct sockaddr_in bound;
+        socklen_t len = sizeof(bound);
+        ASSERT_EQ(getsockname(worker->ServerSocket(), (struct sockaddr *)&bound, &len), 0);
+
+        client = socket(AF_INET, SOCK_STREAM, 0);
+        ASSERT_NE(client, -1);
+        bound.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ASSERT_EQ(connect(client, (struct sockaddr *)&bound, sizeof(bound)), 0);
+
+        struct timeval timeout = {5, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    void TearDown() override {
+        close(client);
+        worker->Stop();
+        worker->Join();
+    }
+
+    void Send(const string &data) { ASSERT_EQ(write(client, data.data(), data.size()), ssize_t(data.size())); }
+
+    // Reads exactly size bytes, fewer only if connection is closed or nothing comes for too long
+    string Receive(size_t size) {
+        string data(size, '\0');
+        size_t got = 0;
+        while (got < size) {
+            ssize_t n = read(client, &data[got], size - got);
+            if (n <= 0) {
+                break;
+            }
+            got += n;
+        }
+        data.resize(got);
+        return data;
+    }
+
+    // Tells whether anything else has been sent
+    bool Pending() {
+        char c;
+        return recv(client, &c, 1, MSG_DONTWAIT | MSG_PEEK) > 0;
+    }
+
+    unique_ptr<Worker> worker;
+    int client;
+};
+
+// Binary request with no extras but the ones given and no cas
+static string Request(uint8_t opcode, const string &extras, const string &key, const string &value) {
+    string packet(24, '\0');
+    uint32_t total = extras.size() + key.size() + value.size();
+    packet[0] = char(0x80);
+    packet[1] = char(opcode);
+    packet[2] = char(key.size() >> 8);
+    packet[3] = char(key.size());
+    packet[4] = char(extras.size());
+    for (int i = 0; i < 4; i++) {
+        packet[8 + i] = char(total >> (24 - 8 * i));
+    }
+    return packet + extras + key + value;
+}
+
+// Commands with nothing to reply are skipped, the next response comes right after the previous one
+TEST_F(UvWorkerTest, NothingToReply) {
+    string batch;
+    for (int i = 0; i < 100; i++) {
+        batch += "set key" + to_string(i) + " 0 0 5 noreply\r\nvalue\r\n";
+    }
+    Send(batch + "get key99\r\n");
+
+    string expected = "VALUE key99 0 5\r\nvalue\r\nEND\r\n";
+    EXPECT_EQ(Receive(expected.size()), expected);
+
+    // Quiet binary set succeeds silently, noop answers with the header only
+    batch.clear();
+    for (int i = 0; i < 100; i++) {
+        batch += Request(0x11, string(8, '\0'), "bin" + to_string(i), "value");
+    }
+    Send(batch + Request(0x0a, "", "", ""));
+
+    string response = Receive(24);
+    ASSERT_EQ(response.size(), 24);
+    EXPECT_EQ(uint8_t(response[0]), 0x81);
+    EXPECT_EQ(uint8_t(response[1]), 0x0a);
+    EXPECT_EQ(response.substr(6, 6), string(6, '\0'));
+
+    Send("get bin0 bin99\r\n");
+    expected = "VALUE bin0 0 5\r\nvalue\r\nVALUE bin99 0 5\r\nvalue\r\nEND\r\n";
+    EXPECT_EQ(Receive(expected.size()), expected);
+    EXPECT_FALSE(Pending());
+}
@@ -4,11 +4,19 @@
 #include <string>
 
 #include <afina/execute/Add.h>
+#include <afina/execute/Cas.h>
+#include <afina/execute/Delete.h>
+#include <afina/execute/FlushAll.h>
 #include <afina/execute/Get.h>
+#include <afina/execute/Incr.h>
+#include <afina/execute/MetaGet.h>
+#include <afina/execute/MetaSet.h>
 #include <afina/execute/Set.h>
 #include <afina/execute/Stats.h>
+#include <afina/execute/Touch.h>
 
 #include <protocol/Parser.h>
+#include <storage/MapBasedGlobalLockImpl.h>
 
 using namespace Afina;
 
@@ -27,11 +35,11 @@ TEST(MemcachedParserTest, SimpleSet) {
     ASSERT_EQ("set", parser.Name());
 
     uint32_t value_size;
-    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    Execute::Command *cmd = parser.Build(value_size);
     ASSERT_FALSE(cmd == nullptr);
     ASSERT_EQ(6, value_size);
 
-    Execute::Set *tmp = reinterpret_cast<Execute::Set *>(cmd.get());
+    Execute::Set *tmp = reinterpret_cast<Execute::Set *>(cmd);
     ASSERT_EQ("foo", tmp->key());
     ASSERT_EQ(0, tmp->flags());
     ASSERT_EQ(0, tmp->expire());
@@ -48,11 +56,11 @@ TEST(MemcachedParserTest, SimpleAdd) {
     ASSERT_EQ("add", parser.Name());
 
     uint32_t value_size;
-    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    Execute::Command *cmd = parser.Build(value_size);
     ASSERT_FALSE(cmd == nullptr);
     ASSERT_EQ(60, value_size);
 
-    Execute::Add *tmp = reinterpret_cast<Execute::Add *>(cmd.get());
+    Execute::Add *tmp = reinterpret_cast<Execute::Add *>(cmd);
     ASSERT_EQ("bar", tmp->key());
     ASSERT_EQ(10, tmp->flags());
     ASSERT_EQ(-1, tmp->expire());
@@ -69,11 +77,11 @@ TEST(MemcachedParserTest, SimpleGet) {
     ASSERT_EQ("get", parser.Name());
 
     uint32_t value_size;
-    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    Execute::Command *cmd = parser.Build(value_size);
     ASSERT_FALSE(cmd == nullptr);
     ASSERT_EQ(0, value_size);
 
-    Execute::Get *tmp = reinterpret_cast<Execute::Get *>(cmd.get());
+    Execute::Get *tmp = reinterpret_cast<Execute::Get *>(cmd);
     std::vector<std::string> keys = tmp->keys();
     ASSERT_EQ(3, keys.size());
     ASSERT_EQ("ke", keys[0]);
@@ -91,10 +99,647 @@ TEST(MemcachedParserTest, Stats) {
     ASSERT_EQ("stats", parser.Name());
 
     uint32_t value_size;
-    std::unique_ptr<Execute::Command> cmd = parser.Build(value_size);
+    Execute::Command *cmd = parser.Build(value_size);
     ASSERT_FALSE(cmd == nullptr);
     ASSERT_EQ(0, value_size);
 
-    Execute::Stats *tmp = reinterpret_cast<Execute::Stats *>(cmd.get());
+    Execute::Stats *tmp = reinterpret_cast<Execute::Stats *>(cmd);
 	ASSERT_FALSE(tmp == nullptr);
 }
+
+// Verify fields split between chunks of input are glued together
+TEST(MemcachedParserTest, SplitSet) {
+    Protocol::Parser parser;
+
+    std::string input = "set some_long_key_name 12 3600 6\r\n";
+    size_t consumed = 0;
+    ASSERT_FALSE(parser.Parse(input.substr(0, 2), consumed));
+    ASSERT_EQ(2, consumed);
+    ASSERT_FALSE(parser.Parse(input.substr(2, 10), consumed));
+    ASSERT_EQ(10, consumed);
+    ASSERT_FALSE(parser.Parse(input.substr(12, 14), consumed));
+    ASSERT_EQ(14, consumed);
+    ASSERT_TRUE(parser.Parse(input.substr(26), consumed));
+    ASSERT_EQ(input.size() - 26, consumed);
+    ASSERT_EQ("set", parser.Name());
+
+    uint32_t value_size;
+    Execute::Command *cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(6, value_size);
+
+    Execute::Set *tmp = reinterpret_cast<Execute::Set *>(cmd);
+    ASSERT_EQ("some_long_key_name", tmp->key());
+    ASSERT_EQ(12, tmp->flags());
+    ASSERT_EQ(3600, tmp->expire());
+}
+
+// Verify commands are reused by the next requests without leftovers of the previous ones
+TEST(MemcachedParserTest, ReusedCommands) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    uint32_t value_size;
+    ASSERT_TRUE(parser.Parse("get key1 key2 key3\r\n", consumed));
+    Execute::Command *first = parser.Build(value_size);
+    ASSERT_FALSE(first == nullptr);
+    ASSERT_EQ(3, reinterpret_cast<Execute::Get *>(first)->keys().size());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("get key4\r\n", consumed));
+    Execute::Command *second = parser.Build(value_size);
+    ASSERT_EQ(first, second);
+
+    std::vector<std::string> keys = reinterpret_cast<Execute::Get *>(second)->keys();
+    ASSERT_EQ(1, keys.size());
+    ASSERT_EQ("key4", keys[0]);
+}
+
+// Verify text replace and prepend build their own commands
+TEST(MemcachedParserTest, ReplacePrepend) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    uint32_t value_size;
+    ASSERT_TRUE(parser.Parse("replace foo 1 0 3\r\n", consumed));
+    Execute::Command *replace = parser.Build(value_size);
+    ASSERT_FALSE(replace == nullptr);
+    ASSERT_EQ(3, value_size);
+    ASSERT_EQ("foo", reinterpret_cast<Execute::InsertCommand *>(replace)->key());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("prepend bar 0 0 2\r\n", consumed));
+    Execute::Command *prepend = parser.Build(value_size);
+    ASSERT_FALSE(prepend == nullptr);
+    ASSERT_NE(replace, prepend);
+    ASSERT_EQ(2, value_size);
+    ASSERT_EQ("bar", reinterpret_cast<Execute::InsertCommand *>(prepend)->key());
+}
+
+// Verify gets asks for versions and cas carries one
+TEST(MemcachedParserTest, GetsCas) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    uint32_t value_size;
+    ASSERT_TRUE(parser.Parse("gets foo bar\r\n", consumed));
+    Execute::Command *gets = parser.Build(value_size);
+    ASSERT_FALSE(gets == nullptr);
+    ASSERT_TRUE(reinterpret_cast<Execute::Get *>(gets)->versions());
+    ASSERT_EQ(2, reinterpret_cast<Execute::Get *>(gets)->keys().size());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("get foo\r\n", consumed));
+    ASSERT_FALSE(reinterpret_cast<Execute::Get *>(parser.Build(value_size))->versions());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("cas foo 5 0 3 18446744073709551615\r\n", consumed));
+    Execute::Cas *cas = reinterpret_cast<Execute::Cas *>(parser.Build(value_size));
+    ASSERT_FALSE(cas == nullptr);
+    ASSERT_EQ(3, value_size);
+    ASSERT_EQ("foo", cas->key());
+    ASSERT_EQ(5, cas->flags());
+    ASSERT_EQ(UINT64_MAX, cas->version());
+
+    parser.Reset();
+    ASSERT_THROW(parser.Parse("cas foo 5 0 3 18446744073709551616\r\n", consumed), std::runtime_error);
+
+    // Cas unique can't be omitted
+    parser.Reset();
+    ASSERT_THROW(parser.Parse("cas foo 5 0 3\r\n", consumed), std::runtime_error);
+    parser.Reset();
+    ASSERT_THROW(parser.Parse("cas foo 5 0 3 \r\n", consumed), std::runtime_error);
+    parser.Reset();
+    ASSERT_THROW(parser.Parse("cas foo 5 0 3  noreply\r\n", consumed), std::runtime_error);
+}
+
+// Verify incr and decr have no body and carry delta
+TEST(MemcachedParserTest, IncrDecr) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    uint32_t value_size = 1;
+    ASSERT_TRUE(parser.Parse("incr counter 18446744073709551615\r\n", consumed));
+    Execute::Incr *incr = reinterpret_cast<Execute::Incr *>(parser.Build(value_size));
+    ASSERT_FALSE(incr == nullptr);
+    ASSERT_EQ(0, value_size);
+    ASSERT_EQ("counter", incr->key());
+    ASSERT_EQ(UINT64_MAX, incr->delta());
+    ASSERT_FALSE(incr->decrement());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("decr counter 5\r\n", consumed));
+    Execute::Incr *decr = reinterpret_cast<Execute::Incr *>(parser.Build(value_size));
+    ASSERT_EQ(5, decr->delta());
+    ASSERT_TRUE(decr->decrement());
+
+    parser.Reset();
+    ASSERT_THROW(parser.Parse("incr counter x\r\n", consumed), std::runtime_error);
+}
+
+// Verify touch, gat and gats carry expiration time
+TEST(MemcachedParserTest, TouchGat) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    uint32_t value_size = 1;
+    ASSERT_TRUE(parser.Parse("touch foo -1\r\n", consumed));
+    Execute::Touch *touch = reinterpret_cast<Execute::Touch *>(parser.Build(value_size));
+    ASSERT_FALSE(touch == nullptr);
+    ASSERT_EQ(0, value_size);
+    ASSERT_EQ("foo", touch->key());
+    ASSERT_EQ(-1, touch->expire());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("gats 3600 foo bar\r\n", consumed));
+    Execute::Get *gats = reinterpret_cast<Execute::Get *>(parser.Build(value_size));
+    ASSERT_FALSE(gats == nullptr);
+    ASSERT_TRUE(gats->touch());
+    ASSERT_TRUE(gats->versions());
+    ASSERT_EQ(3600, gats->expire());
+    ASSERT_EQ(2, gats->keys().size());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("gat 0 foo\r\n", consumed));
+    Execute::Get *gat = reinterpret_cast<Execute::Get *>(parser.Build(value_size));
+    ASSERT_TRUE(gat->touch());
+    ASSERT_FALSE(gat->versions());
+    ASSERT_EQ(std::vector<std::string>{"foo"}, gat->keys());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("get foo\r\n", consumed));
+    ASSERT_FALSE(reinterpret_cast<Execute::Get *>(parser.Build(value_size))->touch());
+
+    parser.Reset();
+    ASSERT_THROW(parser.Parse("touch foo\r\n", consumed), std::runtime_error);
+}
+
+// Verify delete and flush_all have no body
+TEST(MemcachedParserTest, DeleteFlushAll) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    uint32_t value_size = 1;
+    ASSERT_TRUE(parser.Parse("delete foo\r\n", consumed));
+    Execute::Delete *del = reinterpret_cast<Execute::Delete *>(parser.Build(value_size));
+    ASSERT_FALSE(del == nullptr);
+    ASSERT_EQ(0, value_size);
+    ASSERT_EQ("foo", del->key());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("delete bar 0\r\n", consumed));
+    ASSERT_EQ("bar", reinterpret_cast<Execute::Delete *>(parser.Build(value_size))->key());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("flush_all\r\n", consumed));
+    Execute::FlushAll *flush = reinterpret_cast<Execute::FlushAll *>(parser.Build(value_size));
+    ASSERT_FALSE(flush == nullptr);
+    ASSERT_EQ(0, flush->delay());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("flush_all 60\r\n", consumed));
+    ASSERT_EQ(60, reinterpret_cast<Execute::FlushAll *>(parser.Build(value_size))->delay());
+}
+
+// Verify noreply suppresses the response of any command having it
+TEST(MemcachedParserTest, Noreply) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    uint32_t value_size;
+    const char *requests[] = {"set foo 0 0 3 noreply\r\n",  "cas foo 0 0 3 1 noreply\r\n", "incr foo 1 noreply\r\n",
+                              "touch foo 10 noreply\r\n", "delete foo 0 noreply\r\n",   "flush_all noreply\r\n",
+                              "flush_all 10 noreply\r\n"};
+    for (const char *request : requests) {
+        parser.Reset();
+        ASSERT_TRUE(parser.Parse(request, consumed)) << request;
+        ASSERT_FALSE(parser.Build(value_size) == nullptr) << request;
+        ASSERT_EQ("", parser.Frame("STORED")) << request;
+    }
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("set foo 0 0 3\r\n", consumed));
+    ASSERT_EQ(3, reinterpret_cast<Execute::Set *>(parser.Build(value_size))->key().size());
+    ASSERT_EQ("STORED\r\n", parser.Frame("STORED"));
+
+    parser.Reset();
+    ASSERT_THROW(parser.Parse("set foo 0 0 3 noreplay\r\n", consumed), std::runtime_error);
+}
+
+// Verify meta commands collect key and flags
+TEST(MemcachedParserTest, MetaParse) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    uint32_t value_size = 0;
+    ASSERT_TRUE(parser.Parse("mg foo v c Oabc T60\r\n", consumed));
+    Execute::MetaGet *get = reinterpret_cast<Execute::MetaGet *>(parser.Build(value_size));
+    ASSERT_FALSE(get == nullptr);
+    ASSERT_EQ("foo", get->key());
+    ASSERT_EQ(4, get->flags().size());
+    ASSERT_EQ(60, get->expire());
+    ASSERT_EQ(0, value_size);
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("ms foo 5 T10 MA q\r\nvalue\r\n", consumed));
+    Execute::MetaSet *set = reinterpret_cast<Execute::MetaSet *>(parser.Build(value_size));
+    ASSERT_FALSE(set == nullptr);
+    ASSERT_EQ(5, value_size);
+    ASSERT_EQ('A', set->mode());
+    ASSERT_EQ(10, set->expire());
+    ASSERT_TRUE(set->quiet());
+
+    const char *invalid[] = {"mg foo x\r\n", "ms foo\r\n", "ms foo 1 MX\r\n", "ms foo 1 MA C1\r\n",
+                             "ma foo Dx\r\n", "mg foo T1x\r\n"};
+    for (const char *request : invalid) {
+        parser.Reset();
+        ASSERT_TRUE(parser.Parse(request, consumed)) << request;
+        ASSERT_THROW(parser.Build(value_size), std::runtime_error) << request;
+    }
+
+    parser.Reset();
+    ASSERT_THROW(parser.Parse("mg\r\n", consumed), std::runtime_error);
+}
+
+// Runs text request through the parser and the storage, returns framed response
+static std::string RunText(Protocol::Parser &parser, Storage &storage, const std::string &request,
+                           const std::string &body = "") {
+    size_t consumed = 0;
+    uint32_t value_size = 0;
+    parser.Reset();
+    EXPECT_TRUE(parser.Parse(request, consumed)) << request;
+    Execute::Command *cmd = parser.Build(value_size);
+    EXPECT_EQ(body.size(), value_size) << request;
+
+    std::string out;
+    cmd->Execute(storage, body, out);
+    return parser.Frame(std::move(out));
+}
+
+// Verify meta commands return the fields asked by flags
+TEST(MemcachedParserTest, MetaCommands) {
+    Protocol::Parser parser;
+    Backend::MapBasedGlobalLockImpl storage;
+
+    ASSERT_EQ("EN\r\n", RunText(parser, storage, "mg foo v\r\n"));
+    ASSERT_EQ("", RunText(parser, storage, "mg foo v q\r\n"));
+    ASSERT_EQ("HD Oabc kfoo\r\n", RunText(parser, storage, "ms foo 5 Oabc k\r\n", "value"));
+    ASSERT_EQ("NS\r\n", RunText(parser, storage, "ms foo 1 ME\r\n", "x"));
+    ASSERT_EQ("", RunText(parser, storage, "ms foo 4 MA q\r\n", "-end"));
+
+    // Metadata alone doesn't count as a hit
+    ASSERT_EQ("HD s9 t-1 h0 f0\r\n", RunText(parser, storage, "mg foo s t h f\r\n"));
+    ASSERT_EQ("VA 9 h0 O1\r\nvalue-end\r\n", RunText(parser, storage, "mg foo v h O1\r\n"));
+    ASSERT_EQ("HD h1\r\n", RunText(parser, storage, "mg foo h\r\n"));
+
+    std::string cas = RunText(parser, storage, "mg foo c\r\n");
+    ASSERT_EQ("HD c", cas.substr(0, 4));
+    std::string version = cas.substr(4, cas.size() - 6);
+    ASSERT_EQ("EX\r\n", RunText(parser, storage, "ms foo 1 C1\r\n", "x"));
+    ASSERT_EQ("NF\r\n", RunText(parser, storage, "ms bar 1 C1\r\n", "x"));
+    ASSERT_EQ("HD\r\n", RunText(parser, storage, "ms foo 1 C" + version + "\r\n", "x"));
+
+    ASSERT_EQ("NF\r\n", RunText(parser, storage, "ma cnt\r\n"));
+    ASSERT_EQ("VA 2\r\n10\r\n", RunText(parser, storage, "ma cnt N0 J10 v\r\n"));
+    ASSERT_EQ("VA 1 Ox\r\n7\r\n", RunText(parser, storage, "ma cnt MD D3 v Ox\r\n"));
+    ASSERT_EQ("HD t-1\r\n", RunText(parser, storage, "ma cnt t\r\n"));
+    ASSERT_EQ(std::string(Execute::Incr::NonNumeric) + "\r\n", RunText(parser, storage, "ma foo\r\n"));
+
+    ASSERT_EQ("HD kcnt\r\n", RunText(parser, storage, "md cnt k\r\n"));
+    ASSERT_EQ("NF\r\n", RunText(parser, storage, "md cnt\r\n"));
+    ASSERT_EQ("", RunText(parser, storage, "md cnt q\r\n"));
+    ASSERT_EQ("MN\r\n", RunText(parser, storage, "mn\r\n"));
+}
+
+// Verify misses and failures carry opaque and key, so pipelined responses could be matched
+TEST(MemcachedParserTest, MetaOpaqueOnMiss) {
+    Protocol::Parser parser;
+    Backend::MapBasedGlobalLockImpl storage;
+
+    ASSERT_EQ("EN O1 kfoo\r\n", RunText(parser, storage, "mg foo v O1 k\r\n"));
+    ASSERT_EQ("NS O2\r\n", RunText(parser, storage, "ms foo 1 MR O2 c\r\n", "x"));
+    ASSERT_EQ("NF O3 kfoo\r\n", RunText(parser, storage, "ms foo 1 C1 O3 k\r\n", "x"));
+    ASSERT_EQ("NF O4\r\n", RunText(parser, storage, "md foo O4\r\n"));
+    ASSERT_EQ("NF O5 kcnt\r\n", RunText(parser, storage, "ma cnt O5 k\r\n"));
+
+    ASSERT_EQ("HD\r\n", RunText(parser, storage, "ms foo 1\r\n", "x"));
+    ASSERT_EQ("EX O6\r\n", RunText(parser, storage, "ms foo 1 C999 O6\r\n", "x"));
+}
+
+// Verify meta set returns version of the value it has stored in every mode
+TEST(MemcachedParserTest, MetaSetCas) {
+    Protocol::Parser parser;
+    Backend::MapBasedGlobalLockImpl storage;
+
+    for (const char *mode : {"MS", "MA", "MP", "MR"}) {
+        std::string out = RunText(parser, storage, std::string("ms foo 1 c ") + mode + "\r\n", "x");
+        std::string value;
+        uint64_t version = 0;
+        ASSERT_TRUE(storage.Get("foo", value, version));
+        ASSERT_EQ("HD c" + std::to_string(version) + "\r\n", out) << mode;
+    }
+
+    storage.Delete("foo");
+    std::string out = RunText(parser, storage, "ms foo 1 c ME\r\n", "x");
+    std::string value;
+    uint64_t version = 0;
+    ASSERT_TRUE(storage.Get("foo", value, version));
+    ASSERT_EQ("HD c" + std::to_string(version) + "\r\n", out);
+}
+
+// Binary request header followed by extras, key and value
+static std::string BinaryRequest(uint8_t opcode, const std::string &extras, const std::string &key,
+                                 const std::string &value) {
+    size_t total = extras.size() + key.size() + value.size();
+    std::string packet = {char(0x80), char(opcode), char(key.size() >> 8), char(key.size()), char(extras.size()), 0, 0,
+                          0, char(total >> 24), char(total >> 16), char(total >> 8), char(total), 'o', 'p', 'a', 'q'};
+    packet.append(8, '\0');
+    return packet + extras + key + value;
+}
+
+// Verify binary set command split into many chunks
+TEST(MemcachedParserTest, BinarySet) {
+    Protocol::Parser parser;
+
+    std::string extras = {0, 0, 0, 10, 0, 0, 0, 60};
+    std::string input = BinaryRequest(0x01, extras, "foo", "fooval");
+
+    size_t consumed = 0;
+    ASSERT_FALSE(parser.Parse(input.data(), 10, consumed));
+    ASSERT_EQ(10, consumed);
+    ASSERT_FALSE(parser.Parse(input.data() + 10, 20, consumed));
+    ASSERT_EQ(20, consumed);
+    ASSERT_TRUE(parser.Parse(input.data() + 30, input.size() - 30, consumed));
+    ASSERT_EQ(5, consumed);
+    ASSERT_TRUE(parser.Binary());
+
+    uint32_t value_size;
+    Execute::Command *cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(6, value_size);
+
+    Execute::Set *tmp = dynamic_cast<Execute::Set *>(cmd);
+    ASSERT_FALSE(tmp == nullptr);
+    ASSERT_EQ("foo", tmp->key());
+    ASSERT_EQ(10, tmp->flags());
+    ASSERT_EQ(60, tmp->expire());
+
+    // Response carries opaque of the request
+    Backend::MapBasedGlobalLockImpl storage;
+    std::string out;
+    cmd->Execute(storage, "fooval", out);
+    std::string response = parser.Frame(out);
+    ASSERT_EQ(24, response.size());
+    ASSERT_EQ(char(0x81), response[0]);
+    ASSERT_EQ(char(0x01), response[1]);
+    ASSERT_EQ(0, response[6]);
+    ASSERT_EQ(0, response[7]);
+    ASSERT_EQ("opaq", response.substr(12, 4));
+
+    // Next command could be in the text protocol again
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse("stats\r\n", consumed));
+    ASSERT_FALSE(parser.Binary());
+    ASSERT_EQ("END\r\n", parser.Frame("END"));
+}
+
+// Verify binary store responses carry version of the stored value
+TEST(MemcachedParserTest, BinaryStoreCas) {
+    Protocol::Parser parser;
+    Backend::MapBasedGlobalLockImpl storage;
+
+    std::string extras(8, '\0');
+    const uint8_t opcodes[] = {0x02, 0x01, 0x03, 0x0e, 0x0f};
+    for (uint8_t opcode : opcodes) {
+        parser.Reset();
+        size_t consumed = 0;
+        ASSERT_TRUE(parser.Parse(BinaryRequest(opcode, extras, "foo", "bar"), consumed));
+
+        uint32_t value_size;
+        std::string out;
+        parser.Build(value_size)->Execute(storage, "bar", out);
+        std::string response = parser.Frame(out);
+        ASSERT_EQ(24, response.size());
+        ASSERT_EQ(0, response[7]);
+
+        std::string value;
+        uint64_t version = 0;
+        ASSERT_TRUE(storage.Get("foo", value, version));
+        ASSERT_NE(0, version);
+
+        uint64_t cas = 0;
+        for (size_t i = 16; i < 24; i++) {
+            cas = (cas << 8) | uint8_t(response[i]);
+        }
+        ASSERT_EQ(version, cas) << int(opcode);
+    }
+
+    // Failed add reports no version
+    parser.Reset();
+    size_t consumed = 0;
+    ASSERT_TRUE(parser.Parse(BinaryRequest(0x02, extras, "foo", "bar"), consumed));
+    uint32_t value_size;
+    std::string out;
+    parser.Build(value_size)->Execute(storage, "bar", out);
+    std::string response = parser.Frame(out);
+    ASSERT_EQ(2, response[7]);
+    ASSERT_EQ(std::string(8, '\0'), response.substr(16, 8));
+}
+
+// Runs binary request through the parser and the storage, returns framed response
+static std::string RunBinary(Protocol::Parser &parser, Storage &storage, const std::string &request,
+                             const std::string &body = "") {
+    size_t consumed = 0;
+    uint32_t value_size = 0;
+    parser.Reset();
+    EXPECT_TRUE(parser.Parse(request, consumed));
+    Execute::Command *cmd = parser.Build(value_size);
+    EXPECT_EQ(body.size(), value_size);
+
+    std::string out;
+    cmd->Execute(storage, body, out);
+    return parser.Frame(std::move(out));
+}
+
+// Verify binary get responses
+TEST(MemcachedParserTest, BinaryGet) {
+    Protocol::Parser parser;
+    Backend::MapBasedGlobalLockImpl storage;
+
+    size_t consumed = 0;
+    std::string input = BinaryRequest(0x0c, "", "key", "");
+    ASSERT_TRUE(parser.Parse(input, consumed));
+    ASSERT_EQ(input.size(), consumed);
+
+    uint32_t value_size;
+    Execute::Command *cmd = parser.Build(value_size);
+    ASSERT_FALSE(cmd == nullptr);
+    ASSERT_EQ(0, value_size);
+    ASSERT_EQ(1, reinterpret_cast<Execute::Get *>(cmd)->keys().size());
+    ASSERT_TRUE(reinterpret_cast<Execute::Get *>(cmd)->versions());
+
+    // Miss writes no text, response is built from the result of the command
+    std::string out;
+    cmd->Execute(storage, "", out);
+    ASSERT_EQ("", out);
+    std::string response = parser.Frame(out);
+    ASSERT_EQ(1, response[7]);
+
+    ASSERT_TRUE(storage.Put("key", "value"));
+    std::string value;
+    uint64_t version = 0;
+    ASSERT_TRUE(storage.Get("key", value, version));
+
+    response = RunBinary(parser, storage, input);
+    ASSERT_EQ(24 + 4 + 3 + 5, response.size());
+    ASSERT_EQ(0, response[7]);
+    ASSERT_EQ(3, response[3]);
+    ASSERT_EQ(4, response[4]);
+    ASSERT_EQ(12, response[11]);
+    uint64_t cas = 0;
+    for (size_t i = 16; i < 24; i++) {
+        cas = (cas << 8) | uint8_t(response[i]);
+    }
+    ASSERT_EQ(version, cas);
+    ASSERT_EQ("keyvalue", response.substr(28));
+
+    // Binary keys and values may contain anything the text reply would be confused by
+    std::string key = "k\r\nVALUE x 0 1 2\r\n";
+    std::string data = "a\r\nEND\r\nb";
+    ASSERT_TRUE(storage.Put(key, data));
+    response = RunBinary(parser, storage, BinaryRequest(0x0c, "", key, ""));
+    ASSERT_EQ(0, response[7]);
+    ASSERT_EQ(key + data, response.substr(28));
+
+    // Quiet get doesn't report misses
+    input = BinaryRequest(0x09, "", "missing", "");
+    ASSERT_EQ("", RunBinary(parser, storage, input));
+    response = RunBinary(parser, storage, BinaryRequest(0x09, "", "key", ""));
+    ASSERT_EQ(24 + 4 + 5, response.size());
+    ASSERT_EQ("value", response.substr(28));
+}
+
+// Verify binary stat sends each statistic in its own packet followed by the empty one
+TEST(MemcachedParserTest, BinaryStat) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    std::string input = BinaryRequest(0x10, "", "", "");
+    ASSERT_TRUE(parser.Parse(input, consumed));
+    ASSERT_TRUE(parser.Binary());
+
+    std::string response = parser.Frame("STAT pid 42\r\nSTAT version 1.0\r\nEND");
+    ASSERT_EQ(24 + 3 + 2 + 24 + 7 + 3 + 24, response.size());
+
+    ASSERT_EQ(char(0x10), response[1]);
+    ASSERT_EQ(3, response[3]);
+    ASSERT_EQ(5, response[11]);
+    ASSERT_EQ("opaq", response.substr(12, 4));
+    ASSERT_EQ("pid42", response.substr(24, 5));
+
+    ASSERT_EQ(7, response[29 + 3]);
+    ASSERT_EQ(10, response[29 + 11]);
+    ASSERT_EQ("version1.0", response.substr(29 + 24, 10));
+
+    std::string terminator = response.substr(29 + 34);
+    ASSERT_EQ(char(0x81), terminator[0]);
+    ASSERT_EQ(char(0x10), terminator[1]);
+    ASSERT_EQ(std::string(4, '\0'), terminator.substr(8, 4));
+
+    // Nothing but the terminator if there are no statistics
+    ASSERT_EQ(24, parser.Frame("END").size());
+}
+
+// Verify binary incr responds with the 8 bytes counter
+TEST(MemcachedParserTest, BinaryIncr) {
+    Protocol::Parser parser;
+    Backend::MapBasedGlobalLockImpl storage;
+
+    size_t consumed = 0;
+    std::string extras = {0, 0, 0, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 7, 0, 0, 0, 0};
+    std::string input = BinaryRequest(0x05, extras, "counter", "");
+    ASSERT_TRUE(parser.Parse(input, consumed));
+
+    uint32_t value_size;
+    Execute::Incr *incr = reinterpret_cast<Execute::Incr *>(parser.Build(value_size));
+    ASSERT_FALSE(incr == nullptr);
+    ASSERT_EQ(0, value_size);
+    ASSERT_EQ(3, incr->delta());
+
+    // Missing counter is created with the initial value
+    std::string out;
+    incr->Execute(storage, "", out);
+    std::string response = parser.Frame(out);
+    ASSERT_EQ(24 + 8, response.size());
+    ASSERT_EQ(std::string("\0\0\0\0\0\0\0\x07", 8), response.substr(24));
+
+    ASSERT_TRUE(storage.Put("counter", "255"));
+    response = RunBinary(parser, storage, input);
+    ASSERT_EQ(24 + 8, response.size());
+    ASSERT_EQ(0, response[7]);
+    ASSERT_EQ(std::string("\0\0\0\0\0\0\x01\x02", 8), response.substr(24));
+
+    // Decrement of the missing counter which must not be created
+    extras.replace(16, 4, std::string(4, char(0xff)));
+    response = RunBinary(parser, storage, BinaryRequest(0x06, extras, "missing", ""));
+    ASSERT_EQ(1, response[7]);
+
+    ASSERT_TRUE(storage.Put("counter", "abc"));
+    response = RunBinary(parser, storage, input);
+    ASSERT_EQ(6, response[7]);
+}
+
+// Verify binary touch and quiet gat responses
+TEST(MemcachedParserTest, BinaryTouchGat) {
+    Protocol::Parser parser;
+    Backend::MapBasedGlobalLockImpl storage;
+
+    size_t consumed = 0;
+    std::string extras = {0, 0, 0x0e, 0x10};
+    std::string input = BinaryRequest(0x1c, extras, "key", "");
+    ASSERT_TRUE(parser.Parse(input, consumed));
+
+    uint32_t value_size;
+    Execute::Touch *touch = reinterpret_cast<Execute::Touch *>(parser.Build(value_size));
+    ASSERT_FALSE(touch == nullptr);
+    ASSERT_EQ(3600, touch->expire());
+    ASSERT_EQ(24, parser.Frame("TOUCHED").size());
+    ASSERT_EQ(1, parser.Frame("NOT_FOUND")[7]);
+
+    parser.Reset();
+    input = BinaryRequest(0x1e, extras, "key", "");
+    ASSERT_TRUE(parser.Parse(input, consumed));
+    Execute::Get *gat = reinterpret_cast<Execute::Get *>(parser.Build(value_size));
+    ASSERT_TRUE(gat->touch());
+    ASSERT_EQ(3600, gat->expire());
+    std::string out;
+    gat->Execute(storage, "", out);
+    ASSERT_EQ("", parser.Frame(out));
+
+    ASSERT_TRUE(storage.Put("key", "value"));
+    ASSERT_EQ(24 + 4 + 5, RunBinary(parser, storage, input).size());
+}
+
+// Verify binary delete and quiet flush responses
+TEST(MemcachedParserTest, BinaryDeleteFlush) {
+    Protocol::Parser parser;
+
+    size_t consumed = 0;
+    std::string input = BinaryRequest(0x04, "", "key", "");
+    ASSERT_TRUE(parser.Parse(input, consumed));
+
+    uint32_t value_size;
+    Execute::Delete *del = reinterpret_cast<Execute::Delete *>(parser.Build(value_size));
+    ASSERT_FALSE(del == nullptr);
+    ASSERT_EQ("key", del->key());
+    ASSERT_EQ(24, parser.Frame("DELETED").size());
+    ASSERT_EQ(1, parser.Frame("NOT_FOUND")[7]);
+
+    parser.Reset();
+    input = BinaryRequest(0x18, std::string({0, 0, 0, 10}), "", "");
+    ASSERT_TRUE(parser.Parse(input, consumed));
+    Execute::FlushAll *flush = reinterpret_cast<Execute::FlushAll *>(parser.Build(value_size));
+    ASSERT_FALSE(flush == nullptr);
+    ASSERT_EQ(10, flush->delay());
+    ASSERT_EQ("", parser.Frame("OK"));
+}
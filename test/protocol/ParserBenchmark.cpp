@@ -0,0 +1,63 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <afina/execute/Command.h>
+
+#include <protocol/Parser.h>
+
+using namespace Afina;
+
+/**
+ * Measures throughput of the text protocol parser on pipelined get and set commands, values of set
+ * commands are skipped the same way network layer does
+ *
+ * Usage: runParserBenchmark [key size, default 16] [commands, default 1M] [rounds, default 10]
+ */
+int main(int argc, char **argv) {
+    size_t key_size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 16;
+    size_t commands = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+    size_t rounds = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10;
+
+    std::string input;
+    std::string value(32, 'v');
+    for (size_t i = 0; i < commands; i++) {
+        std::string key = std::to_string(i);
+        key.insert(0, key_size > key.size() ? key_size - key.size() : 0, 'k');
+        if (i % 4 == 0) {
+            input += "set " + key + " 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+        } else {
+            input += "get " + key + " " + key + "\r\n";
+        }
+    }
+
+    Protocol::Parser parser;
+    size_t built = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; round++) {
+        size_t pos = 0;
+        while (pos < input.size()) {
+            size_t parsed = 0;
+            if (!parser.Parse(input.data() + pos, input.size() - pos, parsed)) {
+                std::cerr << "Incomplete command at " << pos << std::endl;
+                return 1;
+            }
+            pos += parsed;
+
+            uint32_t body_size = 0;
+            parser.Build(body_size);
+            if (body_size > 0) {
+                pos += body_size + 2;
+            }
+            parser.Reset();
+            built++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double bytes = double(input.size()) * rounds;
+    std::cout << "key size " << key_size << ": " << built << " commands, " << bytes / seconds / (1 << 20) << " MB/s, "
+              << built / seconds / 1e6 << "M commands/s" << std::endl;
+    return 0;
+}
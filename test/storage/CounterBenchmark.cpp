@@ -0,0 +1,62 @@
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <storage/MapBasedStripedLockImpl.h>
+
+using namespace Afina::Backend;
+
+/**
+ * Measures how fast many threads increment the same counter: native storage counter, counter
+ * parsed and formatted through Update, and get + set made by the client which loses increments
+ *
+ * Usage: runCounterBenchmark [threads, default 8] [increments per thread, default 1M]
+ */
+int main(int argc, char **argv) {
+    unsigned threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8;
+    size_t increments = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000000;
+
+    auto run = [threads, increments](const char *name, const std::function<void(Afina::Storage &)> &increment) {
+        MapBasedStripedLockImpl storage;
+        storage.Put("counter", "0");
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threads; i++) {
+            workers.emplace_back([&storage, &increment, increments]() {
+                for (size_t j = 0; j < increments; j++) {
+                    increment(storage);
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)
+                      .count();
+
+        std::string value;
+        storage.Get("counter", value);
+        std::cout << name << ": " << ms << "ms, " << (ms > 0 ? threads * increments / ms * 1000 : 0)
+                  << " ops/s, counter " << value << " of " << threads * increments << std::endl;
+    };
+
+    run("native", [](Afina::Storage &storage) {
+        uint64_t value;
+        storage.Increment("counter", 1, value);
+    });
+    run("update", [](Afina::Storage &storage) {
+        uint64_t value;
+        storage.Afina::Storage::Increment("counter", 1, value);
+    });
+    run("get+set", [](Afina::Storage &storage) {
+        std::string value;
+        storage.Get("counter", value);
+        storage.Set("counter", std::to_string(std::stoull(value) + 1));
+    });
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include "gtest/gtest.h"
+#include <ctime>
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <storage/Journal.h>
+#include <storage/MapBasedGlobalLockImpl.h>
+#include <storage/SnapshotStorage.h>
+
+using namespace Afina::Backend;
+
+class JournalTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char name[] = "/tmp/afina-journal-XXXXXX";
+        int fd = mkstemp(name);
+        ASSERT_NE(fd, -1);
+        close(fd);
+        path = name;
+        unlink(path.c_str());
+    }
+
+    void TearDown() override {
+        unlink(path.c_str());
+        unlink((path + ".old").c_str());
+        unlink((path + ".snapshot").c_str());
+    }
+
+    std::string path;
+};
+
+TEST_F(JournalTest, Replay) {
+    {
+        Journal journal(path, 10, 2);
+        journal.Start();
+        journal.Put("KEY1", "val1");
+        journal.Put("KEY2", "val2");
+        journal.Put("KEY1", "val3");
+        journal.Delete("KEY2");
+        journal.Stop();
+    }
+
+    MapBasedGlobalLockImpl storage;
+    EXPECT_EQ(Journal::Replay(storage, path), 4);
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(value, "val3");
+    EXPECT_FALSE(storage.Get("KEY2", value));
+}
+
+TEST_F(JournalTest, Flush) {
+    {
+        Journal journal(path, 10, 0);
+        journal.Start();
+        journal.Put("KEY1", "val1");
+        journal.Flush(0);
+        journal.Put("KEY2", "val2");
+        journal.Stop();
+    }
+
+    MapBasedGlobalLockImpl storage;
+    storage.Put("KEY3", "val3");
+    EXPECT_EQ(Journal::Replay(storage, path), 3);
+
+    std::string value;
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_TRUE(storage.Get("KEY2", value));
+    EXPECT_FALSE(storage.Get("KEY3", value));
+}
+
+TEST_F(JournalTest, DelayedFlush) {
+    {
+        Journal journal(path, 10, 0);
+        journal.Start();
+        journal.Put("KEY1", "val1");
+        journal.Flush(uint32_t(time(nullptr)) + 1);
+        journal.Put("KEY2", "val2");
+
+        // Flush has taken effect, the next change goes after it
+        sleep(2);
+        journal.Put("KEY3", "val3");
+
+        // Pending at stop, delayed on replay as well
+        journal.Flush(uint32_t(time(nullptr)) + 100);
+        journal.Stop();
+    }
+
+    MapBasedGlobalLockImpl storage;
+    EXPECT_EQ(Journal::Replay(storage, path), 5);
+
+    std::string value;
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Get("KEY2", value));
+    EXPECT_TRUE(storage.Get("KEY3", value));
+}
+
+TEST_F(JournalTest, Expiration) {
+    uint32_t now = uint32_t(time(nullptr));
+    {
+        Journal journal(path, 10, 0);
+        journal.Start();
+        journal.Put("KEY1", "val1", now + 100);
+        journal.Put("KEY2", "val2");
+        journal.Touch("KEY2", now + 200);
+        journal.Put("KEY3", "val3", now - 1);
+        journal.Touch("KEY4", now - 1);
+        journal.Stop();
+    }
+
+    // Changes whose time has passed remove older values
+    MapBasedGlobalLockImpl storage;
+    storage.Put("KEY3", "old3");
+    storage.Put("KEY4", "old4");
+    EXPECT_EQ(Journal::Replay(storage, path), 5);
+
+    Afina::Storage::Info info;
+    EXPECT_TRUE(storage.Inspect("KEY1", info));
+    EXPECT_EQ(info.expire, now + 100);
+    EXPECT_TRUE(storage.Inspect("KEY2", info));
+    EXPECT_EQ(info.expire, now + 200);
+    EXPECT_FALSE(storage.Inspect("KEY3", info));
+    EXPECT_FALSE(storage.Inspect("KEY4", info));
+}
+
+TEST_F(JournalTest, TornRecord) {
+    {
+        Journal journal(path, 10, 0);
+        journal.Start();
+        journal.Put("KEY1", "val1");
+        journal.Put("KEY2", "val2");
+        journal.Stop();
+    }
+
+    struct stat st;
+    ASSERT_EQ(stat(path.c_str(), &st), 0);
+    ASSERT_EQ(truncate(path.c_str(), st.st_size - 1), 0);
+
+    // Torn record is cut off, so that new ones are readable
+    {
+        Journal journal(path, 10, 0);
+        journal.Start();
+        journal.Put("KEY3", "val3");
+        journal.Stop();
+    }
+
+    MapBasedGlobalLockImpl storage;
+    EXPECT_EQ(Journal::Replay(storage, path), 2);
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Get("KEY2", value));
+    EXPECT_TRUE(storage.Get("KEY3", value));
+}
+
+TEST_F(JournalTest, CompactedBySnapshot) {
+    std::string snapshot = path + ".snapshot";
+    {
+        SnapshotStorage storage(std::make_shared<MapBasedGlobalLockImpl>(1024 * 1024), snapshot);
+        storage.EnableJournal(path, 10, 100, "durable:");
+        storage.Start();
+
+        storage.Put("durable:1", "val1");
+        storage.Put("volatile:1", "val1");
+        EXPECT_TRUE(storage.Snapshot());
+
+        storage.Put("durable:2", "val2");
+        storage.Delete("durable:1");
+        storage.Stop();
+    }
+
+    // Rotated journal is dropped once snapshot is written
+    EXPECT_NE(access((path + ".old").c_str(), F_OK), 0);
+
+    SnapshotStorage storage(std::make_shared<MapBasedGlobalLockImpl>(1024 * 1024), snapshot);
+    storage.EnableJournal(path, 10, 100, "durable:");
+    storage.Start();
+    EXPECT_EQ(storage.Load(2), 4);
+
+    std::string value;
+    EXPECT_FALSE(storage.Get("durable:1", value));
+    EXPECT_TRUE(storage.Get("durable:2", value));
+    EXPECT_EQ(value, "val2");
+    EXPECT_TRUE(storage.Get("volatile:1", value));
+    storage.Stop();
+}
+
+TEST_F(JournalTest, DurableExpiration) {
+    uint32_t now = uint32_t(time(nullptr));
+    std::string snapshot = path + ".snapshot";
+    {
+        SnapshotStorage storage(std::make_shared<MapBasedGlobalLockImpl>(1024 * 1024), snapshot);
+        storage.EnableJournal(path, 10, 100, "durable:");
+        storage.Start();
+
+        storage.Put("durable:1", "val1", now + 100);
+        storage.Put("durable:2", "val2", now + 100);
+        EXPECT_TRUE(storage.Touch("durable:2", now + 200));
+        EXPECT_TRUE(storage.Append("durable:1", "+"));
+        storage.Stop();
+    }
+
+    SnapshotStorage storage(std::make_shared<MapBasedGlobalLockImpl>(1024 * 1024), snapshot);
+    storage.EnableJournal(path, 10, 100, "durable:");
+    storage.Start();
+    storage.Load(1);
+
+    // Append keeps expiration time
+    Afina::Storage::Info info;
+    std::string value;
+    EXPECT_TRUE(storage.Inspect("durable:1", info, &value));
+    EXPECT_EQ(info.expire, now + 100);
+    EXPECT_EQ(value, "val1+");
+    EXPECT_TRUE(storage.Inspect("durable:2", info));
+    EXPECT_EQ(info.expire, now + 200);
+    storage.Stop();
+}
@@ -0,0 +1,394 @@
+#include "gtest/gtest.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <storage/SharedMemoryImpl.h>
+
+using namespace Afina::Backend;
+
+class SharedMemoryTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char name[] = "/tmp/afina-shm-XXXXXX";
+        int fd = mkstemp(name);
+        ASSERT_NE(fd, -1);
+        close(fd);
+        path = name;
+    }
+
+    void TearDown() override { unlink(path.c_str()); }
+
+    std::string path;
+};
+
+TEST_F(SharedMemoryTest, PutGet) {
+    SharedMemoryImpl storage(path, 1024 * 1024);
+    storage.Start();
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Put("KEY2", "val2"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(value, "val1");
+    EXPECT_TRUE(storage.Get("KEY2", value));
+    EXPECT_EQ(value, "val2");
+    EXPECT_FALSE(storage.Get("KEY3", value));
+}
+
+TEST_F(SharedMemoryTest, Update) {
+    SharedMemoryImpl storage(path, 1024 * 1024);
+    storage.Start();
+
+    EXPECT_FALSE(storage.Set("KEY1", "val1"));
+    EXPECT_TRUE(storage.PutIfAbsent("KEY1", "val1"));
+    EXPECT_FALSE(storage.PutIfAbsent("KEY1", "val2"));
+    EXPECT_TRUE(storage.Set("KEY1", std::string(1000, 'x')));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(value, std::string(1000, 'x'));
+
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Delete("KEY1"));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_EQ(storage.Size(), 0);
+}
+
+TEST_F(SharedMemoryTest, ReadModifyWrite) {
+    SharedMemoryImpl storage(path, 1024 * 1024);
+    storage.Start();
+
+    auto append = [](std::string &value) {
+        value.append(1000, 'y');
+        return true;
+    };
+    EXPECT_FALSE(storage.Update("KEY1", append));
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    EXPECT_TRUE(storage.Update("KEY1", [](std::string &value) {
+        value.append("-tail");
+        return true;
+    }));
+    EXPECT_FALSE(storage.Update("KEY1", [](std::string &value) { return false; }));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(value, "val1-tail");
+
+    // Doesn't fit the block anymore and moves to the bigger one
+    EXPECT_TRUE(storage.Update("KEY1", append));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(value, "val1-tail" + std::string(1000, 'y'));
+    EXPECT_EQ(storage.Size(), 1);
+}
+
+TEST_F(SharedMemoryTest, AppendPrepend) {
+    SharedMemoryImpl storage(path, 1024 * 1024);
+    storage.Start();
+
+    EXPECT_FALSE(storage.Append("KEY1", "a"));
+    EXPECT_TRUE(storage.Put("KEY1", "mid"));
+    EXPECT_TRUE(storage.Append("KEY1", "34"));
+    EXPECT_TRUE(storage.Prepend("KEY1", "12"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(value, "12mid34");
+
+    // Outgrows the block many times
+    std::string expected = value;
+    for (int i = 0; i < 1000; i++) {
+        std::string data = std::to_string(i);
+        if (i % 2 == 0) {
+            EXPECT_TRUE(storage.Append("KEY1", data));
+            expected.append(data);
+        } else {
+            EXPECT_TRUE(storage.Prepend("KEY1", data));
+            expected.insert(0, data);
+        }
+    }
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_EQ(value, expected);
+    EXPECT_EQ(storage.Size(), 1);
+}
+
+TEST_F(SharedMemoryTest, CompareAndSet) {
+    SharedMemoryImpl storage(path, 1024 * 1024);
+    storage.Start();
+
+    uint64_t version = 1;
+    EXPECT_FALSE(storage.CompareAndSet("KEY1", "val", version));
+    EXPECT_EQ(version, 0);
+
+    EXPECT_TRUE(storage.Put("KEY1", "val1"));
+    std::string value;
+    uint64_t read;
+    EXPECT_TRUE(storage.Get("KEY1", value, read));
+    EXPECT_NE(read, 0);
+
+    EXPECT_TRUE(storage.Append("KEY1", "-tail"));
+    version = read;
+    EXPECT_FALSE(storage.CompareAndSet("KEY1", "val2", version));
+    EXPECT_GT(version, read);
+
+    // Doesn't fit the block, so item moves
+    EXPECT_TRUE(storage.CompareAndSet("KEY1", std::string(1000, 'x'), version));
+    EXPECT_TRUE(storage.Get("KEY1", value, read));
+    EXPECT_EQ(value, std::string(1000, 'x'));
+    EXPECT_EQ(read, version);
+
+    // Store reports version of the new value
+    uint64_t stored = 0;
+    EXPECT_TRUE(storage.Put("KEY2", "val", 0, &stored));
+    EXPECT_TRUE(storage.Get("KEY2", value, read));
+    EXPECT_EQ(stored, read);
+    EXPECT_TRUE(storage.Set("KEY2", std::string(2000, 'y'), 0, &stored));
+    EXPECT_TRUE(storage.Get("KEY2", value, read));
+    EXPECT_EQ(stored, read);
+}
+
+TEST_F(SharedMemoryTest, Expiration) {
+    SharedMemoryImpl storage(path, 1024 * 1024);
+    storage.Start();
+
+    std::string value;
+    uint64_t version;
+    EXPECT_TRUE(storage.Put("KEY1", "val1", 1));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_EQ(storage.Size(), 0);
+    EXPECT_TRUE(storage.PutIfAbsent("KEY1", "val2"));
+
+    // Expiration time survives relocation of the item
+    EXPECT_TRUE(storage.Put("KEY2", "val2", UINT32_MAX));
+    EXPECT_TRUE(storage.Append("KEY2", std::string(1000, 'x')));
+    EXPECT_TRUE(storage.GetAndTouch("KEY2", 1, value, version));
+    EXPECT_EQ(value, "val2" + std::string(1000, 'x'));
+    EXPECT_FALSE(storage.Touch("KEY2", 0));
+    EXPECT_EQ(storage.Size(), 1);
+
+    int visited = 0;
+    EXPECT_TRUE(storage.Put("KEY3", "val3", 1));
+    storage.ForEach([&visited](const std::string &key, const std::string &value, uint32_t expire) { visited++; });
+    EXPECT_EQ(visited, 1);
+}
+
+TEST_F(SharedMemoryTest, Flush) {
+    {
+        SharedMemoryImpl storage(path, 1024 * 1024);
+        storage.Start();
+        EXPECT_TRUE(storage.Put("KEY1", "val1"));
+        storage.Flush(UINT32_MAX);
+        EXPECT_TRUE(storage.Put("KEY2", "val2"));
+        storage.Flush();
+        EXPECT_TRUE(storage.Put("KEY3", "val3"));
+        storage.Stop();
+    }
+
+    // Flush is kept in the segment
+    SharedMemoryImpl storage(path, 1024 * 1024);
+    storage.Start();
+    std::string value;
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Get("KEY2", value));
+    EXPECT_TRUE(storage.Get("KEY3", value));
+    EXPECT_EQ(storage.Size(), 1);
+
+    int visited = 0;
+    storage.ForEach([&visited](const std::string &key, const std::string &value, uint32_t expire) { visited++; });
+    EXPECT_EQ(visited, 1);
+}
+
+TEST_F(SharedMemoryTest, Inspect) {
+    SharedMemoryImpl storage(path, 1024 * 1024);
+    storage.Start();
+
+    Afina::Storage::Info info;
+    std::string value;
+    EXPECT_FALSE(storage.Inspect("KEY1", info));
+    EXPECT_TRUE(storage.Put("KEY1", "val1", UINT32_MAX));
+    EXPECT_TRUE(storage.Inspect("KEY1", info));
+    EXPECT_EQ(info.size, 4);
+    EXPECT_EQ(info.expire, UINT32_MAX);
+    EXPECT_FALSE(info.fetched);
+
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_TRUE(storage.Inspect("KEY1", info, &value));
+    EXPECT_TRUE(info.fetched);
+    EXPECT_TRUE(value == "val1");
+
+    EXPECT_TRUE(storage.Append("KEY1", "-tail"));
+    EXPECT_TRUE(storage.Inspect("KEY1", info));
+    EXPECT_FALSE(info.fetched);
+    EXPECT_EQ(info.size, 9);
+    storage.Stop();
+}
+
+TEST_F(SharedMemoryTest, MultiGet) {
+    SharedMemoryImpl storage(path, 1024 * 1024);
+    storage.Start();
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < 20; i++) {
+        keys.push_back("KEY" + std::to_string(i));
+        if (i % 3 != 0) {
+            EXPECT_TRUE(storage.Put(keys.back(), "val" + std::to_string(i)));
+        }
+    }
+    EXPECT_TRUE(storage.Put("KEY3", "val3", 1));
+
+    std::vector<std::string> values(keys.size());
+    auto receiver = [&values](size_t index, const char *value, size_t size, uint64_t version) {
+        values[index].assign(value, size);
+    };
+    storage.MultiGet(keys.data(), keys.size(), receiver);
+    for (size_t i = 0; i < keys.size(); i++) {
+        EXPECT_TRUE(values[i] == (i % 3 != 0 ? "val" + std::to_string(i) : "")) << keys[i];
+    }
+
+    // Single key
+    values.assign(keys.size(), "");
+    storage.MultiGet(&keys[1], 1, receiver);
+    EXPECT_EQ(values[0], "val1");
+    storage.Stop();
+}
+
+TEST_F(SharedMemoryTest, SurvivesRestart) {
+    {
+        SharedMemoryImpl storage(path, 1024 * 1024);
+        storage.Start();
+        for (int i = 0; i < 1000; i++) {
+            EXPECT_TRUE(storage.Put("Key " + std::to_string(i), "Val " + std::to_string(i)));
+        }
+        storage.Stop();
+    }
+
+    // Size of the existing segment wins
+    SharedMemoryImpl storage(path, 4 * 1024 * 1024);
+    storage.Start();
+    EXPECT_EQ(storage.Size(), 1000);
+    for (int i = 0; i < 1000; i++) {
+        std::string value;
+        EXPECT_TRUE(storage.Get("Key " + std::to_string(i), value));
+        EXPECT_EQ(value, "Val " + std::to_string(i));
+    }
+}
+
+TEST_F(SharedMemoryTest, SharedBetweenInstances) {
+    SharedMemoryImpl first(path, 1024 * 1024);
+    SharedMemoryImpl second(path, 1024 * 1024);
+    first.Start();
+    second.Start();
+
+    EXPECT_TRUE(first.Put("KEY1", "val1"));
+
+    std::string value;
+    EXPECT_TRUE(second.Get("KEY1", value));
+    EXPECT_EQ(value, "val1");
+}
+
+TEST_F(SharedMemoryTest, ForEachWhileWriting) {
+    SharedMemoryImpl storage(path, 1024 * 1024);
+    SharedMemoryImpl writer(path, 1024 * 1024);
+    storage.Start();
+    writer.Start();
+
+    // Every value is made of the same letter, so value copied half way through change is seen
+    for (int i = 0; i < 500; i++) {
+        EXPECT_TRUE(storage.Put("Key " + std::to_string(i), std::string(1000, 'a')));
+    }
+
+    std::atomic<bool> stop(false);
+    std::thread changes([&writer, &stop]() {
+        for (int round = 0; !stop; round++) {
+            std::string key = "Key " + std::to_string(round % 500);
+            writer.Put(key, std::string(1000 + round % 900, 'a' + round % 26));
+            if (round % 7 == 0) {
+                writer.Append(key, std::string(round % 50, 'a' + round % 26));
+            } else if (round % 11 == 0) {
+                writer.Delete(key);
+            }
+        }
+    });
+
+    size_t torn = 0, visited = 0;
+    for (int pass = 0; pass < 200; pass++) {
+        storage.ForEach([&torn, &visited](const std::string &key, const std::string &value, uint32_t expire) {
+            visited++;
+            if (value.empty() || value.find_first_not_of(value[0]) != std::string::npos) {
+                torn++;
+            }
+        });
+    }
+    stop = true;
+    changes.join();
+
+    EXPECT_GT(visited, 0);
+    EXPECT_EQ(torn, 0);
+}
+
+TEST_F(SharedMemoryTest, EvictsLeastRecentlyUsed) {
+    SharedMemoryImpl storage(path, 1024 * 1024);
+    storage.Start();
+
+    // Each item takes 1KB block, so not all of them fit
+    const std::string val(900, 'v');
+    for (int i = 0; i < 2000; i++) {
+        std::string key = "Key " + std::to_string(i);
+        EXPECT_TRUE(storage.Put(key, val));
+
+        // Keep first key hot
+        std::string value;
+        EXPECT_TRUE(storage.Get("Key 0", value));
+    }
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("Key 0", value));
+    EXPECT_FALSE(storage.Get("Key 1", value));
+    EXPECT_TRUE(storage.Get("Key 1999", value));
+    EXPECT_LT(storage.Size(), 1024);
+
+    // Mixed sizes reuse evicted blocks
+    for (int i = 0; i < 2000; i++) {
+        EXPECT_TRUE(storage.Put("Big " + std::to_string(i), std::string(100 + (i * 37) % 8000, 'b')));
+    }
+    EXPECT_TRUE(storage.Get("Big 1999", value));
+    EXPECT_EQ(value.size(), 100 + (1999 * 37) % 8000);
+
+    // Never fits
+    EXPECT_FALSE(storage.Put("Huge", std::string(2 * 1024 * 1024, 'h')));
+}
+
+TEST_F(SharedMemoryTest, BigValueKeepsSmallOnes) {
+    SharedMemoryImpl storage(path, 1024 * 1024);
+    storage.Start();
+
+    // Fill the segment up with small items, the oldest ones are evicted
+    for (int i = 0; i < 5000; i++) {
+        EXPECT_TRUE(storage.Put("Key " + std::to_string(i), std::string(100, 'v')));
+    }
+    size_t small = storage.Size();
+    EXPECT_GT(small, 3000);
+
+    // Big value takes room of the least recently used items only, freed blocks are merged for it
+    EXPECT_TRUE(storage.Put("Big", std::string(60 * 1024, 'b')));
+    EXPECT_GT(storage.Size(), small - small / 4);
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("Big", value));
+    EXPECT_EQ(value.size(), 60 * 1024);
+    for (int i = 4900; i < 5000; i++) {
+        EXPECT_TRUE(storage.Get("Key " + std::to_string(i), value)) << i;
+    }
+
+    // Once big value is gone small ones take its room again
+    EXPECT_TRUE(storage.Delete("Big"));
+    for (int i = 5000; i < 5300; i++) {
+        EXPECT_TRUE(storage.Put("Key " + std::to_string(i), std::string(100, 'v')));
+    }
+    EXPECT_GT(storage.Size(), small - small / 4);
+}
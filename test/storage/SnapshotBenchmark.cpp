@@ -0,0 +1,63 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#include <storage/MapBasedStripedLockImpl.h>
+#include <storage/SnapshotStorage.h>
+
+using namespace Afina::Backend;
+
+/**
+ * Measures how long it takes to write snapshot of the sharded storage and load it back with
+ * different number of threads
+ *
+ * Usage: runSnapshotBenchmark [items, default 10M] [value size, default 32] [file, default /tmp/afina.bench]
+ */
+int main(int argc, char **argv) {
+    size_t items = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    size_t value_size = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 32;
+    std::string path = argc > 3 ? argv[3] : "/tmp/afina.bench";
+
+    // Storage limit counts only keys and values, leave room so nothing gets evicted
+    size_t max_size = items * (value_size + 32) * 2;
+
+    auto elapsed = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)
+            .count();
+    };
+
+    {
+        MapBasedStripedLockImpl storage(max_size);
+        auto start = std::chrono::steady_clock::now();
+        std::string value(value_size, 'v');
+        for (size_t i = 0; i < items; i++) {
+            storage.Put("key:" + std::to_string(i), value);
+        }
+        std::cout << "fill " << items << " items: " << elapsed(start) << "ms" << std::endl;
+
+        start = std::chrono::steady_clock::now();
+        SnapshotStorage::Write(storage, path);
+        std::cout << "write: " << elapsed(start) << "ms" << std::endl;
+    }
+
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1;; threads = std::min(threads * 2, max_threads)) {
+        MapBasedStripedLockImpl storage(max_size);
+        auto start = std::chrono::steady_clock::now();
+        size_t loaded = SnapshotStorage::Load(storage, path, threads);
+        std::cout << "load " << loaded << " items with " << threads << " threads: " << elapsed(start) << "ms"
+                  << std::endl;
+
+        if (threads == max_threads) {
+            break;
+        }
+    }
+
+    unlink(path.c_str());
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "gtest/gtest.h"
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <storage/MapBasedGlobalLockImpl.h>
+#include <storage/MapBasedStripedLockImpl.h>
+#include <storage/SharedMemoryImpl.h>
+#include <storage/SnapshotStorage.h>
+
+using namespace Afina::Backend;
+
+class SnapshotTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char name[] = "/tmp/afina-snapshot-XXXXXX";
+        int fd = mkstemp(name);
+        ASSERT_NE(fd, -1);
+        close(fd);
+        path = name;
+    }
+
+    void TearDown() override { unlink(path.c_str()); }
+
+    std::string path;
+};
+
+TEST_F(SnapshotTest, ForEachFromLeastRecentlyUsed) {
+    MapBasedGlobalLockImpl storage;
+    storage.Put("KEY1", "val1");
+    storage.Put("KEY2", "val2");
+    storage.Put("KEY3", "val3");
+
+    std::string value;
+    storage.Get("KEY1", value);
+    storage.Delete("KEY2");
+
+    std::vector<std::string> keys;
+    storage.ForEach([&keys](const std::string &key, const std::string &value, uint32_t expire) { keys.push_back(key); });
+    EXPECT_EQ(keys, std::vector<std::string>({"KEY3", "KEY1"}));
+}
+
+TEST_F(SnapshotTest, WriteLoad) {
+    MapBasedGlobalLockImpl source(1024 * 1024);
+    for (int i = 0; i < 1000; i++) {
+        source.Put("Key " + std::to_string(i), std::string(i % 100, 'v'));
+    }
+    SnapshotStorage::Write(source, path);
+
+    for (unsigned threads : {1, 4}) {
+        MapBasedGlobalLockImpl target(1024 * 1024);
+        EXPECT_EQ(SnapshotStorage::Load(target, path, threads), 1000);
+
+        for (int i = 0; i < 1000; i++) {
+            std::string value;
+            EXPECT_TRUE(target.Get("Key " + std::to_string(i), value));
+            EXPECT_EQ(value, std::string(i % 100, 'v'));
+        }
+    }
+}
+
+TEST_F(SnapshotTest, Expiration) {
+    uint32_t now = uint32_t(time(nullptr));
+    MapBasedGlobalLockImpl source(1024 * 1024);
+    source.Put("KEY1", "val1", now + 1);
+    source.Put("KEY2", "val2", now + 100);
+    source.Put("KEY3", "val3");
+    SnapshotStorage::Write(source, path);
+
+    // Key expired while server was down isn't loaded
+    sleep(2);
+    MapBasedGlobalLockImpl target(1024 * 1024);
+    EXPECT_EQ(SnapshotStorage::Load(target, path, 1), 2);
+
+    Afina::Storage::Info info;
+    EXPECT_FALSE(target.Inspect("KEY1", info));
+    EXPECT_TRUE(target.Inspect("KEY2", info));
+    EXPECT_EQ(info.expire, now + 100);
+    EXPECT_TRUE(target.Inspect("KEY3", info));
+    EXPECT_EQ(info.expire, 0);
+}
+
+TEST_F(SnapshotTest, ParallelSections) {
+    MapBasedStripedLockImpl source(64 * 1024 * 1024);
+    for (int i = 0; i < 20000; i++) {
+        source.Put("Key " + std::to_string(i), std::string(100, 'a' + i % 26));
+    }
+    SnapshotStorage::Write(source, path);
+
+    MapBasedStripedLockImpl target(64 * 1024 * 1024);
+    EXPECT_EQ(SnapshotStorage::Load(target, path, 4), 20000);
+    for (int i = 0; i < 20000; i++) {
+        std::string value;
+        EXPECT_TRUE(target.Get("Key " + std::to_string(i), value));
+        EXPECT_EQ(value, std::string(100, 'a' + i % 26));
+    }
+}
+
+TEST_F(SnapshotTest, Corrupted) {
+    MapBasedGlobalLockImpl source(1024 * 1024);
+    for (int i = 0; i < 1000; i++) {
+        source.Put("Key " + std::to_string(i), "Val " + std::to_string(i));
+    }
+    SnapshotStorage::Write(source, path);
+
+    int fd = open(path.c_str(), O_WRONLY);
+    ASSERT_NE(fd, -1);
+    ASSERT_EQ(pwrite(fd, "X", 1, 100), 1);
+    close(fd);
+
+    MapBasedGlobalLockImpl target(1024 * 1024);
+    EXPECT_THROW(SnapshotStorage::Load(target, path, 2), std::runtime_error);
+}
+
+// Huge section count which wraps around to the real table size once multiplied by 8
+TEST_F(SnapshotTest, SectionCountOverflow) {
+    MapBasedGlobalLockImpl source;
+    source.Put("KEY1", "val1");
+    SnapshotStorage::Write(source, path);
+
+    int fd = open(path.c_str(), O_RDWR);
+    ASSERT_NE(fd, -1);
+    off_t end = lseek(fd, 0, SEEK_END);
+    // Trailer is table offset, section count, record count, crc and reserved fields, magic
+    off_t count_offset = end - 40 + 8;
+    uint64_t sections;
+    ASSERT_EQ(pread(fd, &sections, sizeof(sections), count_offset), sizeof(sections));
+    sections += uint64_t(1) << 61;
+    ASSERT_EQ(pwrite(fd, &sections, sizeof(sections), count_offset), sizeof(sections));
+    close(fd);
+
+    MapBasedGlobalLockImpl target;
+    EXPECT_THROW(SnapshotStorage::Load(target, path, 1), std::runtime_error);
+}
+
+TEST_F(SnapshotTest, Truncated) {
+    MapBasedGlobalLockImpl source;
+    source.Put("KEY1", "val1");
+    SnapshotStorage::Write(source, path);
+
+    ASSERT_EQ(truncate(path.c_str(), 20), 0);
+    MapBasedGlobalLockImpl target;
+    EXPECT_THROW(SnapshotStorage::Load(target, path, 1), std::runtime_error);
+}
+
+TEST_F(SnapshotTest, BackgroundSnapshot) {
+    for (int shm = 0; shm < 2; shm++) {
+        std::string segment = path + ".shm";
+        std::shared_ptr<Afina::Storage> backend;
+        if (shm) {
+            backend = std::make_shared<SharedMemoryImpl>(segment, 1024 * 1024);
+        } else {
+            backend = std::make_shared<MapBasedGlobalLockImpl>(1024 * 1024);
+        }
+
+        SnapshotStorage storage(backend, path);
+        storage.Start();
+        for (int i = 0; i < 100; i++) {
+            storage.Put("Key " + std::to_string(i), "Val " + std::to_string(i));
+        }
+        EXPECT_TRUE(storage.Snapshot());
+
+        // Heap storage is copied at fork, so changes made after it don't get into the snapshot.
+        // Shared segment is copied by the child a bit later
+        storage.Put("Late", "val");
+        storage.Stop();
+        unlink(segment.c_str());
+
+        MapBasedGlobalLockImpl target(1024 * 1024);
+        size_t loaded = SnapshotStorage::Load(target, path, 2);
+        if (shm) {
+            EXPECT_TRUE(loaded == 100 || loaded == 101);
+        } else {
+            EXPECT_EQ(loaded, 100);
+        }
+
+        std::string value;
+        EXPECT_TRUE(target.Get("Key 42", value));
+        EXPECT_EQ(value, "Val 42");
+    }
+}
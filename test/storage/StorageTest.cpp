@@ -1,10 +1,13 @@
 #include "gtest/gtest.h"
+#include <ctime>
 #include <iostream>
 #include <set>
 #include <vector>
 #include <iomanip>
+#include <unistd.h>
 
 #include <storage/MapBasedGlobalLockImpl.h>
+#include <storage/MapBasedStripedLockImpl.h>
 #include <afina/execute/Get.h>
 #include <afina/execute/Set.h>
 #include <afina/execute/Add.h>
@@ -115,3 +118,298 @@ TEST(StorageTest, MaxTest) {
         EXPECT_FALSE(storage.Get(key, res));
     }
 }
+
+TEST(StorageTest, Update) {
+    MapBasedGlobalLockImpl storage(100);
+
+    auto append = [](std::string &value) {
+        value.append("-tail");
+        return true;
+    };
+    EXPECT_FALSE(storage.Update("KEY1", append));
+
+    storage.Put("KEY1", "val1");
+    storage.Put("KEY2", "val2");
+    EXPECT_TRUE(storage.Update("KEY1", append));
+    EXPECT_FALSE(storage.Update("KEY1", [](std::string &value) { return false; }));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_TRUE(value == "val1-tail");
+
+    // Grown value evicts the least recently used key
+    EXPECT_TRUE(storage.Update("KEY1", [](std::string &value) {
+        value.assign(90, 'x');
+        return true;
+    }));
+    EXPECT_FALSE(storage.Get("KEY2", value));
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_TRUE(value == std::string(90, 'x'));
+
+    // Value which never fits removes the key
+    EXPECT_FALSE(storage.Update("KEY1", [](std::string &value) {
+        value.assign(200, 'x');
+        return true;
+    }));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_TRUE(storage.Put("KEY3", std::string(90, 'y')));
+}
+
+TEST(StorageTest, AppendPrepend) {
+    MapBasedGlobalLockImpl storage(100);
+
+    EXPECT_FALSE(storage.Append("KEY1", "a"));
+    EXPECT_FALSE(storage.Prepend("KEY1", "a"));
+
+    storage.Put("KEY1", "mid");
+    EXPECT_TRUE(storage.Prepend("KEY1", "12"));
+    EXPECT_TRUE(storage.Append("KEY1", "34"));
+    EXPECT_TRUE(storage.Prepend("KEY1", "ab"));
+
+    std::string value;
+    EXPECT_TRUE(storage.Get("KEY1", value));
+    EXPECT_TRUE(value == "ab12mid34");
+
+    // Prepended data counts against the limit before it is merged into the value
+    storage.Put("KEY2", "val2");
+    EXPECT_TRUE(storage.Prepend("KEY1", std::string(80, 'x')));
+    EXPECT_FALSE(storage.Get("KEY2", value));
+    EXPECT_FALSE(storage.Prepend("KEY1", std::string(10, 'x')));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_TRUE(storage.Put("KEY3", std::string(90, 'y')));
+}
+
+TEST(StorageTest, CompareAndSet) {
+    MapBasedGlobalLockImpl storage;
+
+    uint64_t version = 1;
+    EXPECT_FALSE(storage.CompareAndSet("KEY1", "val", version));
+    EXPECT_EQ(version, 0);
+
+    storage.Put("KEY1", "val1");
+    std::string value;
+    uint64_t read;
+    EXPECT_TRUE(storage.Get("KEY1", value, read));
+    EXPECT_TRUE(value == "val1");
+    EXPECT_NE(read, 0);
+
+    // Somebody else changed the value in between
+    EXPECT_TRUE(storage.Append("KEY1", "-tail"));
+    version = read;
+    EXPECT_FALSE(storage.CompareAndSet("KEY1", "val2", version));
+    EXPECT_GT(version, read);
+
+    EXPECT_TRUE(storage.CompareAndSet("KEY1", "val2", version));
+    EXPECT_TRUE(storage.Get("KEY1", value, read));
+    EXPECT_TRUE(value == "val2");
+    EXPECT_EQ(read, version);
+
+    // Deleted and stored again key never gets the old version back
+    EXPECT_TRUE(storage.Delete("KEY1"));
+    storage.Put("KEY1", "val2");
+    EXPECT_FALSE(storage.CompareAndSet("KEY1", "val3", version));
+    EXPECT_GT(version, read);
+
+    // Store reports version of the new value
+    uint64_t stored = 0;
+    EXPECT_TRUE(storage.Put("KEY1", "val4", 0, &stored));
+    EXPECT_TRUE(storage.Get("KEY1", value, read));
+    EXPECT_EQ(stored, read);
+    EXPECT_TRUE(storage.Set("KEY1", "val5", 0, &stored));
+    EXPECT_GT(stored, read);
+    EXPECT_TRUE(storage.PutIfAbsent("KEY2", "val", 0, &stored));
+    EXPECT_TRUE(storage.Get("KEY2", value, read));
+    EXPECT_EQ(stored, read);
+}
+
+TEST(StorageTest, Counter) {
+    MapBasedGlobalLockImpl storage;
+
+    uint64_t value;
+    EXPECT_FALSE(storage.Increment("KEY1", 1, value));
+
+    storage.Put("KEY1", "41");
+    EXPECT_TRUE(storage.Increment("KEY1", 1, value));
+    EXPECT_EQ(value, 42);
+    EXPECT_TRUE(storage.Decrement("KEY1", 50, value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(storage.Increment("KEY1", UINT64_MAX, value));
+    EXPECT_TRUE(storage.Increment("KEY1", 2, value));
+    EXPECT_EQ(value, 1);
+
+    // Counter kept as a number reads as a string and could be changed as a string
+    std::string text;
+    EXPECT_TRUE(storage.Increment("KEY1", 99, value));
+    EXPECT_TRUE(storage.Get("KEY1", text));
+    EXPECT_TRUE(text == "100");
+    EXPECT_TRUE(storage.Increment("KEY1", 1, value));
+    EXPECT_TRUE(storage.Append("KEY1", "0"));
+    EXPECT_TRUE(storage.Prepend("KEY1", "1"));
+    EXPECT_TRUE(storage.Increment("KEY1", 1, value));
+    EXPECT_EQ(value, 11011);
+
+    storage.Put("KEY2", "abc");
+    EXPECT_THROW(storage.Increment("KEY2", 1, value), std::runtime_error);
+    storage.Put("KEY2", "18446744073709551616");
+    EXPECT_THROW(storage.Decrement("KEY2", 1, value), std::runtime_error);
+    EXPECT_TRUE(storage.Get("KEY2", text));
+    EXPECT_TRUE(text == "18446744073709551616");
+}
+
+TEST(StorageTest, Expiration) {
+    MapBasedGlobalLockImpl storage;
+
+    // Deadline in the past, so item is expired right away
+    std::string value;
+    uint64_t version;
+    EXPECT_TRUE(storage.Put("KEY1", "val1", 1));
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Touch("KEY1", 0));
+    EXPECT_TRUE(storage.PutIfAbsent("KEY1", "val2", 1));
+    EXPECT_FALSE(storage.Set("KEY1", "val3"));
+
+    EXPECT_TRUE(storage.Put("KEY2", "val2", UINT32_MAX));
+    EXPECT_TRUE(storage.Get("KEY2", value, version));
+    EXPECT_TRUE(storage.Append("KEY2", "-tail"));
+
+    // Touch keeps both value and version
+    uint64_t touched;
+    EXPECT_TRUE(storage.GetAndTouch("KEY2", UINT32_MAX, value, touched));
+    EXPECT_TRUE(value == "val2-tail");
+    EXPECT_GT(touched, version);
+    EXPECT_TRUE(storage.Touch("KEY2", 0));
+    EXPECT_TRUE(storage.Get("KEY2", value, version));
+    EXPECT_EQ(version, touched);
+
+    EXPECT_TRUE(storage.Touch("KEY2", 1));
+    EXPECT_FALSE(storage.GetAndTouch("KEY2", 0, value, version));
+    EXPECT_FALSE(storage.Delete("KEY2"));
+
+    // Expired items are freed once looked up, so they don't take room of the live ones
+    MapBasedGlobalLockImpl small(10);
+    EXPECT_TRUE(small.Put("KEY3", "val3", 1));
+    EXPECT_FALSE(small.Get("KEY3", value));
+    EXPECT_TRUE(small.Put("KEY4", "val4"));
+    EXPECT_TRUE(small.Put("KEY3", "val3"));
+    EXPECT_FALSE(small.Get("KEY4", value));
+
+    int visited = 0;
+    storage.Put("KEY5", "val5", 1);
+    storage.ForEach([&visited](const std::string &key, const std::string &value, uint32_t expire) { visited++; });
+    EXPECT_EQ(visited, 0);
+}
+
+TEST(StorageTest, Flush) {
+    MapBasedGlobalLockImpl storage;
+
+    std::string value;
+    storage.Put("KEY1", "val1");
+    storage.Put("KEY2", "val2");
+
+    // Delayed flush keeps items until its time comes
+    storage.Flush(UINT32_MAX);
+    EXPECT_TRUE(storage.Get("KEY1", value));
+
+    storage.Flush();
+    EXPECT_FALSE(storage.Get("KEY1", value));
+    EXPECT_FALSE(storage.Delete("KEY2"));
+    EXPECT_TRUE(storage.PutIfAbsent("KEY2", "val3"));
+    EXPECT_TRUE(storage.Get("KEY2", value));
+    EXPECT_TRUE(value == "val3");
+
+    // Time in the past flushes right away
+    storage.Flush(1);
+    int visited = 0;
+    storage.ForEach([&visited](const std::string &key, const std::string &value, uint32_t expire) { visited++; });
+    EXPECT_EQ(visited, 0);
+}
+
+// Key first inserted once the delayed flush is due is newer than the flush and must survive it
+TEST(StorageTest, WriteAfterDelayedFlush) {
+    MapBasedGlobalLockImpl global;
+    MapBasedStripedLockImpl striped(1024 * 1024, 1);
+
+    for (Afina::Storage *storage : std::vector<Afina::Storage *>{&global, &striped}) {
+        std::string value;
+        EXPECT_TRUE(storage->Put("old", "val1"));
+        storage->Flush(std::time(nullptr) + 1);
+        sleep(2);
+
+        EXPECT_TRUE(storage->Put("new", "val2"));
+        EXPECT_FALSE(storage->Get("old", value));
+        EXPECT_TRUE(storage->Get("new", value));
+        EXPECT_TRUE(value == "val2");
+    }
+}
+
+TEST(StorageTest, Inspect) {
+    MapBasedGlobalLockImpl storage;
+
+    Afina::Storage::Info info;
+    std::string value;
+    EXPECT_FALSE(storage.Inspect("KEY1", info));
+    EXPECT_TRUE(storage.Put("KEY1", "val1", UINT32_MAX));
+    EXPECT_TRUE(storage.Append("KEY1", "-tail"));
+
+    // Metadata alone isn't a read of the value
+    EXPECT_TRUE(storage.Inspect("KEY1", info));
+    EXPECT_EQ(info.size, 9);
+    EXPECT_EQ(info.expire, UINT32_MAX);
+    EXPECT_FALSE(info.fetched);
+    EXPECT_TRUE(storage.Inspect("KEY1", info, &value));
+    EXPECT_TRUE(value == "val1-tail");
+    EXPECT_FALSE(info.fetched);
+
+    uint64_t version;
+    EXPECT_TRUE(storage.Get("KEY1", value, version));
+    EXPECT_TRUE(storage.Inspect("KEY1", info));
+    EXPECT_TRUE(info.fetched);
+    EXPECT_EQ(info.version, version);
+
+    // Change makes the value unread again
+    EXPECT_TRUE(storage.Set("KEY1", "val2"));
+    EXPECT_TRUE(storage.Inspect("KEY1", info));
+    EXPECT_FALSE(info.fetched);
+    EXPECT_EQ(info.expire, 0);
+}
+
+TEST(StorageTest, MultiGet) {
+    MapBasedGlobalLockImpl global(1024 * 1024);
+    MapBasedStripedLockImpl striped(1024 * 1024, 4);
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < 200; i++) {
+        keys.push_back("KEY" + std::to_string(i));
+    }
+
+    for (Afina::Storage *storage : std::vector<Afina::Storage *>{&global, &striped}) {
+        for (size_t i = 0; i < keys.size(); i += 2) {
+            EXPECT_TRUE(storage->Put(keys[i], "val" + std::to_string(i)));
+        }
+
+        // Every found key is received once, with the same value and version Get returns
+        std::vector<std::string> values(keys.size());
+        std::vector<uint64_t> versions(keys.size(), 0);
+        storage->MultiGet(keys.data(), keys.size(), [&](size_t index, const char *value, size_t size, uint64_t version) {
+            EXPECT_EQ(versions[index], 0);
+            values[index].assign(value, size);
+            versions[index] = version;
+        });
+
+        for (size_t i = 0; i < keys.size(); i++) {
+            std::string value;
+            uint64_t version = 0;
+            EXPECT_EQ(storage->Get(keys[i], value, version), i % 2 == 0);
+            EXPECT_TRUE(values[i] == value);
+            EXPECT_EQ(versions[i], version);
+        }
+
+        // Single key
+        std::string single;
+        storage->MultiGet(&keys[2], 1, [&](size_t index, const char *value, size_t size, uint64_t version) {
+            EXPECT_EQ(index, 0);
+            single.assign(value, size);
+        });
+        EXPECT_EQ(single, "val2");
+    }
+}